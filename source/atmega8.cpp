@@ -11,9 +11,10 @@ namespace AVR
 
   ATmega8A::ATmega8A()
     : Mcu("ATmega8A", 0x2000/2, 0x0040, 0x0400, 0x0200, 0),
-      ioEeprom(*this, false)
+      ioEeprom(*this, 15, false), // IRQ_EE_RDY
+      _timer0(*this, 9, 0x01) // IRQ_TIMER0_OVF
   {
-    const Instruction *instructions[]
+    std::vector<const Instruction*> instructions
     {
       &instrADD, &instrADC, &instrADIW, &instrSUB, &instrSUBI, &instrSBC, &instrSBCI, &instrSBIW, &instrAND, &instrANDI,
       &instrOR, &instrORI, &instrEOR, &instrCOM, &instrNEG, &instrINC, &instrDEC, &instrMUL, &instrMULS, &instrMULSU,
@@ -34,8 +35,9 @@ namespace AVR
 
       /*&instrBREAK,*/ &instrNOP, &instrSLEEP, &instrWDR,
     } ;
-    for (const Instruction* iInstr: instructions)
-      AddInstruction(iInstr) ;
+    SetInstructions(instructions) ;
+
+    _peripherals = { &ioEeprom, &_timer0 } ;
 
     _knownProgramAddresses = std::vector<Mcu::KnownProgramAddress>
       {
@@ -63,14 +65,14 @@ namespace AVR
     std::vector<std::pair<uint32_t, std::string>> ioRegs
     {
       { 0x5A, "GIFR" },
-      { 0x59, "TIMSK" },
-      { 0x58, "TIFR" },
+      //{ 0x59, "TIMSK" },
+      //{ 0x58, "TIFR" },
       { 0x57, "SPMCR" },
       { 0x56, "TWCR" },
-      { 0x55, "MCUCR" },
+      //{ 0x55, "MCUCR" },
       { 0x54, "MCUCSR" },
-      { 0x53, "TCCR0" },
-      { 0x52, "TCNT0" },
+      //{ 0x53, "TCCR0" },
+      //{ 0x52, "TCNT0" },
       { 0x51, "OSCCAL" },
       { 0x50, "SFIOR" },
       { 0x4F, "TCCR1A" },
@@ -126,6 +128,12 @@ namespace AVR
     _io[0x3f] = new IoSREG::SREG(*this, _sreg) ;
     _io[0x3e] = new IoSP::SPH(*this, _sp) ;
     _io[0x3d] = new IoSP::SPL(*this, _sp) ;
+    _io[0x39] = new IoTimer8::IntMask(*this, "TIMSK", _timer0) ;
+    _io[0x38] = new IoTimer8::IntFlags(*this, "TIFR", _timer0) ;
+    _io[0x33] = new IoTimer8::CtrlB(*this, "TCCR0", _timer0) ;
+    _io[0x32] = new IoTimer8::Cnt(*this, "TCNT0", _timer0) ;
+    _io[0x35] = new IoSleep::Ctrl(*this, "MCUCR", _sleep) ;
+    _sleep.Bits(0x80, 0x70) ; // SE, SM2..0
 
     _io[0x22] = new IoEeprom::EEARH(*this, ioEeprom) ;
     _io[0x21] = new IoEeprom::EEARL(*this, ioEeprom) ;
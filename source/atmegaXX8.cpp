@@ -9,11 +9,12 @@
 namespace AVR
 {
 
-  ATmegaXX8::ATmegaXX8(const std::string &name, uint32_t flashSize, uint32_t ramSize, uint32_t eepromSize)
+  ATmegaXX8::ATmegaXX8(const std::string &name, uint32_t flashSize, uint32_t ramSize, uint32_t eepromSize, bool hasJmpCall)
     : Mcu(name, flashSize, 0xe0, ramSize, eepromSize, ramSize + 0xff),
-      ioEeprom(*this), _usart0()
+      ioEeprom(*this, 22), _usart0(*this, 18), // IRQ_EE_READY, IRQ_USART_RX
+      _timer0(*this, 16, 0x01, 14, 0x02, 15, 0x04) // IRQ_TIMER0_OVF, IRQ_TIMER0_COMPA, IRQ_TIMER0_COMPB
   {
-    const Instruction *instructions[]
+    std::vector<const Instruction*> instructions
     {
       &instrADD, &instrADC, &instrADIW, &instrSUB, &instrSUBI, &instrSBC, &instrSBCI, &instrSBIW, &instrAND, &instrANDI,
       &instrOR, &instrORI, &instrEOR, &instrCOM, &instrNEG, &instrINC, &instrDEC, &instrMUL, &instrMULS, &instrMULSU,
@@ -34,16 +35,23 @@ namespace AVR
 
       &instrBREAK, &instrNOP, &instrSLEEP, &instrWDR,
     } ;
-    for (const Instruction* iInstr: instructions)
-      AddInstruction(iInstr) ;
+    if (hasJmpCall)
+    {
+      instructions.push_back(&instrJMP) ;
+      instructions.push_back(&instrCALL) ;
+    }
+    SetInstructions(instructions) ;
+
+    _peripherals = { &ioEeprom, &_usart0, &_timer0 } ;
+    _sleep.Bits(0x01, 0x0e) ; // SE, SM2..0
 
     std::vector<std::pair<uint32_t, Io::Register*>> ioRegs
     {
       { 0xC6, new IoUsart::UDRn(*this, _usart0) },
-      { 0xC5, new IoRegisterNotImplemented(*this, "UBRR0H") },
-      { 0xC4, new IoRegisterNotImplemented(*this, "UBRR0L") },
-      { 0xC2, new IoRegisterNotImplemented(*this, "UCSR0C") },
-      { 0xC1, new IoRegisterNotImplemented(*this, "UCSR0B") },
+      { 0xC5, new IoRegisterValue(*this, "UBRR0H", _usart0.UbrrH()) },
+      { 0xC4, new IoRegisterValue(*this, "UBRR0L", _usart0.UbrrL()) },
+      { 0xC2, new IoRegisterValue(*this, "UCSR0C", _usart0.UcsrC()) },
+      { 0xC1, new IoUsart::UCSRnB(*this, _usart0) },
       { 0xC0, new IoUsart::UCSRnA(*this, _usart0) },
       { 0xBD, new IoRegisterNotImplemented(*this, "TWAMR") },
       { 0xBC, new IoRegisterNotImplemented(*this, "TWCR") },
@@ -77,7 +85,7 @@ namespace AVR
       { 0x78, new IoRegisterNotImplemented(*this, "ADCL") },
       { 0x70, new IoRegisterNotImplemented(*this, "TIMSK2") },
       { 0x6F, new IoRegisterNotImplemented(*this, "TIMSK1") },
-      { 0x6E, new IoRegisterNotImplemented(*this, "TIMSK0") },
+      { 0x6E, new IoTimer8::IntMask(*this, "TIMSK0", _timer0) },
       { 0x6D, new IoRegisterNotImplemented(*this, "PCMSK2") },
       { 0x6C, new IoRegisterNotImplemented(*this, "PCMSK1") },
       { 0x6B, new IoRegisterNotImplemented(*this, "PCMSK0") },
@@ -93,18 +101,18 @@ namespace AVR
       { 0x57, new IoRegisterNotImplemented(*this, "SPMCSR") },
       { 0x55, new IoRegisterNotImplemented(*this, "MCUCR") },
       { 0x54, new IoRegisterNotImplemented(*this, "MCUSR") },
-      { 0x53, new IoRegisterNotImplemented(*this, "SMCR") },
+      { 0x53, new IoSleep::Ctrl(*this, "SMCR", _sleep) },
       { 0x50, new IoRegisterNotImplemented(*this, "ACSR") },
       { 0x4E, new IoRegisterNotImplemented(*this, "SPDR") },
       { 0x4D, new IoRegisterNotImplemented(*this, "SPSR") },
       { 0x4C, new IoRegisterNotImplemented(*this, "SPCR") },
       { 0x4B, new IoRegisterNotImplemented(*this, "GPIOR2") },
       { 0x4A, new IoRegisterNotImplemented(*this, "GPIOR1") },
-      { 0x48, new IoRegisterNotImplemented(*this, "OCR0B") },
-      { 0x47, new IoRegisterNotImplemented(*this, "OCR0A") },
-      { 0x46, new IoRegisterNotImplemented(*this, "TCNT0") },
-      { 0x45, new IoRegisterNotImplemented(*this, "TCCR0B") },
-      { 0x44, new IoRegisterNotImplemented(*this, "TCCR0A") },
+      { 0x48, new IoTimer8::OcrB(*this, "OCR0B", _timer0) },
+      { 0x47, new IoTimer8::OcrA(*this, "OCR0A", _timer0) },
+      { 0x46, new IoTimer8::Cnt(*this, "TCNT0", _timer0) },
+      { 0x45, new IoTimer8::CtrlB(*this, "TCCR0B", _timer0) },
+      { 0x44, new IoTimer8::CtrlA(*this, "TCCR0A", _timer0) },
       { 0x43, new IoRegisterNotImplemented(*this, "GTCCR") },
       //{ 0x42, new IoRegisterNotImplemented(*this, "EEARH") },
       //{ 0x41, new IoRegisterNotImplemented(*this, "EEARL") },
@@ -116,7 +124,7 @@ namespace AVR
       { 0x3B, new IoRegisterNotImplemented(*this, "PCIFR") },
       { 0x37, new IoRegisterNotImplemented(*this, "TIFR2") },
       { 0x36, new IoRegisterNotImplemented(*this, "TIFR1") },
-      { 0x35, new IoRegisterNotImplemented(*this, "TIFR0") },
+      { 0x35, new IoTimer8::IntFlags(*this, "TIFR0", _timer0) },
       { 0x2B, new IoRegisterNotImplemented(*this, "PORTD") },
       { 0x2A, new IoRegisterNotImplemented(*this, "DDRD") },
       { 0x29, new IoRegisterNotImplemented(*this, "PIND") },
@@ -138,12 +146,8 @@ namespace AVR
 
   ////////////////////////////////////////////////////////////////////////////////
   
-  ATmega328P::ATmega328P() : ATmegaXX8("ATmega328P", 0x8000/2, 0x0800, 0x0400)
+  ATmega328P::ATmega328P() : ATmegaXX8("ATmega328P", 0x8000/2, 0x0800, 0x0400, true)
   {
-    const Instruction *instructions[] { &instrJMP, &instrCALL, } ;
-    for (const Instruction* iInstr: instructions)
-      AddInstruction(iInstr) ;
-
     // ignoring BOOTRST / IVSEL Fuses
     _knownProgramAddresses = std::vector<Mcu::KnownProgramAddress>
       {
@@ -186,12 +190,8 @@ namespace AVR
 
   ////////////////////////////////////////////////////////////////////////////////
   
-  ATmega168PA::ATmega168PA() : ATmegaXX8("ATmega168PA", 0x4000/2, 0x0400, 0x0200)
+  ATmega168PA::ATmega168PA() : ATmegaXX8("ATmega168PA", 0x4000/2, 0x0400, 0x0200, true)
   {
-    const Instruction *instructions[] { &instrJMP, &instrCALL, } ;
-    for (const Instruction* iInstr: instructions)
-      AddInstruction(iInstr) ;
-
     // ignoring BOOTRST / IVSEL Fuses
     _knownProgramAddresses = std::vector<Mcu::KnownProgramAddress>
       {
@@ -234,7 +234,7 @@ namespace AVR
 
   ////////////////////////////////////////////////////////////////////////////////
   
-  ATmega88PA::ATmega88PA() : ATmegaXX8("ATmega88PA", 0x2000/2, 0x0400, 0x0200)
+  ATmega88PA::ATmega88PA() : ATmegaXX8("ATmega88PA", 0x2000/2, 0x0400, 0x0200, false)
   {
     // ignoring BOOTRST / IVSEL Fuses
     _knownProgramAddresses = std::vector<Mcu::KnownProgramAddress>
@@ -278,7 +278,7 @@ namespace AVR
 
   ////////////////////////////////////////////////////////////////////////////////
   
-  ATmega48PA::ATmega48PA() : ATmegaXX8("ATmega48PA", 0x1000/2, 0x0200, 0x0100)
+  ATmega48PA::ATmega48PA() : ATmegaXX8("ATmega48PA", 0x1000/2, 0x0200, 0x0100, false)
   {
     _knownProgramAddresses = std::vector<Mcu::KnownProgramAddress>
       {
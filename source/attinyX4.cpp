@@ -11,9 +11,10 @@ namespace AVR
 
   ATtinyX4::ATtinyX4(const std::string &name, uint32_t flashSize, uint32_t ramSize, uint32_t eepromSize)
     : Mcu(name, flashSize, 0x40, ramSize, eepromSize, ramSize + 0x5F),
-      ioEeprom(*this)
+      ioEeprom(*this, 14), // IRQ_EE_RDY
+      _timer0(*this, 11, 0x01, 9, 0x02, 10, 0x04) // IRQ_TIM0_OVF, IRQ_TIM0_COMPA, IRQ_TIM0_COMPB
   {
-    const Instruction *instructions[]
+    std::vector<const Instruction*> instructions
     {
       &instrADD, &instrADC, &instrADIW, &instrSUB, &instrSUBI, &instrSBC, &instrSBCI, &instrSBIW, &instrAND, &instrANDI,
       &instrOR, &instrORI, &instrEOR, &instrCOM, &instrNEG, &instrINC, &instrDEC, /*&instrMUL,*/ /*&instrMULS,*/ /*&instrMULSU,*/
@@ -34,8 +35,9 @@ namespace AVR
 
       &instrBREAK, &instrNOP, &instrSLEEP, &instrWDR,
     } ;
-    for (const Instruction* iInstr: instructions)
-      AddInstruction(iInstr) ;
+    SetInstructions(instructions) ;
+
+    _peripherals = { &ioEeprom, &_timer0 } ;
 
     _knownProgramAddresses = std::vector<Mcu::KnownProgramAddress>
       {
@@ -60,19 +62,19 @@ namespace AVR
 
     std::vector<std::pair<uint32_t, std::string>> ioRegs
     {
-      { 0x5C, "OCR0B" },
+      //{ 0x5C, "OCR0B" },
       { 0x5B, "GIMSK" },
       { 0x5A, "GIFR" },
-      { 0x59, "TIMSK0" },
-      { 0x58, "TIFR0" },
+      //{ 0x59, "TIMSK0" },
+      //{ 0x58, "TIFR0" },
       { 0x57, "SPMCSR" },
-      { 0x56, "OCR0A" },
-      { 0x55, "MCUCR" },
+      //{ 0x56, "OCR0A" },
+      //{ 0x55, "MCUCR" },
       { 0x54, "MCUSR" },
-      { 0x53, "TCCR0B" },
-      { 0x52, "TCNT0" },
+      //{ 0x53, "TCCR0B" },
+      //{ 0x52, "TCNT0" },
       { 0x51, "OSCCAL" },
-      { 0x50, "TCCR0A" },
+      //{ 0x50, "TCCR0A" },
       { 0x4F, "TCCR1A" },
       { 0x4E, "TCCR1B" },
       { 0x4D, "TCNT1H" },
@@ -126,6 +128,15 @@ namespace AVR
     _io[0x3f] = new IoSREG::SREG(*this, _sreg) ;
     _io[0x3e] = new IoSP::SPH(*this, _sp) ;
     _io[0x3d] = new IoSP::SPL(*this, _sp) ;
+    _io[0x3c] = new IoTimer8::OcrB(*this, "OCR0B", _timer0) ;
+    _io[0x39] = new IoTimer8::IntMask(*this, "TIMSK0", _timer0) ;
+    _io[0x38] = new IoTimer8::IntFlags(*this, "TIFR0", _timer0) ;
+    _io[0x36] = new IoTimer8::OcrA(*this, "OCR0A", _timer0) ;
+    _io[0x33] = new IoTimer8::CtrlB(*this, "TCCR0B", _timer0) ;
+    _io[0x32] = new IoTimer8::Cnt(*this, "TCNT0", _timer0) ;
+    _io[0x30] = new IoTimer8::CtrlA(*this, "TCCR0A", _timer0) ;
+    _io[0x35] = new IoSleep::Ctrl(*this, "MCUCR", _sleep) ;
+    _sleep.Bits(0x20, 0x18) ; // SE, SM1..0
   }
   ATtinyX4::~ATtinyX4()
   {
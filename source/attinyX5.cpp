@@ -11,9 +11,10 @@ namespace AVR
 
   ATtinyX5::ATtinyX5(const std::string &name, uint32_t flashSize, uint32_t ramSize, uint32_t eepromSize)
     : Mcu(name, flashSize, 0x40, ramSize, eepromSize, ramSize + 0x5f),
-      ioEeprom(*this)
+      ioEeprom(*this, 6), // IRQ_EE_RDY
+      _timer0(*this, 5, 0x02, 10, 0x10, 11, 0x08) // IRQ_TIMER0_OVF, IRQ_TIMER0_COMPA, IRQ_TIMER0_COMPB
   {
-    const Instruction *instructions[]
+    std::vector<const Instruction*> instructions
     {
       &instrADD, &instrADC, &instrADIW, &instrSUB, &instrSUBI, &instrSBC, &instrSBCI, &instrSBIW, &instrAND, &instrANDI,
       &instrOR, &instrORI, &instrEOR, &instrCOM, &instrNEG, &instrINC, &instrDEC, /*&instrMUL,*/ /*&instrMULS,*/ /*&instrMULSU,*/
@@ -34,8 +35,9 @@ namespace AVR
 
       &instrBREAK, &instrNOP, &instrSLEEP, &instrWDR,
     } ;
-    for (const Instruction* iInstr: instructions)
-      AddInstruction(iInstr) ;
+    SetInstructions(instructions) ;
+
+    _peripherals = { &ioEeprom, &_timer0 } ;
 
     _knownProgramAddresses = std::vector<Mcu::KnownProgramAddress>
       {
@@ -60,13 +62,13 @@ namespace AVR
     {
       { 0x5B, "GIMSK" },
       { 0x5A, "GIFR" },
-      { 0x59, "TIMSK" },
-      { 0x58, "TIFR" },
+      //{ 0x59, "TIMSK" },
+      //{ 0x58, "TIFR" },
       { 0x57, "SPMCSR" },
-      { 0x55, "MCUCR" },
+      //{ 0x55, "MCUCR" },
       { 0x54, "MCUSR" },
-      { 0x53, "TCCR0B" },
-      { 0x52, "TCNT0" },
+      //{ 0x53, "TCCR0B" },
+      //{ 0x52, "TCNT0" },
       { 0x51, "OSCCAL" },
       { 0x50, "TCCR1" },
       { 0x4F, "TCNT1" },
@@ -74,9 +76,9 @@ namespace AVR
       { 0x4D, "OCR1C" },
       { 0x4C, "GTCCR" },
       { 0x4B, "OCR1B" },
-      { 0x4A, "TCCR0A" },
-      { 0x49, "OCR0A" },
-      { 0x48, "OCR0B" },
+      //{ 0x4A, "TCCR0A" },
+      //{ 0x49, "OCR0A" },
+      //{ 0x48, "OCR0B" },
       { 0x47, "PLLCSR" },
       { 0x46, "CLKPR" },
       { 0x45, "DT1A" },
@@ -115,6 +117,15 @@ namespace AVR
     _io[0x3f] = new IoSREG::SREG(*this, _sreg) ;
     _io[0x3e] = new IoSP::SPH(*this, _sp) ;
     _io[0x3d] = new IoSP::SPL(*this, _sp) ;
+    _io[0x39] = new IoTimer8::IntMask(*this, "TIMSK", _timer0) ;
+    _io[0x38] = new IoTimer8::IntFlags(*this, "TIFR", _timer0) ;
+    _io[0x33] = new IoTimer8::CtrlB(*this, "TCCR0B", _timer0) ;
+    _io[0x32] = new IoTimer8::Cnt(*this, "TCNT0", _timer0) ;
+    _io[0x2a] = new IoTimer8::CtrlA(*this, "TCCR0A", _timer0) ;
+    _io[0x29] = new IoTimer8::OcrA(*this, "OCR0A", _timer0) ;
+    _io[0x28] = new IoTimer8::OcrB(*this, "OCR0B", _timer0) ;
+    _io[0x35] = new IoSleep::Ctrl(*this, "MCUCR", _sleep) ;
+    _sleep.Bits(0x20, 0x18) ; // SE, SM1..0
   }
   ATtinyX5::~ATtinyX5()
   {
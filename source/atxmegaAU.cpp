@@ -8,7 +8,7 @@
 
 namespace AVR
 {
-  uint8_t  ATxmegaAU::Data(uint32_t addr, bool resetOnError) const
+  uint8_t  ATxmegaAU::DataSpace(uint32_t addr, bool resetOnError) const
   {
     if (addr < _ioSize)
     {
@@ -24,15 +24,13 @@ namespace AVR
       return _ram[addr - 0x2000] ;
     }
 
-    char buff[80] ;
-    snprintf(buff, sizeof(buff), "illegal data read at %05x: %04x\n", _pc, addr) ;
-    Verbose(VerboseType::DataError, buff) ;
+    Verbose(VerboseEvent(VerboseEventType::IllegalDataRead, _pc, addr)) ;
     //if (resetOnError)
     //  const_cast<Mcu*>(this)->_pc = 0 ;
     return 0xff ;
   }
 
-  bool ATxmegaAU::Data(uint32_t addr, uint8_t &byte) const
+  bool ATxmegaAU::DataSpace(uint32_t addr, uint8_t &byte) const
   {
     if (addr < _ioSize)
     {
@@ -53,7 +51,7 @@ namespace AVR
     return false ;
   }
   
-  void ATxmegaAU::Data(uint32_t addr, uint8_t value, bool resetOnError)
+  void ATxmegaAU::DataSpace(uint32_t addr, uint8_t value, bool resetOnError)
   {
     if (addr < _ioSize)
     {
@@ -68,13 +66,11 @@ namespace AVR
 //    }
     else if ((0x2000 <= addr) && (addr < (0x2000 + _ramSize)))
     {
-      _ram[addr - 0x2000] = value ;
+      Ram(addr - 0x2000, value) ;
       return ;
     }
 
-    char buff[80] ;
-    snprintf(buff, sizeof(buff), "illegal data write at %05x: %04x %02x\n", _pc, addr, value) ;
-    Verbose(VerboseType::DataError, buff) ;
+    Verbose(VerboseEvent(VerboseEventType::IllegalDataWrite, _pc, addr, value)) ;
     //if (resetOnError)
     //  _pc = 0 ;
   }
@@ -87,16 +83,12 @@ namespace AVR
       {
         if (addr >= _flashSize)
         {
-          char buff[80] ;
-          snprintf(buff, sizeof(buff), "invalid program memory read at %05x\n", addr) ;
-          Verbose(VerboseType::ProgError, buff) ;
+          Verbose(VerboseEvent(VerboseEventType::InvalidProgramRead, _pc, addr)) ;
           return 0xffff ;
         }
         if (addr >= _loadedFlashSize)
         {
-          char buff[80] ;
-          snprintf(buff, sizeof(buff), "uninitialized program memory read at %05x: %05x\n", _pc, addr) ;
-          Verbose(VerboseType::ProgError, buff) ;
+          Verbose(VerboseEvent(VerboseEventType::UninitializedProgramRead, _pc, addr)) ;
           return 0x9508 ;
         }
         return _flash[addr] ;
@@ -113,12 +105,12 @@ namespace AVR
   {
     if (addr >= _flashSize)
     {
-      char buff[80] ;
-      snprintf(buff, sizeof(buff), "invalid program memory write at %05x: %05x %04x\n", _pc, addr, cmd) ;
-      Verbose(VerboseType::ProgError, buff) ;
+      Verbose(VerboseEvent(VerboseEventType::InvalidProgramWrite, _pc, addr, cmd)) ;
       return ;
     }
+    UniqueImage() ;
     _flash[addr] = cmd ;
+    Decode(addr) ;
   }
 
   bool ATxmegaAU::InRam(uint32_t addr) const
@@ -131,15 +123,48 @@ namespace AVR
     min = 0x2000 ;
     max = 0x2000 + _ramSize - 1 ;
   }
+
+  // PMIC: high level first, within a level lowest vector number first (round robin not supported)
+  bool ATxmegaAU::IrqSelect(uint32_t &vector) const
+  {
+    uint8_t level = 0 ;
+    for (uint32_t iWord = 0 ; iWord < kIrqVectors / 64 ; ++iWord)
+    {
+      for (uint64_t pending = _irqPending[iWord] ; pending ; pending &= pending - 1)
+      {
+        uint32_t iVector = iWord * 64 + __builtin_ctzll(pending) ;
+        uint8_t  iLevel  = _irqSources[iVector]._level ;
+        if ((iLevel > level) && _pmic.Enabled(iLevel))
+        {
+          vector = iVector ;
+          level  = iLevel ;
+        }
+      }
+    }
+    return level != 0 ;
+  }
+
+  void ATxmegaAU::IrqEnter(uint32_t vector)
+  {
+    _pmic.Enter(_irqSources[vector]._level) ; // SREG I unchanged
+  }
+
+  void ATxmegaAU::Reti()
+  {
+    _pmic.Return() ;
+    IrqUpdate() ;
+  }
   
   ATxmegaAU::ATxmegaAU(const std::string &name, uint32_t flashSize, uint32_t ramSize, uint32_t eepromSize)
     : Mcu(name, flashSize, 0x1000, ramSize, eepromSize, 0x3fff),
-      _cpu(*this), _clk(), _nvm(*this, _cpu), _rtc(*this, _clk),
-      _usartC0("USARTC0"), _usartC1("USARTC1"), _usartD0("USARTD0"), _usartD1("USARTD1"), _usartE0("USARTE0")
+      _pmic(*this), _cpu(*this), _clk(), _nvm(*this, _cpu, 32), _rtc(*this, _clk, 10), // vector numbers: NVM_INT_EE, RTC_INT_OVF, TCxx_INT_OVF, USARTxx_INT_RXC
+      _tcC0(*this, "TCC0", 14, 4), _tcC1(*this, "TCC1", 20, 2), _tcD0(*this, "TCD0", 77, 4), _tcD1(*this, "TCD1", 83, 2), _tcE0(*this, "TCE0", 47, 4),
+      _usartC0(*this, "USARTC0", 25), _usartC1(*this, "USARTC1", 28), _usartD0(*this, "USARTD0", 88), _usartD1(*this, "USARTD1", 91), _usartE0(*this, "USARTE0", 58)
   {
     _isXMega = true ;
+    MapRam(0x2000) ;
 
-    const Instruction *instructions[]
+    std::vector<const Instruction*> instructions
     {
       &instrADD, &instrADC, &instrADIW, &instrSUB, &instrSUBI, &instrSBC, &instrSBCI, &instrSBIW, &instrAND, &instrANDI,
       &instrOR, &instrORI, &instrEOR, &instrCOM, &instrNEG, &instrINC, &instrDEC, &instrMUL, &instrMULS, &instrMULSU,
@@ -160,8 +185,10 @@ namespace AVR
 
       &instrBREAK, &instrNOP, &instrSLEEP, &instrWDR,
     } ;
-    for (const Instruction* iInstr: instructions)
-      AddInstruction(iInstr) ;
+    SetInstructions(instructions) ;
+
+    _peripherals = { &_pmic, &_cpu, &_clk, &_nvm, &_rtc, &_tcC0, &_tcC1, &_tcD0, &_tcD1, &_tcE0, &_usartC0, &_usartC1, &_usartD0, &_usartD1, &_usartE0 } ;
+    _sleep.Bits(0x01, 0x0e) ; // SEN, SMODE2..0
 
     _knownProgramAddresses = std::vector<Mcu::KnownProgramAddress>
       {
@@ -305,7 +332,7 @@ namespace AVR
       { 0x0043, new IoXmegaClk::RtcCtrl(*this, _clk) },
       { 0x0044, new IoRegisterNotImplemented(*this, "CLK_USBSCTRL") },
         
-      { 0x0048, new IoRegisterNotImplemented(*this, "SLEEP_CTRL") }, // Sleep Controller
+      { 0x0048, new IoSleep::Ctrl(*this, "SLEEP_CTRL", _sleep) }, // Sleep Controller
         
       { 0x0050, new IoRegisterNotImplemented(*this, "OSC_CTRL") }, // Oscillator Control
       { 0x0051, new IoRegisterNotImplemented(*this, "OSC_STATUS", 0x1f) },
@@ -350,9 +377,9 @@ namespace AVR
       { 0x0098, new IoRegisterNotImplemented(*this, "MCU_EVSYSLOCK") },
       { 0x0099, new IoRegisterNotImplemented(*this, "MCU_AWEXLOCK") },
 
-      { 0x00A0, new IoRegisterNotImplemented(*this, "PMIC_STATUS") }, // Programmable Multilevel Interrupt Controller
-      { 0x00A1, new IoRegisterNotImplemented(*this, "PMIC_INTPRI") },
-      { 0x00A2, new IoRegisterNotImplemented(*this, "PMIC_CTRL") },
+      { 0x00A0, new IoXmegaPmic::Status(*this, _pmic) }, // Programmable Multilevel Interrupt Controller
+      { 0x00A1, new IoXmegaPmic::IntPri(*this, _pmic) },
+      { 0x00A2, new IoXmegaPmic::Ctrl  (*this, _pmic) },
 
       { 0x00B0, new IoRegisterNotImplemented(*this, "PORTCFG_MPCMASK") }, // Port Configuration
       { 0x00B2, new IoRegisterNotImplemented(*this, "PORTCFG_VPCTRLA") },
@@ -554,15 +581,15 @@ namespace AVR
 
       { 0x0400, new IoXmegaRtc::Ctrl(*this, _rtc) }, // Real Time Counter
       { 0x0401, new IoXmegaRtc::Status(*this, _rtc) },
-      { 0x0402, new IoRegisterNotImplemented(*this, "RTC_INTCTRL") },
-      { 0x0403, new IoRegisterNotImplemented(*this, "RTC_INTFLAGS") },
+      { 0x0402, new IoXmegaRtc::IntCtrl(*this, _rtc) },
+      { 0x0403, new IoXmegaRtc::IntFlags(*this, _rtc) },
       { 0x0404, new IoXmegaRtc::Temp(*this, _rtc) },
       { 0x0408, new IoXmegaRtc::CntL(*this, _rtc) },
       { 0x0409, new IoXmegaRtc::CntH(*this, _rtc) },
-      { 0x040a, new IoRegisterNotImplemented(*this, "RTC_PERL") },
-      { 0x040b, new IoRegisterNotImplemented(*this, "RTC_PERH") },
-      { 0x040c, new IoRegisterNotImplemented(*this, "RTC_COMPL") },
-      { 0x040d, new IoRegisterNotImplemented(*this, "RTC_COMPH") },
+      { 0x040a, new IoXmegaRtc::PerL(*this, _rtc) },
+      { 0x040b, new IoXmegaRtc::PerH(*this, _rtc) },
+      { 0x040c, new IoXmegaRtc::CompL(*this, _rtc) },
+      { 0x040d, new IoXmegaRtc::CompH(*this, _rtc) },
 
       { 0x0480, new IoRegisterNotImplemented(*this, "TWIC_CTRL") }, // Two Wire Interface on port C
       { 0x0481, new IoRegisterNotImplemented(*this, "TWIC_MASTER_CTRLA") },
@@ -735,73 +762,73 @@ namespace AVR
       { 0x07F6, new IoRegisterNotImplemented(*this, "PORTR_PIN6CTRL") },
       { 0x07F7, new IoRegisterNotImplemented(*this, "PORTR_PIN7CTRL") },
 
-      { 0x0800, new IoRegisterNotImplemented(*this, "TCC0_CTRLA") }, // Timer/Counter 0 on port C
-      { 0x0801, new IoRegisterNotImplemented(*this, "TCC0_CTRLB") },
-      { 0x0802, new IoRegisterNotImplemented(*this, "TCC0_CTRLC") },
-      { 0x0803, new IoRegisterNotImplemented(*this, "TCC0_CTRLD") },
-      { 0x0804, new IoRegisterNotImplemented(*this, "TCC0_CTRLE") },
-      { 0x0806, new IoRegisterNotImplemented(*this, "TCC0_INTCTRLA") },
-      { 0x0807, new IoRegisterNotImplemented(*this, "TCC0_INTCTRLB") },
-      { 0x0808, new IoRegisterNotImplemented(*this, "TCC0_CTRLFCLR") },
-      { 0x0809, new IoRegisterNotImplemented(*this, "TCC0_CTRLFSET") },
-      { 0x080a, new IoRegisterNotImplemented(*this, "TCC0_CTRLGCLR") },
-      { 0x080b, new IoRegisterNotImplemented(*this, "TCC0_CTRLGSET") },
-      { 0x080c, new IoRegisterNotImplemented(*this, "TCC0_INTFLAGS") },
-      { 0x080f, new IoRegisterNotImplemented(*this, "TCC0_TEMP") },
-      { 0x0820, new IoRegisterNotImplemented(*this, "TCC0_CNTL") },
-      { 0x0821, new IoRegisterNotImplemented(*this, "TCC0_CNTH") },
-      { 0x0826, new IoRegisterNotImplemented(*this, "TCC0_PERL") },
-      { 0x0827, new IoRegisterNotImplemented(*this, "TCC0_PERH") },
-      { 0x0828, new IoRegisterNotImplemented(*this, "TCC0_CCAL") },
-      { 0x0829, new IoRegisterNotImplemented(*this, "TCC0_CCAH") },
-      { 0x082a, new IoRegisterNotImplemented(*this, "TCC0_CCBL") },
-      { 0x082b, new IoRegisterNotImplemented(*this, "TCC0_CCBH") },
-      { 0x082c, new IoRegisterNotImplemented(*this, "TCC0_CCCL") },
-      { 0x082d, new IoRegisterNotImplemented(*this, "TCC0_CCCH") },
-      { 0x082e, new IoRegisterNotImplemented(*this, "TCC0_CCDL") },
-      { 0x082f, new IoRegisterNotImplemented(*this, "TCC0_CCDH") },
-      { 0x0836, new IoRegisterNotImplemented(*this, "TCC0_PERBUFL") },
-      { 0x0837, new IoRegisterNotImplemented(*this, "TCC0_PERBUFH") },
-      { 0x0838, new IoRegisterNotImplemented(*this, "TCC0_CCABUFL") },
-      { 0x0839, new IoRegisterNotImplemented(*this, "TCC0_CCABUFH") },
-      { 0x083a, new IoRegisterNotImplemented(*this, "TCC0_CCBBUFL") },
-      { 0x083b, new IoRegisterNotImplemented(*this, "TCC0_CCBBUFH") },
-      { 0x083c, new IoRegisterNotImplemented(*this, "TCC0_CCCBUFL") },
-      { 0x083d, new IoRegisterNotImplemented(*this, "TCC0_CCCBUFH") },
-      { 0x083e, new IoRegisterNotImplemented(*this, "TCC0_CCDBUFL") },
-      { 0x083f, new IoRegisterNotImplemented(*this, "TCC0_CCDBUFH") },
-
-      { 0x0840, new IoRegisterNotImplemented(*this, "TCC1_CTRLA") }, // Timer/Counter 1 on port C
-      { 0x0841, new IoRegisterNotImplemented(*this, "TCC1_CTRLB") },
-      { 0x0842, new IoRegisterNotImplemented(*this, "TCC1_CTRLC") },
-      { 0x0843, new IoRegisterNotImplemented(*this, "TCC1_CTRLD") },
-      { 0x0844, new IoRegisterNotImplemented(*this, "TCC1_CTRLE") },
-      { 0x0846, new IoRegisterNotImplemented(*this, "TCC1_INTCTRLA") },
-      { 0x0847, new IoRegisterNotImplemented(*this, "TCC1_INTCTRLB") },
-      { 0x0848, new IoRegisterNotImplemented(*this, "TCC1_CTRLFCLR") },
-      { 0x0849, new IoRegisterNotImplemented(*this, "TCC1_CTRLFSET") },
-      { 0x084a, new IoRegisterNotImplemented(*this, "TCC1_CTRLGCLR") },
-      { 0x084b, new IoRegisterNotImplemented(*this, "TCC1_CTRLGSET") },
-      { 0x084c, new IoRegisterNotImplemented(*this, "TCC1_INTFLAGS") },
-      { 0x084f, new IoRegisterNotImplemented(*this, "TCC1_TEMP") },
-      { 0x0860, new IoRegisterNotImplemented(*this, "TCC1_CNTL") },
-      { 0x0861, new IoRegisterNotImplemented(*this, "TCC1_CNTH") },
-      { 0x0866, new IoRegisterNotImplemented(*this, "TCC1_PERL") },
-      { 0x0867, new IoRegisterNotImplemented(*this, "TCC1_PERH") },
-      { 0x0868, new IoRegisterNotImplemented(*this, "TCC1_CCAL") },
-      { 0x0869, new IoRegisterNotImplemented(*this, "TCC1_CCAH") },
-      { 0x086a, new IoRegisterNotImplemented(*this, "TCC1_CCBL") },
-      { 0x086b, new IoRegisterNotImplemented(*this, "TCC1_CCBH") },
+      { 0x0800, new IoXmegaTc::CtrlA(*this, _tcC0) }, // Timer/Counter 0 on port C
+      { 0x0801, new IoXmegaTc::CtrlB(*this, _tcC0) },
+      { 0x0802, new IoRegisterValue(*this, "TCC0_CTRLC", _tcC0.CtrlC()) },
+      { 0x0803, new IoRegisterValue(*this, "TCC0_CTRLD", _tcC0.CtrlD()) },
+      { 0x0804, new IoRegisterValue(*this, "TCC0_CTRLE", _tcC0.CtrlE()) },
+      { 0x0806, new IoXmegaTc::IntCtrlA(*this, _tcC0) },
+      { 0x0807, new IoXmegaTc::IntCtrlB(*this, _tcC0) },
+      { 0x0808, new IoXmegaTc::CtrlFClr(*this, _tcC0) },
+      { 0x0809, new IoXmegaTc::CtrlFSet(*this, _tcC0) },
+      { 0x080a, new IoXmegaTc::CtrlGClr(*this, _tcC0) },
+      { 0x080b, new IoXmegaTc::CtrlGSet(*this, _tcC0) },
+      { 0x080c, new IoXmegaTc::IntFlags(*this, _tcC0) },
+      { 0x080f, new IoXmegaTc::Temp(*this, _tcC0) },
+      { 0x0820, new IoXmegaTc::CntL(*this, _tcC0) },
+      { 0x0821, new IoXmegaTc::CntH(*this, _tcC0) },
+      { 0x0826, new IoXmegaTc::PerL(*this, _tcC0) },
+      { 0x0827, new IoXmegaTc::PerH(*this, _tcC0) },
+      { 0x0828, new IoXmegaTc::CcL(*this, _tcC0, 0) },
+      { 0x0829, new IoXmegaTc::CcH(*this, _tcC0, 0) },
+      { 0x082a, new IoXmegaTc::CcL(*this, _tcC0, 1) },
+      { 0x082b, new IoXmegaTc::CcH(*this, _tcC0, 1) },
+      { 0x082c, new IoXmegaTc::CcL(*this, _tcC0, 2) },
+      { 0x082d, new IoXmegaTc::CcH(*this, _tcC0, 2) },
+      { 0x082e, new IoXmegaTc::CcL(*this, _tcC0, 3) },
+      { 0x082f, new IoXmegaTc::CcH(*this, _tcC0, 3) },
+      { 0x0836, new IoXmegaTc::PerBufL(*this, _tcC0) },
+      { 0x0837, new IoXmegaTc::PerBufH(*this, _tcC0) },
+      { 0x0838, new IoXmegaTc::CcBufL(*this, _tcC0, 0) },
+      { 0x0839, new IoXmegaTc::CcBufH(*this, _tcC0, 0) },
+      { 0x083a, new IoXmegaTc::CcBufL(*this, _tcC0, 1) },
+      { 0x083b, new IoXmegaTc::CcBufH(*this, _tcC0, 1) },
+      { 0x083c, new IoXmegaTc::CcBufL(*this, _tcC0, 2) },
+      { 0x083d, new IoXmegaTc::CcBufH(*this, _tcC0, 2) },
+      { 0x083e, new IoXmegaTc::CcBufL(*this, _tcC0, 3) },
+      { 0x083f, new IoXmegaTc::CcBufH(*this, _tcC0, 3) },
+
+      { 0x0840, new IoXmegaTc::CtrlA(*this, _tcC1) }, // Timer/Counter 1 on port C
+      { 0x0841, new IoXmegaTc::CtrlB(*this, _tcC1) },
+      { 0x0842, new IoRegisterValue(*this, "TCC1_CTRLC", _tcC1.CtrlC()) },
+      { 0x0843, new IoRegisterValue(*this, "TCC1_CTRLD", _tcC1.CtrlD()) },
+      { 0x0844, new IoRegisterValue(*this, "TCC1_CTRLE", _tcC1.CtrlE()) },
+      { 0x0846, new IoXmegaTc::IntCtrlA(*this, _tcC1) },
+      { 0x0847, new IoXmegaTc::IntCtrlB(*this, _tcC1) },
+      { 0x0848, new IoXmegaTc::CtrlFClr(*this, _tcC1) },
+      { 0x0849, new IoXmegaTc::CtrlFSet(*this, _tcC1) },
+      { 0x084a, new IoXmegaTc::CtrlGClr(*this, _tcC1) },
+      { 0x084b, new IoXmegaTc::CtrlGSet(*this, _tcC1) },
+      { 0x084c, new IoXmegaTc::IntFlags(*this, _tcC1) },
+      { 0x084f, new IoXmegaTc::Temp(*this, _tcC1) },
+      { 0x0860, new IoXmegaTc::CntL(*this, _tcC1) },
+      { 0x0861, new IoXmegaTc::CntH(*this, _tcC1) },
+      { 0x0866, new IoXmegaTc::PerL(*this, _tcC1) },
+      { 0x0867, new IoXmegaTc::PerH(*this, _tcC1) },
+      { 0x0868, new IoXmegaTc::CcL(*this, _tcC1, 0) },
+      { 0x0869, new IoXmegaTc::CcH(*this, _tcC1, 0) },
+      { 0x086a, new IoXmegaTc::CcL(*this, _tcC1, 1) },
+      { 0x086b, new IoXmegaTc::CcH(*this, _tcC1, 1) },
       { 0x086c, new IoRegisterNotImplemented(*this, "TCC1_CCCL") },
       { 0x086d, new IoRegisterNotImplemented(*this, "TCC1_CCCH") },
       { 0x086e, new IoRegisterNotImplemented(*this, "TCC1_CCDL") },
       { 0x086f, new IoRegisterNotImplemented(*this, "TCC1_CCDH") },
-      { 0x0876, new IoRegisterNotImplemented(*this, "TCC1_PERBUFL") },
-      { 0x0877, new IoRegisterNotImplemented(*this, "TCC1_PERBUFH") },
-      { 0x0878, new IoRegisterNotImplemented(*this, "TCC1_CCABUFL") },
-      { 0x0879, new IoRegisterNotImplemented(*this, "TCC1_CCABUFH") },
-      { 0x087a, new IoRegisterNotImplemented(*this, "TCC1_CCBBUFL") },
-      { 0x087b, new IoRegisterNotImplemented(*this, "TCC1_CCBBUFH") },
+      { 0x0876, new IoXmegaTc::PerBufL(*this, _tcC1) },
+      { 0x0877, new IoXmegaTc::PerBufH(*this, _tcC1) },
+      { 0x0878, new IoXmegaTc::CcBufL(*this, _tcC1, 0) },
+      { 0x0879, new IoXmegaTc::CcBufH(*this, _tcC1, 0) },
+      { 0x087a, new IoXmegaTc::CcBufL(*this, _tcC1, 1) },
+      { 0x087b, new IoXmegaTc::CcBufH(*this, _tcC1, 1) },
       { 0x087c, new IoRegisterNotImplemented(*this, "TCC1_CCCBUFL") },
       { 0x087d, new IoRegisterNotImplemented(*this, "TCC1_CCCBUFH") },
       { 0x087e, new IoRegisterNotImplemented(*this, "TCC1_CCDBUFL") },
@@ -846,73 +873,73 @@ namespace AVR
       { 0x08F9, new IoRegisterNotImplemented(*this, "IRCOM_TXPLCTRL") },
       { 0x08Fa, new IoRegisterNotImplemented(*this, "IRCOM_RXPLCTRL") },
 
-      { 0x0900, new IoRegisterNotImplemented(*this, "TCD0_CTRLA") }, // Timer/Counter 0 on port D
-      { 0x0901, new IoRegisterNotImplemented(*this, "TCD0_CTRLB") },
-      { 0x0902, new IoRegisterNotImplemented(*this, "TCD0_CTRLC") },
-      { 0x0903, new IoRegisterNotImplemented(*this, "TCD0_CTRLD") },
-      { 0x0904, new IoRegisterNotImplemented(*this, "TCD0_CTRLE") },
-      { 0x0906, new IoRegisterNotImplemented(*this, "TCD0_INTCTRLA") },
-      { 0x0907, new IoRegisterNotImplemented(*this, "TCD0_INTCTRLB") },
-      { 0x0908, new IoRegisterNotImplemented(*this, "TCD0_CTRLFCLR") },
-      { 0x0909, new IoRegisterNotImplemented(*this, "TCD0_CTRLFSET") },
-      { 0x090a, new IoRegisterNotImplemented(*this, "TCD0_CTRLGCLR") },
-      { 0x090b, new IoRegisterNotImplemented(*this, "TCD0_CTRLGSET") },
-      { 0x090c, new IoRegisterNotImplemented(*this, "TCD0_INTFLAGS") },
-      { 0x090f, new IoRegisterNotImplemented(*this, "TCD0_TEMP") },
-      { 0x0920, new IoRegisterNotImplemented(*this, "TCD0_CNTL") },
-      { 0x0921, new IoRegisterNotImplemented(*this, "TCD0_CNTH") },
-      { 0x0926, new IoRegisterNotImplemented(*this, "TCD0_PERL") },
-      { 0x0927, new IoRegisterNotImplemented(*this, "TCD0_PERH") },
-      { 0x0928, new IoRegisterNotImplemented(*this, "TCD0_CCAL") },
-      { 0x0929, new IoRegisterNotImplemented(*this, "TCD0_CCAH") },
-      { 0x092a, new IoRegisterNotImplemented(*this, "TCD0_CCBL") },
-      { 0x092b, new IoRegisterNotImplemented(*this, "TCD0_CCBH") },
-      { 0x092c, new IoRegisterNotImplemented(*this, "TCD0_CCCL") },
-      { 0x092d, new IoRegisterNotImplemented(*this, "TCD0_CCCH") },
-      { 0x092e, new IoRegisterNotImplemented(*this, "TCD0_CCDL") },
-      { 0x092f, new IoRegisterNotImplemented(*this, "TCD0_CCDH") },
-      { 0x0936, new IoRegisterNotImplemented(*this, "TCD0_PERBUFL") },
-      { 0x0937, new IoRegisterNotImplemented(*this, "TCD0_PERBUFH") },
-      { 0x0938, new IoRegisterNotImplemented(*this, "TCD0_CCABUFL") },
-      { 0x0939, new IoRegisterNotImplemented(*this, "TCD0_CCABUFH") },
-      { 0x093a, new IoRegisterNotImplemented(*this, "TCD0_CCBBUFL") },
-      { 0x093b, new IoRegisterNotImplemented(*this, "TCD0_CCBBUFH") },
-      { 0x093c, new IoRegisterNotImplemented(*this, "TCD0_CCCBUFL") },
-      { 0x093d, new IoRegisterNotImplemented(*this, "TCD0_CCCBUFH") },
-      { 0x093e, new IoRegisterNotImplemented(*this, "TCD0_CCDBUFL") },
-      { 0x093f, new IoRegisterNotImplemented(*this, "TCD0_CCDBUFH") },
-
-      { 0x0940, new IoRegisterNotImplemented(*this, "TCD1_CTRLA") }, // Timer/Counter 1 on port D
-      { 0x0941, new IoRegisterNotImplemented(*this, "TCD1_CTRLB") },
-      { 0x0942, new IoRegisterNotImplemented(*this, "TCD1_CTRLC") },
-      { 0x0943, new IoRegisterNotImplemented(*this, "TCD1_CTRLD") },
-      { 0x0944, new IoRegisterNotImplemented(*this, "TCD1_CTRLE") },
-      { 0x0946, new IoRegisterNotImplemented(*this, "TCD1_INTCTRLA") },
-      { 0x0947, new IoRegisterNotImplemented(*this, "TCD1_INTCTRLB") },
-      { 0x0948, new IoRegisterNotImplemented(*this, "TCD1_CTRLFCLR") },
-      { 0x0949, new IoRegisterNotImplemented(*this, "TCD1_CTRLFSET") },
-      { 0x094a, new IoRegisterNotImplemented(*this, "TCD1_CTRLGCLR") },
-      { 0x094b, new IoRegisterNotImplemented(*this, "TCD1_CTRLGSET") },
-      { 0x094c, new IoRegisterNotImplemented(*this, "TCD1_INTFLAGS") },
-      { 0x094f, new IoRegisterNotImplemented(*this, "TCD1_TEMP") },
-      { 0x0960, new IoRegisterNotImplemented(*this, "TCD1_CNTL") },
-      { 0x0961, new IoRegisterNotImplemented(*this, "TCD1_CNTH") },
-      { 0x0966, new IoRegisterNotImplemented(*this, "TCD1_PERL") },
-      { 0x0967, new IoRegisterNotImplemented(*this, "TCD1_PERH") },
-      { 0x0968, new IoRegisterNotImplemented(*this, "TCD1_CCAL") },
-      { 0x0969, new IoRegisterNotImplemented(*this, "TCD1_CCAH") },
-      { 0x096a, new IoRegisterNotImplemented(*this, "TCD1_CCBL") },
-      { 0x096b, new IoRegisterNotImplemented(*this, "TCD1_CCBH") },
+      { 0x0900, new IoXmegaTc::CtrlA(*this, _tcD0) }, // Timer/Counter 0 on port D
+      { 0x0901, new IoXmegaTc::CtrlB(*this, _tcD0) },
+      { 0x0902, new IoRegisterValue(*this, "TCD0_CTRLC", _tcD0.CtrlC()) },
+      { 0x0903, new IoRegisterValue(*this, "TCD0_CTRLD", _tcD0.CtrlD()) },
+      { 0x0904, new IoRegisterValue(*this, "TCD0_CTRLE", _tcD0.CtrlE()) },
+      { 0x0906, new IoXmegaTc::IntCtrlA(*this, _tcD0) },
+      { 0x0907, new IoXmegaTc::IntCtrlB(*this, _tcD0) },
+      { 0x0908, new IoXmegaTc::CtrlFClr(*this, _tcD0) },
+      { 0x0909, new IoXmegaTc::CtrlFSet(*this, _tcD0) },
+      { 0x090a, new IoXmegaTc::CtrlGClr(*this, _tcD0) },
+      { 0x090b, new IoXmegaTc::CtrlGSet(*this, _tcD0) },
+      { 0x090c, new IoXmegaTc::IntFlags(*this, _tcD0) },
+      { 0x090f, new IoXmegaTc::Temp(*this, _tcD0) },
+      { 0x0920, new IoXmegaTc::CntL(*this, _tcD0) },
+      { 0x0921, new IoXmegaTc::CntH(*this, _tcD0) },
+      { 0x0926, new IoXmegaTc::PerL(*this, _tcD0) },
+      { 0x0927, new IoXmegaTc::PerH(*this, _tcD0) },
+      { 0x0928, new IoXmegaTc::CcL(*this, _tcD0, 0) },
+      { 0x0929, new IoXmegaTc::CcH(*this, _tcD0, 0) },
+      { 0x092a, new IoXmegaTc::CcL(*this, _tcD0, 1) },
+      { 0x092b, new IoXmegaTc::CcH(*this, _tcD0, 1) },
+      { 0x092c, new IoXmegaTc::CcL(*this, _tcD0, 2) },
+      { 0x092d, new IoXmegaTc::CcH(*this, _tcD0, 2) },
+      { 0x092e, new IoXmegaTc::CcL(*this, _tcD0, 3) },
+      { 0x092f, new IoXmegaTc::CcH(*this, _tcD0, 3) },
+      { 0x0936, new IoXmegaTc::PerBufL(*this, _tcD0) },
+      { 0x0937, new IoXmegaTc::PerBufH(*this, _tcD0) },
+      { 0x0938, new IoXmegaTc::CcBufL(*this, _tcD0, 0) },
+      { 0x0939, new IoXmegaTc::CcBufH(*this, _tcD0, 0) },
+      { 0x093a, new IoXmegaTc::CcBufL(*this, _tcD0, 1) },
+      { 0x093b, new IoXmegaTc::CcBufH(*this, _tcD0, 1) },
+      { 0x093c, new IoXmegaTc::CcBufL(*this, _tcD0, 2) },
+      { 0x093d, new IoXmegaTc::CcBufH(*this, _tcD0, 2) },
+      { 0x093e, new IoXmegaTc::CcBufL(*this, _tcD0, 3) },
+      { 0x093f, new IoXmegaTc::CcBufH(*this, _tcD0, 3) },
+
+      { 0x0940, new IoXmegaTc::CtrlA(*this, _tcD1) }, // Timer/Counter 1 on port D
+      { 0x0941, new IoXmegaTc::CtrlB(*this, _tcD1) },
+      { 0x0942, new IoRegisterValue(*this, "TCD1_CTRLC", _tcD1.CtrlC()) },
+      { 0x0943, new IoRegisterValue(*this, "TCD1_CTRLD", _tcD1.CtrlD()) },
+      { 0x0944, new IoRegisterValue(*this, "TCD1_CTRLE", _tcD1.CtrlE()) },
+      { 0x0946, new IoXmegaTc::IntCtrlA(*this, _tcD1) },
+      { 0x0947, new IoXmegaTc::IntCtrlB(*this, _tcD1) },
+      { 0x0948, new IoXmegaTc::CtrlFClr(*this, _tcD1) },
+      { 0x0949, new IoXmegaTc::CtrlFSet(*this, _tcD1) },
+      { 0x094a, new IoXmegaTc::CtrlGClr(*this, _tcD1) },
+      { 0x094b, new IoXmegaTc::CtrlGSet(*this, _tcD1) },
+      { 0x094c, new IoXmegaTc::IntFlags(*this, _tcD1) },
+      { 0x094f, new IoXmegaTc::Temp(*this, _tcD1) },
+      { 0x0960, new IoXmegaTc::CntL(*this, _tcD1) },
+      { 0x0961, new IoXmegaTc::CntH(*this, _tcD1) },
+      { 0x0966, new IoXmegaTc::PerL(*this, _tcD1) },
+      { 0x0967, new IoXmegaTc::PerH(*this, _tcD1) },
+      { 0x0968, new IoXmegaTc::CcL(*this, _tcD1, 0) },
+      { 0x0969, new IoXmegaTc::CcH(*this, _tcD1, 0) },
+      { 0x096a, new IoXmegaTc::CcL(*this, _tcD1, 1) },
+      { 0x096b, new IoXmegaTc::CcH(*this, _tcD1, 1) },
       { 0x096c, new IoRegisterNotImplemented(*this, "TCD1_CCCL") },
       { 0x096d, new IoRegisterNotImplemented(*this, "TCD1_CCCH") },
       { 0x096e, new IoRegisterNotImplemented(*this, "TCD1_CCDL") },
       { 0x096f, new IoRegisterNotImplemented(*this, "TCD1_CCDH") },
-      { 0x0976, new IoRegisterNotImplemented(*this, "TCD1_PERBUFL") },
-      { 0x0977, new IoRegisterNotImplemented(*this, "TCD1_PERBUFH") },
-      { 0x0978, new IoRegisterNotImplemented(*this, "TCD1_CCABUFL") },
-      { 0x0979, new IoRegisterNotImplemented(*this, "TCD1_CCABUFH") },
-      { 0x097a, new IoRegisterNotImplemented(*this, "TCD1_CCBBUFL") },
-      { 0x097b, new IoRegisterNotImplemented(*this, "TCD1_CCBBUFH") },
+      { 0x0976, new IoXmegaTc::PerBufL(*this, _tcD1) },
+      { 0x0977, new IoXmegaTc::PerBufH(*this, _tcD1) },
+      { 0x0978, new IoXmegaTc::CcBufL(*this, _tcD1, 0) },
+      { 0x0979, new IoXmegaTc::CcBufH(*this, _tcD1, 0) },
+      { 0x097a, new IoXmegaTc::CcBufL(*this, _tcD1, 1) },
+      { 0x097b, new IoXmegaTc::CcBufH(*this, _tcD1, 1) },
       { 0x097c, new IoRegisterNotImplemented(*this, "TCD1_CCCBUFL") },
       { 0x097d, new IoRegisterNotImplemented(*this, "TCD1_CCCBUFH") },
       { 0x097e, new IoRegisterNotImplemented(*this, "TCD1_CCDBUFL") },
@@ -941,41 +968,41 @@ namespace AVR
       { 0x09C2, new IoRegisterNotImplemented(*this, "SPID_STATUS", 0x80) },
       { 0x09C3, new IoRegisterNotImplemented(*this, "SPID_DATA") },
 
-      { 0x0A00, new IoRegisterNotImplemented(*this, "TCE0_CTRLA") }, // Timer/Counter 0 on port E
-      { 0x0A01, new IoRegisterNotImplemented(*this, "TCE0_CTRLB") },
-      { 0x0A02, new IoRegisterNotImplemented(*this, "TCE0_CTRLC") },
-      { 0x0A03, new IoRegisterNotImplemented(*this, "TCE0_CTRLD") },
-      { 0x0A04, new IoRegisterNotImplemented(*this, "TCE0_CTRLE") },
-      { 0x0A06, new IoRegisterNotImplemented(*this, "TCE0_INTCTRLA") },
-      { 0x0A07, new IoRegisterNotImplemented(*this, "TCE0_INTCTRLB") },
-      { 0x0A08, new IoRegisterNotImplemented(*this, "TCE0_CTRLFCLR") },
-      { 0x0A09, new IoRegisterNotImplemented(*this, "TCE0_CTRLFSET") },
-      { 0x0A0a, new IoRegisterNotImplemented(*this, "TCE0_CTRLGCLR") },
-      { 0x0A0b, new IoRegisterNotImplemented(*this, "TCE0_CTRLGSET") },
-      { 0x0A0c, new IoRegisterNotImplemented(*this, "TCE0_INTFLAGS") },
-      { 0x0A0f, new IoRegisterNotImplemented(*this, "TCE0_TEMP") },
-      { 0x0A20, new IoRegisterNotImplemented(*this, "TCE0_CNTL") },
-      { 0x0A21, new IoRegisterNotImplemented(*this, "TCE0_CNTH") },
-      { 0x0A26, new IoRegisterNotImplemented(*this, "TCE0_PERL") },
-      { 0x0A27, new IoRegisterNotImplemented(*this, "TCE0_PERH") },
-      { 0x0A28, new IoRegisterNotImplemented(*this, "TCE0_CCAL") },
-      { 0x0A29, new IoRegisterNotImplemented(*this, "TCE0_CCAH") },
-      { 0x0A2a, new IoRegisterNotImplemented(*this, "TCE0_CCBL") },
-      { 0x0A2b, new IoRegisterNotImplemented(*this, "TCE0_CCBH") },
-      { 0x0A2c, new IoRegisterNotImplemented(*this, "TCE0_CCCL") },
-      { 0x0A2d, new IoRegisterNotImplemented(*this, "TCE0_CCCH") },
-      { 0x0A2e, new IoRegisterNotImplemented(*this, "TCE0_CCDL") },
-      { 0x0A2f, new IoRegisterNotImplemented(*this, "TCE0_CCDH") },
-      { 0x0A36, new IoRegisterNotImplemented(*this, "TCE0_PERBUFL") },
-      { 0x0A37, new IoRegisterNotImplemented(*this, "TCE0_PERBUFH") },
-      { 0x0A38, new IoRegisterNotImplemented(*this, "TCE0_CCABUFL") },
-      { 0x0A39, new IoRegisterNotImplemented(*this, "TCE0_CCABUFH") },
-      { 0x0A3a, new IoRegisterNotImplemented(*this, "TCE0_CCBBUFL") },
-      { 0x0A3b, new IoRegisterNotImplemented(*this, "TCE0_CCBBUFH") },
-      { 0x0A3c, new IoRegisterNotImplemented(*this, "TCE0_CCCBUFL") },
-      { 0x0A3d, new IoRegisterNotImplemented(*this, "TCE0_CCCBUFH") },
-      { 0x0A3e, new IoRegisterNotImplemented(*this, "TCE0_CCDBUFL") },
-      { 0x0A3f, new IoRegisterNotImplemented(*this, "TCE0_CCDBUFH") },
+      { 0x0A00, new IoXmegaTc::CtrlA(*this, _tcE0) }, // Timer/Counter 0 on port E
+      { 0x0A01, new IoXmegaTc::CtrlB(*this, _tcE0) },
+      { 0x0A02, new IoRegisterValue(*this, "TCE0_CTRLC", _tcE0.CtrlC()) },
+      { 0x0A03, new IoRegisterValue(*this, "TCE0_CTRLD", _tcE0.CtrlD()) },
+      { 0x0A04, new IoRegisterValue(*this, "TCE0_CTRLE", _tcE0.CtrlE()) },
+      { 0x0A06, new IoXmegaTc::IntCtrlA(*this, _tcE0) },
+      { 0x0A07, new IoXmegaTc::IntCtrlB(*this, _tcE0) },
+      { 0x0A08, new IoXmegaTc::CtrlFClr(*this, _tcE0) },
+      { 0x0A09, new IoXmegaTc::CtrlFSet(*this, _tcE0) },
+      { 0x0A0a, new IoXmegaTc::CtrlGClr(*this, _tcE0) },
+      { 0x0A0b, new IoXmegaTc::CtrlGSet(*this, _tcE0) },
+      { 0x0A0c, new IoXmegaTc::IntFlags(*this, _tcE0) },
+      { 0x0A0f, new IoXmegaTc::Temp(*this, _tcE0) },
+      { 0x0A20, new IoXmegaTc::CntL(*this, _tcE0) },
+      { 0x0A21, new IoXmegaTc::CntH(*this, _tcE0) },
+      { 0x0A26, new IoXmegaTc::PerL(*this, _tcE0) },
+      { 0x0A27, new IoXmegaTc::PerH(*this, _tcE0) },
+      { 0x0A28, new IoXmegaTc::CcL(*this, _tcE0, 0) },
+      { 0x0A29, new IoXmegaTc::CcH(*this, _tcE0, 0) },
+      { 0x0A2a, new IoXmegaTc::CcL(*this, _tcE0, 1) },
+      { 0x0A2b, new IoXmegaTc::CcH(*this, _tcE0, 1) },
+      { 0x0A2c, new IoXmegaTc::CcL(*this, _tcE0, 2) },
+      { 0x0A2d, new IoXmegaTc::CcH(*this, _tcE0, 2) },
+      { 0x0A2e, new IoXmegaTc::CcL(*this, _tcE0, 3) },
+      { 0x0A2f, new IoXmegaTc::CcH(*this, _tcE0, 3) },
+      { 0x0A36, new IoXmegaTc::PerBufL(*this, _tcE0) },
+      { 0x0A37, new IoXmegaTc::PerBufH(*this, _tcE0) },
+      { 0x0A38, new IoXmegaTc::CcBufL(*this, _tcE0, 0) },
+      { 0x0A39, new IoXmegaTc::CcBufH(*this, _tcE0, 0) },
+      { 0x0A3a, new IoXmegaTc::CcBufL(*this, _tcE0, 1) },
+      { 0x0A3b, new IoXmegaTc::CcBufH(*this, _tcE0, 1) },
+      { 0x0A3c, new IoXmegaTc::CcBufL(*this, _tcE0, 2) },
+      { 0x0A3d, new IoXmegaTc::CcBufH(*this, _tcE0, 2) },
+      { 0x0A3e, new IoXmegaTc::CcBufL(*this, _tcE0, 3) },
+      { 0x0A3f, new IoXmegaTc::CcBufH(*this, _tcE0, 3) },
 
       { 0x0A80, new IoRegisterNotImplemented(*this, "AWEXE_CTRL") }, // Advanced Waveform Extension on port E
       { 0x0A82, new IoRegisterNotImplemented(*this, "AWEXE_FDEMASK") },
@@ -4,10 +4,15 @@
 
 #include <stdio.h>
 #include <algorithm>
+#include <iterator>
+#include <mutex>
+#include <string.h>
+#include <sys/time.h>
 
 #include "avr.h"
 #include "instr.h"
 #include "filter.h"
+#include "trace.h"
 
 namespace AVR
 {
@@ -46,6 +51,39 @@ namespace AVR
     return a ;
   }
 
+  ////////////////////////////////////////////////////////////////////////////////
+  // VerboseEvent
+
+  std::string VerboseEvent::Text() const
+  {
+    char buff[80] ;
+    char *ptr = buff ;
+    
+    switch (_type)
+    {
+    case VerboseEventType::EepromRead:
+    case VerboseEventType::EepromWrite:
+      ptr += sprintf(ptr, "EEPROM %s at %05x: %04x %02x", (_type == VerboseEventType::EepromRead) ? "read" : "write", _pc, _addr, _value) ;
+      if ((' ' < _value) && (_value <= '~'))
+        ptr += sprintf(ptr, " %c", _value) ;
+      ptr += sprintf(ptr, "\n") ;
+      break ;
+    case VerboseEventType::IllegalEepromRead:        sprintf(buff, "illegal eeprom read at %05x: %04x\n", _pc, _addr) ; break ;
+    case VerboseEventType::IllegalEepromWrite:       sprintf(buff, "illegal eeprom write at %05x: %05x, %02x\n", _pc, _addr, _value) ; break ;
+    case VerboseEventType::IllegalIoRead:            sprintf(buff, "illegal IO Register read at %05x: 0x%02x\n", _pc, _addr) ; break ;
+    case VerboseEventType::IllegalIoWrite:           sprintf(buff, "illegal IO Register write at %05x: 0x%02x\n", _pc, _addr) ; break ;
+    case VerboseEventType::IllegalRamRead:           sprintf(buff, "illegal RAM read at %05x: %04x\n", _pc, _addr) ; break ;
+    case VerboseEventType::IllegalRamWrite:          sprintf(buff, "illegal RAM write at %05x: %05x, %02x\n", _pc, _addr, _value) ; break ;
+    case VerboseEventType::IllegalDataRead:          sprintf(buff, "illegal data read at %05x: %04x\n", _pc, _addr) ; break ;
+    case VerboseEventType::IllegalDataWrite:         sprintf(buff, "illegal data write at %05x: %04x %02x\n", _pc, _addr, _value) ; break ;
+    case VerboseEventType::UninitializedProgramRead: sprintf(buff, "uninitialized program memory read at %05x: %05x\n", _pc, _addr) ; break ;
+    case VerboseEventType::InvalidProgramRead:       sprintf(buff, "invalid program memory read at %05x\n", _addr) ; break ;
+    case VerboseEventType::InvalidProgramWrite:      sprintf(buff, "invalid program memory write at %05x: %05x %04x\n", _pc, _addr, _value) ; break ;
+    }
+
+    return std::string(buff) ;
+  }
+
   ////////////////////////////////////////////////////////////////////////////////
   // Instruction
   Instruction::Instruction(Command pattern, Command mask, const std::string &mnemonic, const std::string &description, bool isTwoWord, bool isJump, bool isBranch, bool isCall, bool isReturn) : _pattern(pattern), _mask(mask), _mnemonic(mnemonic), _description(description), _size(isTwoWord?2:1), _isJump(isJump), _isBranch(isBranch), _isCall(isCall), _isReturn(isReturn)
@@ -82,18 +120,33 @@ namespace AVR
   Mcu::Mcu(const std::string &name, uint32_t flashSize, uint32_t ioSize, uint32_t ramSize, uint32_t eepromSize, uint32_t sp)
     : _name(name),
       _pc(0), _sp(sp),
-      _ticks(0),
-      _flashSize(flashSize), _loadedFlashSize(0), _flash(_flashSize),
+      _ticks(0), _tickLimit(UINT64_MAX), _nextEvent(UINT64_MAX), _eventSeq(0), _eventsStale(0),
+      _irqPending(), _irqSources(), _irqReady(0), _irqVectorSize(1),
+      _flashSize(flashSize), _loadedFlashSize(0), _image(BlankImage(_flashSize)), _imageShared(true),
+      _flash(_image->_flash.data()), _decoded(_image->_decoded.data()),
+      _blocksDirty(true), // _blockIdx and _idleLoops sized on first use
+      _leaveBlock(false),
       _ioSize(ioSize), _io(_ioSize),
-      _ramSize(ramSize), _ram(_ramSize),
+      _ramSize(ramSize), _ramAddr(0), _ram(_ramSize, 0x00),
       _eepromSize(eepromSize), _eeprom(_eepromSize, 0xff),
-      _instructions(0x10000),
+      _history(), _historyPos(0),
+      _xrefTable(std::make_shared<XrefTable>()), _xrefsShared(false),
+      _filterVerbose(VerboseType::None),
       _trace(*this),
-      _verbose(VerboseType::None)
+      _profile(*this),
+      _callGraph(*this),
+      _sampler(*this),
+      _coverage(*this),
+      _verbose(VerboseType::None),
+      _engine(EngineType::Reference),
+      _executing(false), _progErrors(0), _progErrorStop(nullptr)
   {
     _pcIs22Bit     = false ;
     _isXMega       = false ;
     _isTinyReduced = false ;
+
+    SetInstructions(std::vector<const Instruction*>()) ;
+    MapRam(0x20 + _ioSize) ;
   }
 
   Mcu::~Mcu()
@@ -101,14 +154,316 @@ namespace AVR
     for (auto iIo : _io)
       if (iIo)
         delete (iIo) ;
-    for (auto iXref : _xrefs)
-      delete iXref ;
 
     for (auto iF : _filters)
       delete iF ;
   }
 
+  // single step of the fast and block engines: predecoded handler called directly, no tracing (see Execute())
+  inline void Mcu::ExecuteFast()
+  {
+    uint32_t pc0 = _pc ;
+    if ((pc0 >= _loadedFlashSize) || !_decoded[pc0]._fct) // error reporting
+    {
+      ExecuteReference() ;
+      return ;
+    }
+
+    const Decoded &dec = _decoded[pc0] ;
+    const Instruction *instr = dec._instr ;
+    Instruction::ExecuteFct fct = dec._fct ;
+    Operands op = dec._operands ; // SPM may move _decoded
+    uint32_t pcNext = pc0 + dec._size ;
+    uint16_t sp0 = _sp() ;
+    uint8_t irq0 = _irqReady & _sreg.Get() ; // not after SEI / RETI
+    uint64_t ticks0 = _ticks ;
+    _pc = pc0 + 1 ;
+
+    _ticks += fct(*this, op) ;
+    if (_profile())
+      _profile.Add(pc0, _ticks - ticks0) ;
+    if (_coverage())
+      _coverage.Add(pc0, _pc == pcNext) ;
+
+    if (_pc != pcNext) // call / jump / return
+      ExecuteDone(pc0, sp0, *instr) ;
+
+    if (_ticks >= _nextEvent)
+      Events() ;
+
+    if (irq0 && (_irqReady & _sreg.Get()))
+      Interrupt() ;
+  }
+
   void Mcu::Execute()
+  {
+    bool executing = _executing ; // also called by Run()
+    _executing = true ;
+
+    if ((_engine != EngineType::Reference) && !_trace())
+      ExecuteFast() ;
+    else
+      ExecuteReference() ;
+
+    _executing = executing ;
+  }
+
+  uint64_t Mcu::Run(uint64_t count, const volatile bool &stop, uint32_t stopAddr)
+  {
+    uint64_t n = 0 ;
+    _executing = true ;
+
+    if (_sampler())
+      _sampler.Arm() ;
+
+    if ((_engine == EngineType::Block) && !_trace())
+      n = RunBlocks(count, stop, stopAddr) ;
+    else if ((_engine != EngineType::Reference) && !_trace())
+      n = RunThreaded(count, stop, stopAddr) ;
+    else
+    {
+      while ((n < count) && !stop && (_ticks < _tickLimit))
+      {
+        ExecuteReference() ;
+        ++n ;
+        if ((_pc == stopAddr) || IsBreakpoint())
+          break ;
+      }
+    }
+
+    if (_sampler())
+      _sampler.Disarm() ;
+
+    for (AVR::Io *iPeripheral : _peripherals) // buffered output, e.g. USART sinks
+      iPeripheral->Flush() ;
+
+    _executing = false ;
+    return n ;
+  }
+
+  uint64_t Mcu::RunBlocks(uint64_t count, const volatile bool &stop, uint32_t stopAddr)
+  {
+    uint64_t n = 0 ;
+
+    while ((n < count) && !stop && (_ticks < _tickLimit))
+    {
+      const Block *block = FindBlock(_pc) ;
+      uint32_t pc0 = _pc ;
+
+      // a whole block only if no event, tick limit, interrupt or stop address can fall inside it
+      if (!block || (block->_code.size() > count - n) || _irqReady || _profile() || _coverage() ||
+          (_ticks + block->_maxTicks >= _nextEvent) || (_ticks + block->_maxTicks >= _tickLimit) ||
+          ((pc0 < stopAddr) && (stopAddr < block->_end)))
+      {
+        ExecuteFast() ;
+        ++n ;
+      }
+      else
+      {
+        _leaveBlock = false ;
+        for (const Decoded &dec : block->_code)
+        {
+          pc0 = _pc ;
+          uint32_t pcNext = pc0 + dec._size ;
+          _pc = pc0 + 1 ;
+
+          _ticks += dec._fct(*this, dec._operands) ;
+          ++n ;
+
+          if (_pc != pcNext) // call / jump / return / skip
+          {
+            uint16_t sp0 = _sp() + (_pcIs22Bit ? 3 : 2) ; // used by calls only: SP before the return address
+            ExecuteDone(pc0, sp0, *dec._instr) ;
+            break ;
+          }
+          if (_leaveBlock || _blocksDirty)
+            break ;
+        }
+        if (_ticks >= _nextEvent) // rescheduled by the block
+          Events() ;
+      }
+
+      if ((_pc < pc0) && (n < count)) // backward jump
+        n += IdleLoop(pc0, count - n, stopAddr) ;
+      if ((_pc == stopAddr) || ((_pc < _flashSize) && _decoded[_pc]._break))
+        break ;
+    }
+
+    return n ;
+  }
+
+  const Mcu::Block* Mcu::FindBlock(uint32_t addr)
+  {
+    if (_blocksDirty)
+      DropTranslations() ;
+
+    if (addr >= _loadedFlashSize)
+      return nullptr ;
+
+    uint32_t idx = _blockIdx[addr] ;
+    if (idx)
+      return &_blocks[idx-1] ;
+
+    Block block ;
+    block._maxTicks = 0 ;
+    for (block._end = addr ; (block._end < _loadedFlashSize) && (block._code.size() < 64) ; )
+    {
+      const Decoded &dec = _decoded[block._end] ;
+      const Instruction *instr = dec._instr ;
+      if (!dec._fct || (dec._break && (block._end != addr)) ||
+          (instr == &instrSLEEP) || (instr == &instrSPM1) || (instr == &instrSPM2)) // time not bounded
+        break ;
+      block._code.push_back(dec) ;
+      block._maxTicks += kMaxInstrTicks ;
+      block._end += dec._size ;
+      if (instr->IsJump() || instr->IsBranch() || instr->IsCall() || instr->IsReturn())
+        break ;
+    }
+    if (block._code.empty())
+      return nullptr ;
+
+    _blocks.push_back(block) ;
+    _blockIdx[addr] = _blocks.size() ;
+    return &_blocks.back() ;
+  }
+
+  void Mcu::DropTranslations()
+  {
+    _blockIdx.assign(_flashSize, 0) ;
+    _blocks.clear() ;
+    _idleLoops.assign(_flashSize, IdleUnknown) ;
+    _blocksDirty = false ;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // busy wait loops (fast and block engine)
+  // a short loop closed by a backward RJMP / BRBS / BRBC which only reads I/O registers
+  // polled by time (Io::Register::Polled()), RAM and registers, compares and branches.
+  // One iteration is executed, if it ends in the state it started from all following
+  // iterations until a polled register or a scheduled event changes are skipped at once.
+
+  uint64_t Mcu::IdleLoop(uint32_t branch, uint64_t count, uint32_t stopAddr)
+  {
+    uint32_t head = _pc ;
+    if ((branch - head >= kIdleLoopSize) || (branch >= _loadedFlashSize) || (_ticks >= _tickLimit))
+      return 0 ;
+
+    const Decoded &dec = _decoded[branch] ;
+    uint32_t target ;
+    if ((dec._instr == &instrRJMP) || (dec._instr == &instrBRBS) || (dec._instr == &instrBRBC))
+      target = branch + 1 + (int16_t)dec._operands._k ;
+    else
+      return 0 ;
+    if (target != head) // interrupt taken
+      return 0 ;
+
+    if (_blocksDirty)
+      DropTranslations() ;
+    uint8_t &idle = _idleLoops[branch] ;
+    if (idle == IdleUnknown)
+      idle = IdleLoopBody(head, branch) ? IdleBody : IdleNo ;
+    if ((idle != IdleBody) || (count < 2 * kIdleLoopSize) || (_irqReady & _sreg.Get()))
+      return 0 ;
+    for (uint32_t pc = head ; pc <= branch ; ++pc)
+    {
+      if (_decoded[pc]._break || (pc == stopAddr))
+        return 0 ;
+    }
+
+    uint64_t until ;
+    if (!IdleLoopUntil(head, branch, until))
+      return 0 ;
+    until = std::min(until, _tickLimit) ;
+
+    // one iteration
+    uint8_t  reg[0x20] ;
+    uint8_t  sreg   = _sreg.Get() ;
+    uint16_t sp     = _sp() ;
+    uint64_t ticks0 = _ticks ;
+    uint64_t next0  = _nextEvent ;
+    uint64_t n      = 0 ;
+    uint64_t profCount[kIdleLoopSize], profTicks[kIdleLoopSize] ;
+    memcpy(reg, _reg, sizeof(reg)) ;
+    if (_profile())
+      _profile.Get(head, branch, profCount, profTicks) ;
+    while (true)
+    {
+      uint32_t pc0 = _pc ;
+      ExecuteFast() ;
+      ++n ;
+      if ((pc0 == branch) && (_pc == head))
+        break ;
+      if ((_pc < head) || (branch < _pc) || (_nextEvent != next0) || (n > kIdleLoopSize))
+        return n ; // left the loop, event or interrupt
+    }
+    if ((_sreg.Get() != sreg) || (_sp() != sp) || memcmp(reg, _reg, sizeof(reg)) || (_ticks >= until))
+      return n ;
+
+    // skip iterations, the last one ends before until
+    uint64_t ticks = _ticks - ticks0 ;
+    uint64_t skip  = std::min((until - _ticks - 1) / ticks, (count - n) / n) ;
+    _ticks += skip * ticks ;
+    if (_profile())
+      _profile.Repeat(head, branch, profCount, profTicks, skip) ;
+    return n + skip * n ;
+  }
+
+  bool Mcu::IdleLoopBody(uint32_t head, uint32_t branch) const
+  {
+    static const std::set<const Instruction*> instructions
+    {
+      &instrIN, &instrLDS, &instrSBIS, &instrSBIC, &instrSBRS, &instrSBRC, &instrCPSE,
+      &instrCP, &instrCPC, &instrCPI, &instrAND, &instrANDI, &instrOR, &instrORI, &instrEOR,
+      &instrMOV, &instrMOVW, &instrLDI, &instrNOP, &instrBRBS, &instrBRBC, &instrRJMP,
+    } ;
+
+    for (uint32_t pc = head ; pc <= branch ; pc += _decoded[pc]._size)
+    {
+      if (instructions.find(_decoded[pc]._instr) == instructions.end())
+        return false ;
+    }
+
+    uint64_t until ;
+    return IdleLoopUntil(head, branch, until) ;
+  }
+
+  // until: no polled I/O register of the loop changes and no event is due before
+  bool Mcu::IdleLoopUntil(uint32_t head, uint32_t branch, uint64_t &until) const
+  {
+    until = _nextEvent ;
+    for (uint32_t pc = head ; pc <= branch ; pc += _decoded[pc]._size)
+    {
+      const Decoded &dec = _decoded[pc] ;
+      bool isIo = true ;
+      uint32_t io = 0 ;
+      if ((dec._instr == &instrIN) || (dec._instr == &instrSBIS) || (dec._instr == &instrSBIC))
+        io = dec._operands._k ;
+      else if (dec._instr == &instrLDS)
+      {
+        uint32_t addr = GetRampD() | _flash[pc+1] ;
+        if (_isXMega ? (addr < _ioSize) : ((0x20 <= addr) && (addr < 0x20 + _ioSize)))
+          io = _isXMega ? addr : addr - 0x20 ;
+        else if (InRam(addr) || (!_isXMega && (addr < 0x20)))
+          isIo = false ;
+        else
+          return false ;
+      }
+      else
+        isIo = false ;
+
+      if (isIo)
+      {
+        uint64_t ioUntil ;
+        const Io::Register *ioReg = _io[io] ;
+        if (!ioReg || !ioReg->Polled(ioUntil))
+          return false ;
+        until = std::min(until, ioUntil) ;
+      }
+    }
+    return true ;
+  }
+
+  void Mcu::ExecuteReference()
   {
     if (_pc >= _flashSize)
     {
@@ -119,16 +474,24 @@ namespace AVR
       return ;
     }
 
-    if (_pc >= _loadedFlashSize)
+    Command cmd ;
+    const Instruction *instr ;
+
+    if (_pc < _loadedFlashSize)
+    {
+      const Decoded &dec = _decoded[_pc] ;
+      cmd   = dec._cmd ;
+      instr = dec._instr ;
+    }
+    else
     {
       char buff[80] ;
       snprintf(buff, sizeof(buff), "uninitialized program memory read at %05x\n", _pc) ;
       Verbose(VerboseType::ProgError, buff) ;
+      cmd   = 0x9508 ;
+      instr = (*_instructions)[cmd] ;
     }
     
-    Command cmd = (_pc < _loadedFlashSize) ? _flash[_pc] : 0x9508 ;
-    const Instruction *instr = _instructions[cmd] ;
-    
     if (!instr)
     {
       char buff[80] ;
@@ -141,21 +504,24 @@ namespace AVR
     uint32_t pc0 = _pc ;
     uint32_t pcNext = _pc + instr->Size() ;
     uint16_t sp0 = _sp() ;
+    uint8_t irq0 = _irqReady & _sreg.Get() ; // not after SEI / RETI
+    uint64_t ticks0 = _ticks ;
     _pc += 1 ;
     
     _ticks += instr->Execute(*this, cmd) ;
+    if (_profile())
+      _profile.Add(pc0, _ticks - ticks0) ;
+    if (_coverage())
+      _coverage.Add(pc0, _pc == pcNext) ;
 
     if (_pc != pcNext) // call / jump / return
-    {
-      if (instr->IsCall())
-        _stackFrames.push_back(StackFrame(sp0, _pc)) ;
+      ExecuteDone(pc0, sp0, *instr) ;
 
-      if (instr->IsReturn() && !_stackFrames.empty())
-        _stackFrames.pop_back() ;
+    if (_ticks >= _nextEvent)
+      Events() ;
 
-      if (_trace())
-        _trace.Add(pc0, _pc, *instr) ;
-    }
+    if (irq0 && (_irqReady & _sreg.Get()))
+      Interrupt() ;
 
     if (_trace() && (_pc == _trace.StopAddr()))
     {
@@ -164,6 +530,215 @@ namespace AVR
     }
   }
 
+  void Mcu::ExecuteDone(uint32_t pc0, uint16_t sp0, const Instruction &instr)
+  {
+    if (&instr == &instrSLEEP) // still sleeping, or woken by Interrupt() which did the bookkeeping
+      return ;
+
+    Branch &branch = _history[_historyPos++ % kHistorySize] ;
+    branch._src   = pc0 ;
+    branch._dst   = _pc ;
+    branch._ticks = _ticks ;
+
+    if (instr.IsCall())
+    {
+      _stackFrames.push_back(StackFrame(sp0, _pc)) ;
+      if (_callGraph())
+        _callGraph.Call(pc0, _pc) ;
+      if (_sampler())
+        _sampler.Frames(_stackFrames) ;
+    }
+
+    if (instr.IsReturn() && !_stackFrames.empty())
+    {
+      _stackFrames.pop_back() ;
+      if (_callGraph())
+        _callGraph.Return(pc0) ;
+      if (_sampler())
+        _sampler.Frames(_stackFrames) ;
+    }
+
+    if (_trace())
+      _trace.Add(pc0, _pc, instr) ;
+
+    if (_sampler()) // every loop passes here, Run() may outlast the ring
+      _sampler.Poll() ;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // event scheduler
+  // rescheduling and unscheduling leave the old heap entry in place (lazy deletion),
+  // an entry is live while _eventSeqs holds its _seq for the io / id.
+  // Stale entries are dropped from the top and once they outnumber the live ones.
+
+  bool Mcu::EventLater(const ScheduledEvent &a, const ScheduledEvent &b)
+  {
+    return (a._ticks != b._ticks) ? (a._ticks > b._ticks) : (a._seq > b._seq) ;
+  }
+
+  bool Mcu::EventLive(const ScheduledEvent &event) const
+  {
+    auto iSeq = _eventSeqs.find(std::make_pair(event._io, event._id)) ;
+    return (iSeq != _eventSeqs.end()) && (iSeq->second == event._seq) ;
+  }
+
+  void Mcu::Schedule(uint64_t ticks, AVR::Io *io, uint32_t id)
+  {
+    ScheduledEvent event ;
+    event._ticks = ticks ;
+    event._seq   = _eventSeq++ ;
+    event._io    = io ;
+    event._id    = id ;
+
+    auto iSeq = _eventSeqs.insert(std::make_pair(std::make_pair(io, id), event._seq)) ;
+    if (!iSeq.second) // replaces a scheduled event
+    {
+      iSeq.first->second = event._seq ;
+      _eventsStale++ ;
+    }
+
+    _events.push_back(event) ;
+    std::push_heap(_events.begin(), _events.end(), EventLater) ;
+    EventsTidy() ;
+  }
+
+  void Mcu::Unschedule(AVR::Io *io, uint32_t id)
+  {
+    if (!_eventSeqs.erase(std::make_pair(io, id)))
+      return ;
+
+    _eventsStale++ ;
+    EventsTidy() ;
+  }
+
+  void Mcu::EventsTidy()
+  {
+    if (_eventsStale > _eventSeqs.size() + 16)
+    {
+      _events.erase(std::remove_if(_events.begin(), _events.end(),
+                                   [this](const ScheduledEvent &event){ return !EventLive(event) ; }),
+                    _events.end()) ;
+      std::make_heap(_events.begin(), _events.end(), EventLater) ;
+      _eventsStale = 0 ;
+    }
+
+    while (!_events.empty() && !EventLive(_events.front()))
+    {
+      std::pop_heap(_events.begin(), _events.end(), EventLater) ;
+      _events.pop_back() ;
+      _eventsStale-- ;
+    }
+
+    uint64_t nextEvent = _events.empty() ? UINT64_MAX : _events.front()._ticks ;
+    if (nextEvent < _nextEvent)
+      _leaveBlock = true ;
+    _nextEvent = nextEvent ;
+  }
+
+  void Mcu::Events()
+  {
+    while (!_events.empty() && (_events.front()._ticks <= _ticks))
+    {
+      ScheduledEvent event = _events.front() ; // live, see EventsTidy()
+      std::pop_heap(_events.begin(), _events.end(), EventLater) ;
+      _events.pop_back() ;
+      _eventSeqs.erase(std::make_pair(event._io, event._id)) ;
+      EventsTidy() ;
+
+      event._io->Wakeup(event._id) ; // may schedule again
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // interrupts
+
+  void Mcu::Irq(uint32_t vector, bool request, AVR::Io *io, uint8_t level)
+  {
+    uint64_t &pending = _irqPending[vector / 64] ;
+    uint64_t  bit     = 1ULL << (vector % 64) ;
+
+    if (request)
+    {
+      if ((pending & bit) && (_irqSources[vector]._level == level))
+        return ;
+      pending |= bit ;
+      _irqSources[vector]._io    = io ;
+      _irqSources[vector]._level = level ;
+    }
+    else
+    {
+      if (!(pending & bit))
+        return ;
+      pending &= ~bit ;
+    }
+    IrqUpdate() ;
+  }
+
+  void Mcu::IrqUpdate()
+  {
+    uint32_t vector ;
+    _irqReady = IrqSelect(vector) ? (1 << (uint8_t)SREG::I) : 0 ;
+    if (_irqReady)
+      _leaveBlock = true ;
+  }
+
+  // classic AVR: lowest vector number first
+  bool Mcu::IrqSelect(uint32_t &vector) const
+  {
+    for (uint32_t iWord = 0 ; iWord < kIrqVectors / 64 ; ++iWord)
+    {
+      if (_irqPending[iWord])
+      {
+        vector = iWord * 64 + __builtin_ctzll(_irqPending[iWord]) ;
+        return true ;
+      }
+    }
+    return false ;
+  }
+
+  void Mcu::IrqEnter(uint32_t vector)
+  {
+    _sreg.Set(_sreg.Get() & ~(1 << (uint8_t)SREG::I)) ;
+  }
+
+  void Mcu::Reti()
+  {
+    _sreg.Set(_sreg.Get() | (1 << (uint8_t)SREG::I)) ;
+  }
+
+  void Mcu::Interrupt()
+  {
+    uint32_t vector ;
+    if (!IrqSelect(vector))
+    {
+      _irqReady = 0 ;
+      return ;
+    }
+
+    uint16_t sp0 = _sp() ;
+    uint32_t pc0 = _pc ;
+    PushPC() ;
+    _pc = vector * _irqVectorSize ;
+    _ticks += (_pcIs22Bit || _isXMega) ? 5 : 4 ;
+    Branch &branch = _history[_historyPos++ % kHistorySize] ;
+    branch._src   = pc0 | kBranchIrq ;
+    branch._dst   = _pc ;
+    branch._ticks = _ticks ;
+    _stackFrames.push_back(StackFrame(sp0, _pc)) ; // popped by RETI
+    if (_trace())
+      _trace.Add(pc0, _pc, instrCALL) ; // traced like a call, RETI is the return
+    if (_callGraph())
+      _callGraph.Call(pc0, _pc) ;
+    if (_sampler())
+      _sampler.Frames(_stackFrames) ;
+
+    IrqEnter(vector) ;
+    AVR::Io *io = _irqSources[vector]._io ;
+    if (io)
+      io->Acknowledge(vector) ; // flags cleared by hardware
+    IrqUpdate() ;
+  }
+
   void StatusBytes(const Mcu &mcu, uint32_t addr)
   {
     for (unsigned int i = 0 ; i < 0x10 ; ++i)
@@ -259,19 +834,18 @@ namespace AVR
       return 0 ;
     }
 
-    Command cmd = _flash[_pc] ;
-    const Instruction *instr = _instructions[cmd] ;
+    const Decoded &dec = _decoded[_pc] ;
 
-    if (!instr)
+    if (!dec._instr)
     {
       char buff[80] ;
-      snprintf(buff, sizeof(buff), "illegal instruction at %05x: %04x\n", _pc, cmd) ;
+      snprintf(buff, sizeof(buff), "illegal instruction at %05x: %04x\n", _pc, dec._cmd) ;
       Verbose(VerboseType::ProgError, buff) ;
       _pc = 0 ;
       return 0 ;
     }
 
-    uint8_t size = instr->Size() ;
+    uint8_t size = dec._size ;
     _pc += size ;
     return size ;
   }
@@ -300,8 +874,8 @@ namespace AVR
     Command cmd = _flash[_pc++] ;
 
     std::string label ;
-    auto iXrefs = _xrefByAddr.find(pc) ;
-    if (iXrefs != _xrefByAddr.end())
+    auto iXrefs = _xrefTable->_xrefByAddr.find(pc) ;
+    if (iXrefs != _xrefTable->_xrefByAddr.end())
     {
       const auto xref = iXrefs->second ;
 
@@ -337,7 +911,7 @@ namespace AVR
       }
     }
 
-    const Instruction *instr = _instructions[cmd] ;
+    const Instruction *instr = (*_instructions)[cmd] ;
     
     char buff[32] ;
     std::string str ;
@@ -377,8 +951,8 @@ namespace AVR
 
   bool Mcu::ProgAddrName(uint32_t addr, std::string &name) const
   {
-    auto iProgAddrName = _xrefByAddr.find(addr) ;
-    if (iProgAddrName == _xrefByAddr.end())
+    auto iProgAddrName = _xrefTable->_xrefByAddr.find(addr) ;
+    if (iProgAddrName == _xrefTable->_xrefByAddr.end())
       return false ;
 
     name = iProgAddrName->second->Label() ;
@@ -399,30 +973,12 @@ namespace AVR
     return cmd ;
   }
 
-  uint8_t  Mcu::Reg(uint32_t reg) const
-  {
-    return _reg[reg] ;
-  }
-  void   Mcu::Reg(uint32_t reg, uint8_t value)
-  {
-    _reg[reg] = value ;
-  }
-  uint16_t Mcu::RegW(uint32_t reg) const
-  {
-    return *(uint16_t*)(_reg + reg) ;
-  }
-  void   Mcu::RegW(uint32_t reg, uint16_t value)
-  {
-    *(uint16_t*)(_reg + reg) = value ;
-  }
   uint8_t  Mcu::Io(uint32_t io) const
   {
     Io::Register *ioReg = _io[io] ;
     if (!ioReg)
     {
-      char buff[80] ;
-      snprintf(buff, sizeof(buff), "illegal IO Register read at %05x: 0x%02x\n", _pc, io) ;
-      Verbose(VerboseType::DataError, buff) ;
+      Verbose(VerboseEvent(VerboseEventType::IllegalIoRead, _pc, io)) ;
       return 0xff ;
     }
     return ioReg->Get() ;
@@ -443,9 +999,7 @@ namespace AVR
     Io::Register *ioReg = _io[io] ;
     if (!ioReg)
     {
-      char buff[80] ;
-      snprintf(buff, sizeof(buff), "illegal IO Register write at %05x: 0x%02x\n", _pc, io) ;
-      Verbose(VerboseType::DataError, buff) ;
+      Verbose(VerboseEvent(VerboseEventType::IllegalIoWrite, _pc, io)) ;
       return ;
     }
     ioReg->Set(value) ;
@@ -456,9 +1010,7 @@ namespace AVR
     if (addr < _ramSize)
       return _ram[addr] ;
 
-    char buff[80] ;
-    snprintf(buff, sizeof(buff), "illegal RAM read at %05x: %04x\n", _pc, addr) ;
-    Verbose(VerboseType::DataError, buff) ;
+    Verbose(VerboseEvent(VerboseEventType::IllegalRamRead, _pc, addr)) ;
     return 0xff ;
   }
 
@@ -466,37 +1018,25 @@ namespace AVR
   {
     if (addr < _ramSize)
     {
-      _ram[addr] = value ;
+      if (_ram.Set(addr, value))
+        MapPages() ;
       return ;
     }
 
-    char buff[80] ;
-    snprintf(buff, sizeof(buff), "illegal RAM write at %05x: %05x, %02x\n", _pc, addr, value) ;
-    Verbose(VerboseType::DataError, buff) ;
+    Verbose(VerboseEvent(VerboseEventType::IllegalRamWrite, _pc, addr, value)) ;
   }
 
   void Mcu::Eeprom(uint32_t address, uint8_t value, bool resetOnError)
   {
     if (address >= _eepromSize)
     {
-      char buff[80] ;
-      snprintf(buff, sizeof(buff), "illegal eeprom write at %05x: %05x, %02x\n", _pc, address, value) ;
-      Verbose(VerboseType::DataError, buff) ;
+      Verbose(VerboseEvent(VerboseEventType::IllegalEepromWrite, _pc, address, value)) ;
       address %= _eepromSize ;
     }
 
-    {
-      char buff[1024] ;
-      char *ptr = buff ;
-      
-      ptr += sprintf(ptr, "EEPROM write at %05x: %04x %02x", _pc, address, value) ;
-      if ((' ' < value) && (value <= '~'))
-        ptr += sprintf(ptr, " %c", value) ;
-      ptr += sprintf(ptr, "\n") ;
-      Verbose(VerboseType::Eeprom, buff) ;
-    }
+    Verbose(VerboseEvent(VerboseEventType::EepromWrite, _pc, address, value)) ;
       
-    _eeprom[address] = value ;
+    _eeprom.Set(address, value) ;
     return ;
   }
   
@@ -504,24 +1044,13 @@ namespace AVR
   {
     if (address >= _eepromSize)
     {
-      char buff[80] ;
-      snprintf(buff, sizeof(buff), "illegal eeprom read at %05x: %04x\n", _pc, address) ;
-      Verbose(VerboseType::DataError, buff) ;
+      Verbose(VerboseEvent(VerboseEventType::IllegalEepromRead, _pc, address)) ;
       address %= _eepromSize ;
     }
 
     uint8_t v = _eeprom[address] ;
       
-    {
-      char buff[1024] ;
-      char *ptr = buff ;
-      
-      ptr += sprintf(ptr, "EEPROM read at %05x: %04x %02x", _pc, address, v) ;
-      if ((' ' < v) && (v <= '~'))
-        ptr += sprintf(ptr, " %c", v) ;
-      ptr += sprintf(ptr, "\n") ;
-      Verbose(VerboseType::Eeprom, buff) ;
-    }
+    Verbose(VerboseEvent(VerboseEventType::EepromRead, _pc, address, v)) ;
 
     return v ;
   }  
@@ -532,17 +1061,9 @@ namespace AVR
       return _flash[addr] ;
 
     if (addr < _flashSize)
-    {
-      char buff[80] ;
-      snprintf(buff, sizeof(buff), "uninitialized program memory read at %05x: %05x\n", _pc, addr) ;
-      Verbose(VerboseType::ProgError, buff) ;
-    }
+      Verbose(VerboseEvent(VerboseEventType::UninitializedProgramRead, _pc, addr)) ;
     else
-    {
-      char buff[80] ;
-      snprintf(buff, sizeof(buff), "invalid program memory read at %05x\n", addr) ;
-      Verbose(VerboseType::ProgError, buff) ;
-    }
+      Verbose(VerboseEvent(VerboseEventType::InvalidProgramRead, _pc, addr)) ;
     
     return 0xffff ;
   }
@@ -551,16 +1072,16 @@ namespace AVR
   {
     if (addr < _flashSize)
     {
+      UniqueImage() ;
       _flash[addr] = cmd ;
+      Decode(addr) ;
       return ;
     }
 
-    char buff[80] ;
-    snprintf(buff, sizeof(buff), "invalid program memory write at %05x: %05x %04x\n", _pc, addr, cmd) ;
-    Verbose(VerboseType::ProgError, buff) ;
+    Verbose(VerboseEvent(VerboseEventType::InvalidProgramWrite, _pc, addr, cmd)) ;
   }
 
-  uint8_t  Mcu::Data(uint32_t addr, bool resetOnError) const
+  uint8_t  Mcu::DataSpace(uint32_t addr, bool resetOnError) const
   {
     if (addr < 0x20)
     {
@@ -570,20 +1091,18 @@ namespace AVR
     {
       return Io(addr - 0x20) ;
     }
-    else if (addr <= (0x20 + _ioSize + _ramSize))
+    else if (addr < (0x20 + _ioSize + _ramSize))
     {
       return _ram[addr - 0x20 - _ioSize] ;
     }
 
-    char buff[80] ;
-    snprintf(buff, sizeof(buff), "illegal data read at %05x: %04x\n", _pc, addr) ;
-    Verbose(VerboseType::DataError, buff) ;
+    Verbose(VerboseEvent(VerboseEventType::IllegalDataRead, _pc, addr)) ;
     //if (resetOnError)
     //  const_cast<Mcu*>(this)->_pc = 0 ;
     return 0xff ;
   }
 
-  bool Mcu::Data(uint32_t addr, uint8_t &byte) const
+  bool Mcu::DataSpace(uint32_t addr, uint8_t &byte) const
   {
     if (addr < 0x20)
     {
@@ -595,7 +1114,7 @@ namespace AVR
       byte = Io(addr - 0x20) ;
       return true ;
     }
-    else if (addr <= (0x20 + _ioSize + _ramSize))
+    else if (addr < (0x20 + _ioSize + _ramSize))
     {
       byte = _ram[addr - 0x20 - _ioSize] ;
       return true ;
@@ -604,7 +1123,7 @@ namespace AVR
     return false ;
   }
   
-  void Mcu::Data(uint32_t addr, uint8_t value, bool resetOnError)
+  void Mcu::DataSpace(uint32_t addr, uint8_t value, bool resetOnError)
   {
     if (addr < 0x20)
     {
@@ -616,27 +1135,43 @@ namespace AVR
       Io(addr - 0x20, value) ;
       return ;
     }
-    else if (addr <= (0x20 + _ioSize + _ramSize))
+    else if (addr < (0x20 + _ioSize + _ramSize))
     {
-      _ram[addr - 0x20 - _ioSize] = value ;
+      Ram(addr - 0x20 - _ioSize, value) ;
       return ;
     }
 
-    char buff[80] ;
-    snprintf(buff, sizeof(buff), "illegal data write at %05x: %04x %02x\n", _pc, addr, value) ;
-    Verbose(VerboseType::DataError, buff) ;
+    Verbose(VerboseEvent(VerboseEventType::IllegalDataWrite, _pc, addr, value)) ;
     //if (resetOnError)
     //  _pc = 0 ;
   }
 
-  Command  Mcu::Program(uint32_t addr) const
-  {
-    return Flash(addr) ;
-  }
-  
-  void Mcu::Program(uint32_t addr, Command cmd)
+  void Mcu::MapRam(uint32_t addr)
   {
-    Flash(addr, cmd) ;
+    _ramAddr = addr ;
+    _ram.Origin(addr) ;
+    MapPages() ;
+  }
+
+  void Mcu::MapPages()
+  {
+    for (uint32_t page = 0 ; page < 0x100 ; ++page)
+    {
+      uint32_t pageAddr = page << 8 ;
+      bool     isRam    = (_ramAddr <= pageAddr) && (pageAddr + 0x100 <= _ramAddr + _ramSize) ;
+      _dataPages[page] = isRam ? _ram.Read (page - (_ramAddr >> 8)) : nullptr ;
+      _dataWrite[page] = isRam ? _ram.Write(page - (_ramAddr >> 8)) : nullptr ;
+    }
+  }
+
+  Command  Mcu::Program(uint32_t addr) const
+  {
+    return Flash(addr) ;
+  }
+  
+  void Mcu::Program(uint32_t addr, Command cmd)
+  {
+    Flash(addr, cmd) ;
   }
 
   bool Mcu::InRam(uint32_t addr) const
@@ -653,13 +1188,13 @@ namespace AVR
   const Instruction* Mcu::Instr(uint32_t addr) const
   {
     Command cmd = Flash(addr) ;
-    return _instructions[cmd] ;
+    return (*_instructions)[cmd] ;
   }
   
   void  Mcu::Push(uint8_t value)
   {
     uint16_t sp = _sp() ;
-    if (!InRam(sp))
+    if (!_dataPages[sp >> 8] && !InRam(sp))
     {
       char buff[80] ;
       snprintf(buff, sizeof(buff), "stack underflow at %05x\n", _pc) ;
@@ -673,7 +1208,7 @@ namespace AVR
   uint8_t Mcu::Pop()
   {
     uint16_t sp = _sp() + 1 ;
-    if (!InRam(sp))
+    if (!_dataPages[sp >> 8] && !InRam(sp))
     {
       char buff[80] ;
       snprintf(buff, sizeof(buff), "stack overflow at %05x\n", _pc) ;
@@ -705,9 +1240,40 @@ namespace AVR
     // todo
   }
 
+  // SLEEP: skip to the next scheduled event until an interrupt wakes the MCU
   void Mcu::Sleep()
   {
-    // todo
+    if (!_sleep.Enabled())
+      return ;
+
+    uint8_t mode = _sleep.Mode() ;
+    auto awake = [this, mode]() -> bool
+    {
+      uint32_t vector ;
+      if (!_irqReady || !IrqSelect(vector))
+        return false ;
+      const AVR::Io *io = _irqSources[vector]._io ;
+      return !io || io->Awake(mode) ;
+    } ;
+
+    if (!awake())
+    {
+      uint64_t wakeup = std::min(_nextEvent, _tickLimit) ;
+      if (wakeup != UINT64_MAX)
+      {
+        if (_ticks < wakeup)
+          _ticks = wakeup ;
+        Events() ;
+      }
+      if (!awake())
+      {
+        _pc -= 1 ; // keep sleeping, SLEEP is executed again
+        return ;
+      }
+    }
+
+    if (_irqReady & _sreg.Get())
+      Interrupt() ;
   }
 
   void Mcu::WDR()
@@ -725,13 +1291,12 @@ namespace AVR
 
   void Mcu::ClearFlash()
   {
-    for (auto &iPrg :_flash)
+    UniqueImage() ;
+    for (auto &iPrg : _image->_flash)
       iPrg = 0 ;
-    for (auto iXref : _xrefs)
-      delete iXref ;
-    _xrefs.clear() ;
-    _xrefByAddr.clear() ;
-    _xrefByLabel.clear() ;
+    Decode() ;
+    _xrefTable   = std::make_shared<XrefTable>() ;
+    _xrefsShared = false ;
   }
 
   uint32_t Mcu::SetFlash(uint32_t startAddress, const std::vector<Command> &prg)
@@ -748,8 +1313,10 @@ namespace AVR
       nCopy = _flashSize - startAddress ;
     }
 
-    std::copy(prg.begin(), prg.begin()+nCopy, _flash.begin()+startAddress) ;
+    UniqueImage() ;
+    std::copy(prg.begin(), prg.begin()+nCopy, _flash+startAddress) ;
     _loadedFlashSize = nCopy + startAddress ;
+    Decode() ;
     
     AnalyzeXrefs() ;
 
@@ -770,42 +1337,461 @@ namespace AVR
       nCopy = _eepromSize - startAddress ;
     }
 
-    std::copy(eeprom.begin(), eeprom.begin()+nCopy, _eeprom.begin()+startAddress) ;
+    for (uint32_t i = 0 ; i < nCopy ; ++i)
+      _eeprom.Set(startAddress + i, eeprom[i]) ;
     return nCopy ;
   }
 
+  ////////////////////////////////////////////////////////////////////////////////
+  // snapshot
+  // debugger state (breakpoints, xrefs, verbose, filters, trace) is not included
+
+  static const char *kSnapshotMagic = "AVRemu snapshot 1" ;
+
+  bool Mcu::Save(const std::string &filename) const
+  {
+    Snapshot snapshot ;
+
+    snapshot.Put(std::string(kSnapshotMagic)) ;
+    snapshot.Put(_name) ;
+    snapshot.Put(_flashSize) ; snapshot.Put(_ioSize) ; snapshot.Put(_ramSize) ; snapshot.Put(_eepromSize) ;
+
+    snapshot.Put(_loadedFlashSize) ;
+    snapshot.Put(_image->_flash) ;
+
+    SaveState(snapshot) ;
+
+    return snapshot.Write(filename) ;
+  }
+
+  bool Mcu::Load(const std::string &filename)
+  {
+    Snapshot snapshot ;
+
+    if (!snapshot.Read(filename))
+      return false ;
+
+    std::string magic, name ;
+    uint32_t flashSize = 0, ioSize = 0, ramSize = 0, eepromSize = 0 ;
+    snapshot.Get(magic) ;
+    snapshot.Get(name) ;
+    snapshot.Get(flashSize) ; snapshot.Get(ioSize) ; snapshot.Get(ramSize) ; snapshot.Get(eepromSize) ;
+    if (!snapshot.Ok() || (magic != kSnapshotMagic) || (name != _name) ||
+        (flashSize != _flashSize) || (ioSize != _ioSize) || (ramSize != _ramSize) || (eepromSize != _eepromSize))
+      return false ;
+
+    uint32_t loadedFlashSize = 0 ;
+    std::vector<Command> flash ;
+    snapshot.Get(loadedFlashSize) ;
+    snapshot.Get(flash) ;
+    if (!snapshot.Ok() || (flash.size() != _flashSize))
+      return false ;
+
+    // parse the complete state into a scratch MCU, this one is left unchanged on error
+    std::unique_ptr<Mcu> scratch(New()) ;
+    if (!scratch->LoadState(snapshot) || !snapshot.End())
+      return false ;
+    Snapshot state ;
+    scratch->SaveState(state) ;
+
+    UniqueImage() ;
+    std::copy(flash.begin(), flash.end(), _flash) ;
+    _loadedFlashSize = loadedFlashSize ;
+    Decode() ;
+
+    return LoadState(state) ;
+  }
+
+  void Mcu::SaveState(Snapshot &snapshot, bool memory) const
+  {
+    snapshot.Put(_pc) ;
+    snapshot.Put(GetSP()) ;
+    snapshot.Put(GetSREG()) ;
+    snapshot.Put(_sleep.Get()) ;
+    snapshot.Put(GetRampX()) ; snapshot.Put(GetRampY()) ; snapshot.Put(GetRampZ()) ;
+    snapshot.Put(GetRampD()) ; snapshot.Put(GetEind()) ;
+    snapshot.Put(_ticks) ;
+    snapshot.Put(_reg) ;
+
+    if (memory)
+    {
+      snapshot.Put(_ram.Bytes()) ;
+      snapshot.Put(_eeprom.Bytes()) ;
+    }
+
+    snapshot.Put((uint32_t)_stackFrames.size()) ;
+    for (const StackFrame &iFrame : _stackFrames)
+    {
+      snapshot.Put(iFrame.first) ;
+      snapshot.Put(iFrame.second) ;
+    }
+
+    for (const Io::Register *iIo : _io)
+      if (iIo)
+        iIo->Save(snapshot) ;
+    for (const AVR::Io *iPeripheral : _peripherals)
+      iPeripheral->Save(snapshot) ;
+
+    // scheduled events, Io by _peripherals index
+    std::vector<ScheduledEvent> events ;
+    std::copy_if(_events.begin(), _events.end(), std::back_inserter(events),
+                 [this](const ScheduledEvent &event){ return EventLive(event) ; }) ;
+    std::sort(events.begin(), events.end(), [](const ScheduledEvent &a, const ScheduledEvent &b){ return EventLater(b, a) ; }) ;
+    snapshot.Put((uint32_t)events.size()) ;
+    for (const ScheduledEvent &iEvent : events)
+    {
+      uint32_t idx = std::find(_peripherals.begin(), _peripherals.end(), iEvent._io) - _peripherals.begin() ;
+      snapshot.Put(iEvent._ticks) ;
+      snapshot.Put(idx) ;
+      snapshot.Put(iEvent._id) ;
+    }
+
+    // requested interrupts, Io by _peripherals index
+    for (uint64_t iPending : _irqPending)
+      snapshot.Put(iPending) ;
+    for (uint32_t iVector = 0 ; iVector < kIrqVectors ; ++iVector)
+    {
+      if (!(_irqPending[iVector / 64] & (1ULL << (iVector % 64))))
+        continue ;
+      const IrqSource &source = _irqSources[iVector] ;
+      uint32_t idx = std::find(_peripherals.begin(), _peripherals.end(), source._io) - _peripherals.begin() ;
+      snapshot.Put(idx) ;
+      snapshot.Put(source._level) ;
+    }
+  }
+
+  bool Mcu::LoadState(Snapshot &snapshot, bool memory)
+  {
+    uint16_t sp = 0 ;
+    uint8_t  sreg = 0, sleep = 0 ;
+    uint32_t rampx = 0, rampy = 0, rampz = 0, rampd = 0, eind = 0 ;
+    snapshot.Get(_pc) ;
+    snapshot.Get(sp) ;
+    snapshot.Get(sreg) ;
+    snapshot.Get(sleep) ;
+    snapshot.Get(rampx) ; snapshot.Get(rampy) ; snapshot.Get(rampz) ;
+    snapshot.Get(rampd) ; snapshot.Get(eind) ;
+    snapshot.Get(_ticks) ;
+    snapshot.Get(_reg) ;
+    SetSP(sp) ;
+    SetSREG(sreg) ;
+    _sleep.Set(sleep) ;
+    SetRampX(rampx) ; SetRampY(rampy) ; SetRampZ(rampz) ;
+    SetRampD(rampd) ; SetEind(eind) ;
+
+    bool sizeOk = true ;
+    if (memory)
+    {
+      std::vector<uint8_t> ram, eeprom ;
+      snapshot.Get(ram) ;
+      snapshot.Get(eeprom) ;
+      sizeOk = (ram.size() == _ramSize) && (eeprom.size() == _eepromSize) ;
+      if (sizeOk)
+      {
+        _ram.Bytes(ram) ;
+        _eeprom.Bytes(eeprom) ;
+        MapPages() ;
+      }
+    }
+
+    uint32_t nFrame = 0 ;
+    snapshot.Get(nFrame) ;
+    _stackFrames.clear() ;
+    for (uint32_t iFrame = 0 ; snapshot.Ok() && (iFrame < nFrame) ; ++iFrame)
+    {
+      StackFrame frame ;
+      snapshot.Get(frame.first) ;
+      snapshot.Get(frame.second) ;
+      _stackFrames.push_back(frame) ;
+    }
+    _sampler.Frames(_stackFrames) ;
+
+    for (Io::Register *iIo : _io)
+      if (iIo)
+        iIo->Load(snapshot) ;
+    for (AVR::Io *iPeripheral : _peripherals)
+      iPeripheral->Load(snapshot) ;
+
+    uint32_t nEvent = 0 ;
+    snapshot.Get(nEvent) ;
+    _events.clear() ;
+    _eventSeqs.clear() ;
+    _eventsStale = 0 ;
+    _nextEvent = UINT64_MAX ;
+    for (uint32_t iEvent = 0 ; snapshot.Ok() && (iEvent < nEvent) ; ++iEvent)
+    {
+      uint64_t ticks = 0 ;
+      uint32_t idx = 0, id = 0 ;
+      snapshot.Get(ticks) ;
+      snapshot.Get(idx) ;
+      snapshot.Get(id) ;
+      if (idx < _peripherals.size())
+        Schedule(ticks, _peripherals[idx], id) ;
+    }
+
+    for (uint64_t &iPending : _irqPending)
+      snapshot.Get(iPending) ;
+    for (uint32_t iVector = 0 ; iVector < kIrqVectors ; ++iVector)
+    {
+      IrqSource &source = _irqSources[iVector] ;
+      source._io    = nullptr ;
+      source._level = 1 ;
+      if (!(_irqPending[iVector / 64] & (1ULL << (iVector % 64))))
+        continue ;
+      uint32_t idx = 0 ;
+      snapshot.Get(idx) ;
+      snapshot.Get(source._level) ;
+      if (idx < _peripherals.size())
+        source._io = _peripherals[idx] ;
+    }
+    IrqUpdate() ;
+
+    return snapshot.Ok() && sizeOk ;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // clone
+  // flash image, decode and instruction tables, xrefs and the RAM / EEPROM
+  // pages are shared until written, everything else is copied through
+  // SaveState() / LoadState(). Once shared, source and clone treat these parts
+  // as immutable and the first write copies them (see _imageShared and
+  // Pages::Set()), no reference count is tested. The flags set on the source
+  // are atomic, several threads may clone the same Mcu.
+
+  Mcu* Mcu::Clone() const
+  {
+    Mcu *mcu = New() ; // flash of a fresh instance is the shared BlankImage()
+
+    _imageShared = true ;
+    _xrefsShared = true ;
+    mcu->_instructions    = _instructions ;
+    mcu->_image           = _image ;
+    mcu->_imageShared     = true ;
+    mcu->_flash           = _flash ;
+    mcu->_decoded         = _decoded ;
+    mcu->_loadedFlashSize = _loadedFlashSize ;
+    mcu->_xrefTable       = _xrefTable ;
+    mcu->_xrefsShared     = true ;
+    mcu->_breakpoints     = _breakpoints ;
+    mcu->_verbose         = _verbose ;
+    mcu->_engine          = _engine ;
+
+    mcu->_ram.Share(_ram) ;
+    mcu->_eeprom.Share(_eeprom) ;
+    mcu->MapPages() ;
+
+    Snapshot snapshot ;
+    SaveState(snapshot, false) ;
+    mcu->LoadState(snapshot, false) ;
+
+    return mcu ;
+  }
+
+  void Mcu::UniqueImage()
+  {
+    if (_imageShared)
+    {
+      _image       = std::make_shared<Image>(*_image) ;
+      _imageShared = false ;
+      _flash       = _image->_flash.data() ;
+      _decoded     = _image->_decoded.data() ;
+    }
+  }
+
+  void Mcu::UniqueXrefs()
+  {
+    if (_xrefsShared)
+    {
+      _xrefTable   = std::make_shared<XrefTable>(*_xrefTable) ;
+      _xrefsShared = false ;
+    }
+  }
+
+  // all pages start as the shared blank page, the first write copies them
+  Mcu::Pages::Pages(uint32_t size, uint8_t init)
+    : _size(size), _init(init), _origin(0), _pages((size + 0xff) >> 8, Blank(init)), _unique(_pages.size(), false), _shared(false)
+  {
+  }
+
+  void Mcu::Pages::Origin(uint32_t origin)
+  {
+    _origin = origin & 0xff ;
+    _pages.assign((_origin + _size + 0xff) >> 8, Blank(_init)) ;
+    _unique.assign(_pages.size(), false) ;
+  }
+
+  bool Mcu::Pages::Set(uint32_t addr, uint8_t value)
+  {
+    if (_shared.load(std::memory_order_relaxed))
+    {
+      _unique.assign(_pages.size(), false) ;
+      _shared = false ;
+    }
+
+    addr += _origin ;
+    uint32_t page = addr >> 8 ;
+    bool copied = !_unique[page] ;
+    if (copied)
+    {
+      _pages[page]  = std::make_shared<Page>(*_pages[page]) ;
+      _unique[page] = true ;
+    }
+    _pages[page]->_bytes[addr & 0xff] = value ;
+    return copied ;
+  }
+
+  void Mcu::Pages::Share(const Pages &pages)
+  {
+    pages._shared = true ;
+    _size   = pages._size ;
+    _origin = pages._origin ;
+    _pages  = pages._pages ;
+    _unique.assign(_pages.size(), false) ;
+    _shared = false ;
+  }
+
+  std::vector<uint8_t> Mcu::Pages::Bytes() const
+  {
+    std::vector<uint8_t> bytes(_size) ;
+    for (uint32_t i = 0 ; i < _size ; ++i)
+      bytes[i] = (*this)[i] ;
+    return bytes ;
+  }
+
+  // all pages replaced, pointers from Write() / Read() are stale
+  void Mcu::Pages::Bytes(const std::vector<uint8_t> &bytes)
+  {
+    for (std::shared_ptr<Page> &iPage : _pages)
+      iPage = std::make_shared<Page>() ;
+    for (uint32_t i = 0 ; (i < _size) && (i < bytes.size()) ; ++i)
+      _pages[(_origin + i) >> 8]->_bytes[(_origin + i) & 0xff] = bytes[i] ;
+    _unique.assign(_pages.size(), true) ;
+    _shared = false ;
+  }
+
+  // page filled with init, never written, kept like BlankImage()
+  std::shared_ptr<Mcu::Pages::Page> Mcu::Pages::Blank(uint8_t init)
+  {
+    static std::mutex mutex ;
+    static std::map<uint8_t, std::shared_ptr<Page>> pages ;
+
+    std::lock_guard<std::mutex> lock(mutex) ;
+    std::shared_ptr<Page> &page = pages[init] ;
+    if (!page)
+    {
+      page = std::make_shared<Page>() ;
+      std::fill(std::begin(page->_bytes), std::end(page->_bytes), init) ;
+    }
+    return page ;
+  }
+
+  // all zero flash per size, never written, kept like the instruction tables
+  std::shared_ptr<Mcu::Image> Mcu::BlankImage(uint32_t flashSize)
+  {
+    static std::mutex mutex ;
+    static std::map<uint32_t, std::shared_ptr<Image>> images ;
+
+    std::lock_guard<std::mutex> lock(mutex) ;
+    std::shared_ptr<Image> &image = images[flashSize] ;
+    if (!image)
+      image = std::make_shared<Image>(flashSize) ;
+    return image ;
+  }
+
+  Mcu::XrefTable::XrefTable(const XrefTable &table)
+  {
+    std::map<const Xref*, Xref*> copies ;
+    auto copy = [&copies](const Xref *xref)
+      {
+        Xref *&xrefCopy = copies[xref] ;
+        if (!xrefCopy)
+          xrefCopy = new Xref(*xref) ;
+        return xrefCopy ;
+      } ;
+
+    for (const Xref *iXref : table._xrefs)
+      _xrefs.push_back(copy(iXref)) ;
+    for (const auto &iXref : table._xrefByAddr)
+      _xrefByAddr[iXref.first] = copy(iXref.second) ;
+    for (const auto &iXref : table._xrefByLabel)
+      _xrefByLabel[iXref.first] = copy(iXref.second) ;
+  }
+
+  Mcu::XrefTable::~XrefTable()
+  {
+    // the maps may hold xrefs no longer listed in _xrefs (see AnalyzeXrefs())
+    std::set<Xref*> xrefs(_xrefs.begin(), _xrefs.end()) ;
+    for (const auto &iXref : _xrefByAddr)
+      xrefs.insert(iXref.second) ;
+    for (const auto &iXref : _xrefByLabel)
+      xrefs.insert(iXref.second) ;
+    for (Xref *iXref : xrefs)
+      delete iXref ;
+  }
+
   const Mcu::Xref* Mcu::XrefByAddr(uint32_t addr) const
   {
-    auto iXref = _xrefByAddr.find(addr) ;
-    return (iXref != _xrefByAddr.end()) ? iXref->second : nullptr ;
+    auto iXref = _xrefTable->_xrefByAddr.find(addr) ;
+    return (iXref != _xrefTable->_xrefByAddr.end()) ? iXref->second : nullptr ;
   }
   
   const Mcu::Xref* Mcu::XrefByLabel(const std::string &label) const
   {
-    auto iXref = _xrefByLabel.find(label) ;
-    return (iXref != _xrefByLabel.end()) ? iXref->second : nullptr ;
+    auto iXref = _xrefTable->_xrefByLabel.find(label) ;
+    return (iXref != _xrefTable->_xrefByLabel.end()) ? iXref->second : nullptr ;
+  }
+
+  std::map<uint32_t, const Mcu::Xref*> Mcu::Functions() const
+  {
+    auto named = [](const Xref *xref) -> bool
+    {
+      return !static_cast<uint32_t>(xref->Type() & (XrefType::data | XrefType::ram)) && xref->Label().compare(0, 4, "Lbl_") ;
+    } ;
+
+    std::map<uint32_t, const Xref*> functions ;
+    for (const auto &iXref : XrefByAddr())
+    {
+      const Xref *xref = iXref.second ;
+      bool entry = static_cast<uint32_t>(xref->Type() & XrefType::call) || named(xref) ;
+      for (uint32_t source : xref->Sources())
+      {
+        const Xref *src = XrefByAddr(source) ;
+        if (src && named(src))
+          entry = true ;
+      }
+      if (entry)
+        functions[xref->Addr()] = xref ;
+    }
+    return functions ;
+  }
+
+  const Mcu::Xref* Mcu::Function(const std::map<uint32_t, const Xref*> &functions, uint32_t pc)
+  {
+    auto iFct = functions.upper_bound(pc) ;
+    return (iFct == functions.begin()) ? nullptr : (--iFct)->second ;
   }
 
   bool Mcu::XrefAdd(const Xref &xref0)
   {
     Xref *xref = nullptr ;
-    
-    auto iXrefByAddr  = _xrefByAddr .find(xref0.Addr() ) ;
-    if (iXrefByAddr != _xrefByAddr.end())
+
+    UniqueXrefs() ;    
+    auto iXrefByAddr  = _xrefTable->_xrefByAddr .find(xref0.Addr() ) ;
+    if (iXrefByAddr != _xrefTable->_xrefByAddr.end())
     {
       xref = iXrefByAddr->second ;
 
       xref->Type(xref0.Type()) ;
-      _xrefByLabel.erase(xref->Label()) ;
+      _xrefTable->_xrefByLabel.erase(xref->Label()) ;
       xref->Label(xref0.Label()) ;
-      _xrefByLabel.insert(std::pair<std::string, Xref*>(xref->Label(), xref)) ;
+      _xrefTable->_xrefByLabel.insert(std::pair<std::string, Xref*>(xref->Label(), xref)) ;
     }
     else
     {
       xref = new Xref(xref0) ;
-      _xrefs.push_back(xref) ;
-      _xrefByAddr.insert(std::pair<uint32_t, Xref*>(xref->Addr() , xref)) ;
-      _xrefByLabel.insert(std::pair<std::string, Xref*>(xref->Label(), xref)) ;
+      _xrefTable->_xrefs.push_back(xref) ;
+      _xrefTable->_xrefByAddr.insert(std::pair<uint32_t, Xref*>(xref->Addr() , xref)) ;
+      _xrefTable->_xrefByLabel.insert(std::pair<std::string, Xref*>(xref->Label(), xref)) ;
     }
 
     return true ;
@@ -813,6 +1799,18 @@ namespace AVR
 
   void Mcu::Verbose(VerboseType vt, const std::string &text) const
   {
+    if ((vt == VerboseType::ProgError) && _executing) // regardless of verbosity, with how it got there
+    {
+      ++_progErrors ;
+      if (_progErrorStop)
+        *_progErrorStop = true ;
+      fputs(text.c_str(), stderr) ;
+      BranchHistory(stderr, 16) ;
+    }
+
+    if (!IsVerbose(vt))
+      return ;
+
     if (_verbose && vt)
       fputs(text.c_str(), stdout) ;
 
@@ -831,48 +1829,102 @@ namespace AVR
   void Mcu::AddFilter(VerboseType vt, const std::string &command)
   {
     _filters.push_back(new Filter(command, vt)) ;
+    _filterVerbose |= vt ;
   }
   
   void Mcu::DelFilter(pid_t pid)
   {
     _filters.erase(std::find_if(_filters.begin(), _filters.end(), [pid](const Filter *f){ return f->Pid() == pid ; })) ;    
+    _filterVerbose = VerboseType::None ;
+    for (auto iF : _filters)
+      _filterVerbose |= iF->Verbose() ;
   }  
   
-  void Mcu::AddInstruction(const Instruction *instr)
+  // decode tables are built once per instruction set and shared by all MCUs using it
+  void Mcu::SetInstructions(const std::vector<const Instruction*> &instructions)
   {
-    // loop should be optimized considering mask()
-    for (uint32_t m = 0 ; m < 0x10000 ; ++m)
+    using Table = std::vector<const Instruction*> ;
+    static std::mutex mutex ;
+    static std::map<std::vector<const Instruction*>, std::shared_ptr<const Table>> tables ;
+
+    std::lock_guard<std::mutex> lock(mutex) ;
+    std::shared_ptr<const Table> &table = tables[instructions] ;
+    if (!table)
     {
-      if (!(m & instr->Mask()))
+      std::shared_ptr<Table> newTable = std::make_shared<Table>(0x10000) ;
+      for (const Instruction *iInstr : instructions)
       {
-        Command cmd = instr->Pattern() | m ;
-        if (!_instructions[cmd])
-          _instructions[cmd] = instr ;
-        else
+        // all combinations of the operand bits, first instruction wins on double encodings
+        Command operands = ~iInstr->Mask() ;
+        for (uint32_t m = operands ; ; m = (m - 1) & operands)
         {
-          //const AVR::Instruction *instr2 = _instructions[cmd] ;
-          //printf("double instructions: %04x\n   %04x %04x %s\n   %04x %04x %s\n", cmd,
-          //       instr->Pattern(), instr->Mask(), instr->Mnemonic().c_str(),
-          //       instr2->Pattern(), instr2->Mask(), instr2->Mnemonic().c_str()) ;
+          Command cmd = iInstr->Pattern() | m ;
+          if (!(*newTable)[cmd])
+            (*newTable)[cmd] = iInstr ;
+          if (!m)
+            break ;
         }
       }
+      table = newTable ;
     }
+    _instructions = table ;
+
+    _irqVectorSize = (std::find(instructions.begin(), instructions.end(), &instrJMP) != instructions.end()) ? 2 : 1 ;
   }
 
+  void Mcu::AddBreakpoint(uint32_t addr)
+  {
+    _breakpoints.insert(addr) ;
+    UniqueImage() ;
+    if (addr < _flashSize)
+      _decoded[addr]._break = true ;
+    _blocksDirty = true ;
+  }
+
+  void Mcu::DelBreakpoint(uint32_t addr)
+  {
+    _breakpoints.erase(addr) ;
+    UniqueImage() ;
+    if (addr < _flashSize)
+      _decoded[addr]._break = false ;
+    _blocksDirty = true ;
+  }
+
+  void Mcu::Decode(uint32_t addr)
+  {
+    Decoded &dec = _decoded[addr] ;
+    dec._cmd   = _flash[addr] ;
+    dec._instr = (*_instructions)[dec._cmd] ;
+    dec._fct   = dec._instr ? dec._instr->Fct() : nullptr ;
+    dec._id    = dec._instr ? dec._instr->Id()  : 0 ;
+    dec._size  = dec._instr ? dec._instr->Size() : 1 ;
+    dec._operands = Operands() ;
+    if (dec._instr)
+      dec._instr->Decode(dec._cmd, dec._operands) ;
+    _blocksDirty = true ;
+  }
+
+  void Mcu::Decode()
+  {
+    for (uint32_t addr = 0 ; addr < _flashSize ; ++addr)
+      Decode(addr) ;
+  }
+  
   bool Mcu::XrefAdd(XrefType type, uint32_t target, uint32_t source)
   {
     Xref *xref = nullptr ;
-          
-    auto iXref = _xrefByAddr.find(target) ;
-    if (iXref != _xrefByAddr.end())
+
+    UniqueXrefs() ;
+    auto iXref = _xrefTable->_xrefByAddr.find(target) ;
+    if (iXref != _xrefTable->_xrefByAddr.end())
     {
       xref = iXref->second ;
     }
     else
     {
       xref = new Xref(target) ;
-      _xrefs.push_back(xref) ;
-      _xrefByAddr.insert(std::pair<uint32_t, Xref*>(target, xref)) ;
+      _xrefTable->_xrefs.push_back(xref) ;
+      _xrefTable->_xrefByAddr.insert(std::pair<uint32_t, Xref*>(target, xref)) ;
     }
 
     xref->Type(type) ;
@@ -894,22 +1946,23 @@ namespace AVR
 
       xref->Label(label) ;
 
-      _xrefByLabel.insert(std::pair<std::string, Xref*>(xref->Label(), xref)) ;
+      _xrefTable->_xrefByLabel.insert(std::pair<std::string, Xref*>(xref->Label(), xref)) ;
     }
     return true ;
   }
   
   void Mcu::AnalyzeXrefs()
   {
-    _xrefs.clear() ;
+    UniqueXrefs() ;
+    _xrefTable->_xrefs.clear() ;
 
     // add known addresses
     for (const auto &iKnownAddr : _knownProgramAddresses)
     {
       Xref *xref = new Xref(iKnownAddr._addr, XrefType::jmp, iKnownAddr._label, iKnownAddr._description) ;
-      _xrefs.push_back(xref) ;
-      _xrefByAddr[xref->Addr()] = xref ;
-      _xrefByLabel[xref->Label()] = xref ;
+      _xrefTable->_xrefs.push_back(xref) ;
+      _xrefTable->_xrefByAddr[xref->Addr()] = xref ;
+      _xrefTable->_xrefByLabel[xref->Label()] = xref ;
     }
 
     // check branch instructions
@@ -920,7 +1973,7 @@ namespace AVR
       uint32_t addr ;
       Command cmd = _flash[_pc++] ;
 
-      const Instruction *instr = _instructions[cmd] ;
+      const Instruction *instr = (*_instructions)[cmd] ;
       if (instr)
       {
         XrefType xt = instr->Xref(*this, cmd, addr) ;
@@ -951,16 +2004,15 @@ namespace AVR
       Close() ;
   }
   
-  bool Mcu::Trace::Open(const std::string &filename, uint32_t stopAddr)
+  bool Mcu::Trace::Open(const std::string &filename, uint32_t stopAddr, bool binary)
   {
-    if (_file)
+    if ((*this)())
     {
       fprintf(stdout, "trace file already open\n") ;
       return false ;
     }
     
-    _file = fopen(filename.c_str(), "w") ;
-    if (!_file)
+    if (binary ? !_writer.Open(filename) : !(_file = fopen(filename.c_str(), "w")))
     {
       fprintf(stdout, "trace file open failed\n") ;
       return false ;
@@ -972,21 +2024,50 @@ namespace AVR
     _isCall = false ;
     _lvl    = 0 ;
     _stop   = stopAddr ;
+    _ticks     = _mcu.Ticks() ;
+    _prevDst   = 0 ;
+    _prevTicks = _ticks ;
+
+    if (binary)
+    {
+      for (const char *m = TraceFormat::kMagic ; *m ; ++m)
+        _writer.Put((uint8_t)*m) ;
+      _writer.Put(TraceFormat::kVersion) ;
+      _writer.Put(_mcu.Name()) ;
+      _writer.Varint(_mcu.XrefByAddr().size()) ; // labels as known now, the decoder has no program
+      for (const auto &iXref : _mcu.XrefByAddr())
+      {
+        _writer.Varint(iXref.first) ;
+        _writer.Put(iXref.second->Label()) ;
+        _writer.Put(iXref.second->Description()) ;
+      }
+    }
 
     return true ;
   }
   
   bool Mcu::Trace::Close()
   {
-    if (!_file)
+    if (!(*this)())
     {
       fprintf(stdout, "trace file not open\n") ;
       return false ;
     }
 
     Add(0, 0, instrNOP) ;
-    fclose(_file) ;
-    _file = 0 ;
+    if (_file)
+    {
+      fclose(_file) ;
+      _file = 0 ;
+      return true ;
+    }
+
+    _writer.Put(TraceFormat::End) ;
+    if (!_writer.Close())
+    {
+      fprintf(stdout, "trace file write failed\n") ;
+      return false ;
+    }
     return true ;
   }
 
@@ -995,61 +2076,748 @@ namespace AVR
     if ((src != _src) ||
         (dst != _dst))
     {
-      fprintf(_file, "%2d  ", _lvl) ;
-      for (uint32_t i = 0, e = (_lvl < 20) ? _lvl : 20 ; i < e ; ++i)
-        fputs("  ", _file) ;
-      fprintf(_file, "%05x -> %05x %4ux", _src, _dst, _cnt) ;
-      
-      if (_isRet)
-      {
-        fprintf(_file, "   RET\n\n") ;
-        if (_lvl > 0)
-          _lvl-- ;
-      }
+      if (_file)
+        Text() ;
       else
-      {
-        auto iXrefs = _mcu.XrefByAddr().find(_dst) ;
-        if (iXrefs != _mcu.XrefByAddr().end())
-        {
-          const Xref *xref = iXrefs->second ;
-          fprintf(_file, "   %s\n", xref->Label().c_str()) ;
-        
-          if (_isCall)
-          {
-            _lvl++ ;
-            fputc('\n', _file) ;
-            fprintf(_file, "%2d  ", _lvl) ;
-            for (uint32_t i = 0, e = (_lvl < 20) ? _lvl : 20 ; i < e ; ++i)
-              fputs("  ", _file) ;
-            fprintf(_file, "%s", xref->Label().c_str()) ;
-            if (!xref->Description().empty())
-              fprintf(_file, " | %s", xref->Description().c_str()) ;
-            fprintf(_file, "\n") ;
-          }
-        }
-        else
-          fprintf(_file, "\n") ;
-      }
+        Binary() ;
       
       _src    = src ;
       _dst    = dst ;
       _cnt    = 1 ;
       _isRet  = instr.IsReturn() ;
       _isCall = instr.IsCall() ;
+      _ticks  = _mcu.Ticks() ;
     }
     else
     {
       _cnt++ ;
     }
   }
+
+  void Mcu::Trace::Text()
+  {
+    fprintf(_file, "%2d  ", _lvl) ;
+    for (uint32_t i = 0, e = (_lvl < 20) ? _lvl : 20 ; i < e ; ++i)
+      fputs("  ", _file) ;
+    fprintf(_file, "%05x -> %05x %4ux", _src, _dst, _cnt) ;
+    
+    if (_isRet)
+    {
+      fprintf(_file, "   RET\n\n") ;
+      if (_lvl > 0)
+        _lvl-- ;
+    }
+    else
+    {
+      auto iXrefs = _mcu.XrefByAddr().find(_dst) ;
+      if (iXrefs != _mcu.XrefByAddr().end())
+      {
+        const Xref *xref = iXrefs->second ;
+        fprintf(_file, "   %s\n", xref->Label().c_str()) ;
+      
+        if (_isCall)
+        {
+          _lvl++ ;
+          fputc('\n', _file) ;
+          fprintf(_file, "%2d  ", _lvl) ;
+          for (uint32_t i = 0, e = (_lvl < 20) ? _lvl : 20 ; i < e ; ++i)
+            fputs("  ", _file) ;
+          fprintf(_file, "%s", xref->Label().c_str()) ;
+          if (!xref->Description().empty())
+            fprintf(_file, " | %s", xref->Description().c_str()) ;
+          fprintf(_file, "\n") ;
+        }
+      }
+      else
+        fprintf(_file, "\n") ;
+    }
+  }
+
+  void Mcu::Trace::Binary()
+  {
+    _writer.Put(_isRet ? TraceFormat::Return : _isCall ? TraceFormat::Call : TraceFormat::Jump) ;
+    _writer.Varint(TraceFormat::ZigZag((int64_t)_src - _prevDst)) ;
+    _writer.Varint(TraceFormat::ZigZag((int64_t)_dst - _src)) ;
+    _writer.Varint(_cnt - 1) ;
+    _writer.Varint(_ticks - _prevTicks) ;
+    _prevDst   = _dst ;
+    _prevTicks = _ticks ;
+  }
   
+  ////////////////////////////////////////////////////////////////////////////////
+  // BranchHistory
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void Mcu::BranchHistory(FILE *file, uint32_t count) const
+  {
+    if (count > kHistorySize)
+      count = kHistorySize ;
+    if (count > _historyPos)
+      count = (uint32_t)_historyPos ;
+    if (!count)
+    {
+      fprintf(file, "no branch history\n") ;
+      return ;
+    }
+
+    std::map<uint32_t, const Xref*> functions = Functions() ;
+    auto label = [this, &functions](uint32_t addr) -> std::string
+    {
+      const Xref *xref = (addr < _loadedFlashSize) ? Function(functions, addr) : nullptr ;
+      if (!xref)
+        return std::string() ;
+      char buff[16] ;
+      sprintf(buff, "+%x", addr - xref->Addr()) ;
+      return (addr == xref->Addr()) ? xref->Label() : xref->Label() + buff ;
+    } ;
+
+    fprintf(file, "branch history, last %u of %llu:\n", count, (unsigned long long)_historyPos) ;
+    for (uint64_t i = _historyPos - count ; i != _historyPos ; ++i)
+    {
+      const Branch &branch = _history[i % kHistorySize] ;
+      uint32_t src = branch._src & ~kBranchIrq ;
+      const Instruction *instr = (src < _loadedFlashSize) ? _decoded[src]._instr : nullptr ; // no ProgError from here
+      std::string mnemonic = (branch._src & kBranchIrq) ? "IRQ" : instr ? instr->Mnemonic() : "?" ;
+      fprintf(file, "%5d %16llu  %05x -> %05x  %-6s %s -> %s\n", (int)(i - _historyPos), (unsigned long long)branch._ticks,
+              src, branch._dst, mnemonic.c_str(), label(src).c_str(), label(branch._dst).c_str()) ;
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Profile
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void Mcu::Profile::Start()
+  {
+    _count.assign(_mcu.FlashSize(), 0) ;
+    _ticks.assign(_mcu.FlashSize(), 0) ;
+    _on = true ;
+  }
+
+  void Mcu::Profile::Get(uint32_t head, uint32_t branch, uint64_t *count, uint64_t *ticks) const
+  {
+    for (uint32_t pc = head ; pc <= branch ; ++pc)
+    {
+      count[pc - head] = _count[pc] ;
+      ticks[pc - head] = _ticks[pc] ;
+    }
+  }
+
+  void Mcu::Profile::Repeat(uint32_t head, uint32_t branch, const uint64_t *count, const uint64_t *ticks, uint64_t n)
+  {
+    for (uint32_t pc = head ; pc <= branch ; ++pc)
+    {
+      _count[pc] += (_count[pc] - count[pc - head]) * n ;
+      _ticks[pc] += (_ticks[pc] - ticks[pc - head]) * n ;
+    }
+  }
+
+  void Mcu::Profile::Report(FILE *file, uint32_t top) const
+  {
+    if (_count.empty())
+    {
+      fprintf(file, "no profile\n") ;
+      return ;
+    }
+
+    std::map<uint32_t, const Xref*> functions = _mcu.Functions() ;
+    auto function = [&functions](uint32_t pc) { return Function(functions, pc) ; } ;
+
+    struct Entry
+    {
+      uint32_t    _addr ;
+      const Xref *_xref ;
+      uint64_t    _count ;
+      uint64_t    _ticks ;
+    } ;
+    std::vector<Entry> perFct, perPc ;
+    std::map<uint32_t, size_t> fctIdx ;
+    uint64_t count = 0 ;
+    uint64_t ticks = 0 ;
+    for (uint32_t pc = 0 ; pc < _count.size() ; ++pc)
+    {
+      if (!_count[pc])
+        continue ;
+      count += _count[pc] ;
+      ticks += _ticks[pc] ;
+
+      const Xref *xref = function(pc) ;
+      perPc.push_back(Entry{ pc, xref, _count[pc], _ticks[pc] }) ;
+
+      uint32_t fctAddr = xref ? xref->Addr() : 0xffffffff ;
+      auto iIdx = fctIdx.find(fctAddr) ;
+      if (iIdx == fctIdx.end())
+      {
+        iIdx = fctIdx.insert(std::make_pair(fctAddr, perFct.size())).first ;
+        perFct.push_back(Entry{ fctAddr, xref, 0, 0 }) ;
+      }
+      perFct[iIdx->second]._count += _count[pc] ;
+      perFct[iIdx->second]._ticks += _ticks[pc] ;
+    }
+
+    auto byTicks = [](const Entry &a, const Entry &b) { return (a._ticks != b._ticks) ? (a._ticks > b._ticks) : (a._addr < b._addr) ; } ;
+    std::sort(perFct.begin(), perFct.end(), byTicks) ;
+    std::sort(perPc.begin() , perPc.end() , byTicks) ;
+
+    fprintf(file, "profile: %llu instructions, %llu cycles\n", (unsigned long long)count, (unsigned long long)ticks) ;
+    fprintf(file, "\n          cycles      %%     instructions  function\n") ;
+    for (uint32_t i = 0 ; (i < perFct.size()) && (i < top) ; ++i)
+    {
+      const Entry &e = perFct[i] ;
+      fprintf(file, "%16llu %6.2f%% %16llu  ", (unsigned long long)e._ticks, 100.0 * e._ticks / ticks, (unsigned long long)e._count) ;
+      if (e._xref)
+        fprintf(file, "%s [%05x]\n", e._xref->Label().c_str(), e._addr) ;
+      else
+        fprintf(file, "?\n") ;
+    }
+    fprintf(file, "\n          cycles      %%            count  address\n") ;
+    for (uint32_t i = 0 ; (i < perPc.size()) && (i < top) ; ++i)
+    {
+      const Entry &e = perPc[i] ;
+      fprintf(file, "%16llu %6.2f%% %16llu  %05x", (unsigned long long)e._ticks, 100.0 * e._ticks / ticks, (unsigned long long)e._count, e._addr) ;
+      if (e._xref)
+        fprintf(file, " %s+%x", e._xref->Label().c_str(), e._addr - e._xref->Addr()) ;
+      const Instruction *instr = _mcu.Instr(e._addr) ;
+      if (instr)
+        fprintf(file, "  %s", instr->Mnemonic().c_str()) ;
+      fprintf(file, "\n") ;
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // CallGraph
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void Mcu::CallGraph::Start()
+  {
+    _self.clear() ;
+    _edges.clear() ;
+    _frames.clear() ;
+    _frames.push_back(Frame{ _mcu.PC(), _mcu.PC(), _mcu.Ticks(), _mcu.Ticks() }) ;
+    _on = true ;
+  }
+
+  void Mcu::CallGraph::Stop()
+  {
+    if (!_on)
+      return ;
+    Frame &top = _frames.back() ;
+    _self[Key(_frames, _mcu.PC())] += _mcu.Ticks() - top._resume ;
+    top._resume = _mcu.Ticks() ;
+    _on = false ;
+  }
+
+  void Mcu::CallGraph::Call(uint32_t site, uint32_t target)
+  {
+    uint64_t ticks = _mcu.Ticks() ;
+    Frame &top = _frames.back() ;
+    _self[Key(_frames, site)] += ticks - top._resume ;
+    _frames.push_back(Frame{ Key(_frames, site), target, ticks, ticks }) ;
+  }
+
+  void Mcu::CallGraph::Return(uint32_t site)
+  {
+    if (_frames.size() > 1) // unbalanced returns stay in the root
+      Leave(_frames, _self, _edges, site, _mcu.Ticks()) ;
+  }
+
+  void Mcu::CallGraph::Leave(std::vector<Frame> &frames, std::map<uint32_t, uint64_t> &self, std::map<Edge, Cost> &edges, uint32_t pc, uint64_t ticks)
+  {
+    Frame top = frames.back() ;
+    self[Key(frames, pc)] += ticks - top._resume ;
+    frames.pop_back() ;
+
+    Cost &cost = edges[Edge(top._site, top._fct)] ;
+    cost._calls += 1 ;
+    cost._ticks += ticks - top._enter ;
+    frames.back()._resume = ticks ;
+  }
+
+  bool Mcu::CallGraph::Write(const std::string &filename) const
+  {
+    // close open frames on a copy
+    std::vector<Frame>           frames = _frames ;
+    std::map<uint32_t, uint64_t> self   = _self ;
+    std::map<Edge, Cost>         edges  = _edges ;
+    uint64_t ticks = _mcu.Ticks() ;
+    uint32_t pc    = _mcu.PC() ;
+    if (_on && !frames.empty())
+    {
+      while (frames.size() > 1)
+      {
+        uint32_t site = frames.back()._site ;
+        Leave(frames, self, edges, pc, ticks) ;
+        pc = site ;
+      }
+      self[Key(frames, pc)] += ticks - frames.back()._resume ;
+    }
+
+    // addresses to function names
+    std::map<uint32_t, const Xref*> functions = _mcu.Functions() ;
+    auto name = [&functions](uint32_t addr) -> std::string
+    {
+      const Xref *xref = Function(functions, addr) ;
+      if (xref)
+        return xref->Label() ;
+      char buff[16] ;
+      sprintf(buff, "%05x", addr) ;
+      return buff ;
+    } ;
+    std::map<std::string, uint64_t> fctSelf ;
+    std::map<std::string, std::map<std::string, Cost>> fctCalls ;
+    uint64_t total = 0 ;
+    for (const auto &iSelf : self)
+    {
+      fctSelf[name(iSelf.first)] += iSelf.second ;
+      total += iSelf.second ;
+    }
+    for (const auto &iEdge : edges)
+    {
+      Cost &cost = fctCalls[name(iEdge.first.first)][name(iEdge.first.second)] ;
+      cost._calls += iEdge.second._calls ;
+      cost._ticks += iEdge.second._ticks ;
+    }
+
+    FILE *file = fopen(filename.c_str(), "w") ;
+    if (!file)
+      return false ;
+
+    fprintf(file, "# callgrind format\n") ;
+    fprintf(file, "version: 1\n") ;
+    fprintf(file, "creator: AVRemu\n") ;
+    fprintf(file, "cmd: %s\n", _mcu.Name().c_str()) ;
+    fprintf(file, "positions: line\n") ;
+    fprintf(file, "events: Cycles\n") ;
+    fprintf(file, "summary: %llu\n", (unsigned long long)total) ;
+    fprintf(file, "\nfl=flash\n") ;
+    for (const auto &iSelf : fctSelf)
+    {
+      fprintf(file, "\nfn=%s\n", iSelf.first.c_str()) ;
+      fprintf(file, "0 %llu\n", (unsigned long long)iSelf.second) ;
+      auto iCalls = fctCalls.find(iSelf.first) ;
+      if (iCalls == fctCalls.end())
+        continue ;
+      for (const auto &iCallee : iCalls->second)
+      {
+        fprintf(file, "cfn=%s\n", iCallee.first.c_str()) ;
+        fprintf(file, "calls=%llu 0\n", (unsigned long long)iCallee.second._calls) ;
+        fprintf(file, "0 %llu\n", (unsigned long long)iCallee.second._ticks) ;
+      }
+    }
+
+    return fclose(file) == 0 ;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Sampler
+  ////////////////////////////////////////////////////////////////////////////////
+
+  Mcu::Sampler *Mcu::Sampler::_active = nullptr ;
+
+  bool Mcu::Sampler::Start(uint32_t period)
+  {
+    Stop() ;
+    if (!period)
+      return false ;
+
+    struct sigaction action ;
+    memset(&action, 0, sizeof(action)) ;
+    action.sa_handler = SigProf ;
+    action.sa_flags   = SA_RESTART ;
+    sigemptyset(&action.sa_mask) ;
+    if (sigaction(SIGPROF, &action, &_prevAction))
+      return false ;
+
+    _ring.assign(kSize, Sample{ 0, 0 }) ;
+    _head = 0 ;
+    _tail = 0 ;
+    _dropped = 0 ;
+    _samples = 0 ;
+    _pcs.clear() ;
+    _fcts.clear() ;
+    _period = period ;
+    _remain = period ;
+    Frames(_mcu._stackFrames) ;
+    _on = true ;
+    return true ;
+  }
+
+  void Mcu::Sampler::Stop()
+  {
+    if (!_on)
+      return ;
+    Disarm() ;
+    sigaction(SIGPROF, &_prevAction, nullptr) ;
+    _on = false ;
+  }
+
+  void Mcu::Sampler::Arm()
+  {
+    _active = this ;
+    struct itimerval timer ;
+    timer.it_interval.tv_sec  = _period / 1000000 ;
+    timer.it_interval.tv_usec = _period % 1000000 ;
+    timer.it_value.tv_sec     = _remain / 1000000 ;
+    timer.it_value.tv_usec    = _remain % 1000000 ;
+    setitimer(ITIMER_PROF, &timer, nullptr) ;
+  }
+
+  void Mcu::Sampler::Disarm()
+  {
+    struct itimerval timer, prev ;
+    memset(&timer, 0, sizeof(timer)) ;
+    if (!setitimer(ITIMER_PROF, &timer, &prev))
+      _remain = prev.it_value.tv_sec * 1000000 + prev.it_value.tv_usec ;
+    if (!_remain)
+      _remain = _period ;
+    _active = nullptr ;
+    Drain() ;
+  }
+
+  // signal handler: only lock free atomics and the preallocated ring, a full ring drops the sample
+  void Mcu::Sampler::SigProf(int)
+  {
+    Sampler *sampler = _active ;
+    if (!sampler)
+      return ;
+
+    uint32_t head = sampler->_head.load(std::memory_order_relaxed) ;
+    if (head - sampler->_tail.load(std::memory_order_acquire) >= kSize)
+    {
+      sampler->_dropped.fetch_add(1, std::memory_order_relaxed) ;
+      return ;
+    }
+    Sample &sample = sampler->_ring[head % kSize] ;
+    sample._pc  = *(const volatile uint32_t*)&sampler->_mcu._pc ;
+    sample._fct = sampler->_fct ;
+    sampler->_head.store(head + 1, std::memory_order_release) ;
+  }
+
+  void Mcu::Sampler::Drain()
+  {
+    uint32_t tail = _tail.load(std::memory_order_relaxed) ;
+    uint32_t head = _head.load(std::memory_order_acquire) ;
+    for ( ; tail != head ; ++tail)
+    {
+      const Sample &sample = _ring[tail % kSize] ;
+      ++_pcs[sample._pc] ;
+      ++_fcts[sample._fct] ;
+      ++_samples ;
+    }
+    _tail.store(tail, std::memory_order_release) ;
+  }
+
+  void Mcu::Sampler::Report(FILE *file, uint32_t top) const
+  {
+    if (!_samples)
+    {
+      fprintf(file, "no samples\n") ;
+      return ;
+    }
+
+    std::map<uint32_t, const Xref*> functions = _mcu.Functions() ;
+    using Entry = std::pair<uint32_t, uint64_t> ; // address, samples
+    auto bySamples = [](const Entry &a, const Entry &b) { return (a.second != b.second) ? (a.second > b.second) : (a.first < b.first) ; } ;
+    std::vector<Entry> perFct(_fcts.begin(), _fcts.end()) ;
+    std::vector<Entry> perPc (_pcs.begin() , _pcs.end() ) ;
+    std::sort(perFct.begin(), perFct.end(), bySamples) ;
+    std::sort(perPc.begin() , perPc.end() , bySamples) ;
+
+    fprintf(file, "sampler: %llu samples every %uus host CPU time, %u dropped\n",
+            (unsigned long long)_samples, _period, _dropped.load()) ;
+    fprintf(file, "\n         samples      %%  called function (top stack frame)\n") ;
+    for (uint32_t i = 0 ; (i < perFct.size()) && (i < top) ; ++i)
+    {
+      const Entry &e = perFct[i] ;
+      fprintf(file, "%16llu %6.2f%%  ", (unsigned long long)e.second, 100.0 * e.second / _samples) ;
+      if (e.first == kRoot)
+        fprintf(file, "-\n") ;
+      else
+      {
+        const Xref *xref = _mcu.XrefByAddr(e.first) ;
+        fprintf(file, "%05x %s\n", e.first, (xref && xref->Label().size()) ? xref->Label().c_str() : "") ;
+      }
+    }
+    fprintf(file, "\n         samples      %%  address\n") ;
+    for (uint32_t i = 0 ; (i < perPc.size()) && (i < top) ; ++i)
+    {
+      const Entry &e = perPc[i] ;
+      fprintf(file, "%16llu %6.2f%%  %05x", (unsigned long long)e.second, 100.0 * e.second / _samples, e.first) ;
+      const Xref *xref = Function(functions, e.first) ;
+      if (xref)
+        fprintf(file, " %s+%x", xref->Label().c_str(), e.first - xref->Addr()) ;
+      const Instruction *instr = _mcu.Instr(e.first) ;
+      if (instr)
+        fprintf(file, "  %s", instr->Mnemonic().c_str()) ;
+      fprintf(file, "\n") ;
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Coverage
+  ////////////////////////////////////////////////////////////////////////////////
+
+  static const char *kCoverageMagic = "AVRemu coverage 1" ;
+
+  void Mcu::Coverage::Start()
+  {
+    if (_flags.size() != _mcu.FlashSize())
+      _flags.assign(_mcu.FlashSize(), 0) ;
+    _on = true ;
+  }
+
+  void Mcu::Coverage::Clear()
+  {
+    _flags.assign(_mcu.FlashSize(), 0) ;
+  }
+
+  bool Mcu::Coverage::Read(const std::string &filename)
+  {
+    Snapshot snapshot ;
+    if (!snapshot.Read(filename))
+      return false ;
+
+    std::string magic, name ;
+    std::vector<uint8_t> flags ;
+    snapshot.Get(magic) ;
+    snapshot.Get(name) ;
+    snapshot.Get(flags) ;
+    if (!snapshot.Ok() || (magic != kCoverageMagic) || (name != _mcu.Name()) || (flags.size() != _mcu.FlashSize()))
+      return false ;
+
+    if (_flags.size() != flags.size())
+      _flags.assign(flags.size(), 0) ;
+    for (size_t i = 0 ; i < flags.size() ; ++i)
+      _flags[i] |= flags[i] ;
+    return true ;
+  }
+
+  bool Mcu::Coverage::Write(const std::string &filename) const
+  {
+    Snapshot snapshot ;
+    snapshot.Put(std::string(kCoverageMagic)) ;
+    snapshot.Put(_mcu.Name()) ;
+    snapshot.Put(_flags.size() ? _flags : std::vector<uint8_t>(_mcu.FlashSize(), 0)) ;
+    return snapshot.Write(filename) ;
+  }
+
+  bool Mcu::Coverage::ReadLines(const std::string &filename)
+  {
+    FILE *file = fopen(filename.c_str(), "r") ;
+    if (!file)
+      return false ;
+
+    char buff[1024] ;
+    while (fgets(buff, sizeof(buff), file))
+    {
+      std::string line(buff) ;
+      size_t pos = line.find_first_not_of(" \t") ;
+      if ((pos == std::string::npos) || (line[pos] == '#') || (line[pos] == '\n'))
+        continue ;
+
+      char *end ;
+      uint32_t addr = strtoul(line.c_str() + pos, &end, 0) ;
+      std::string location(end) ;
+      location.erase(0, location.find_first_not_of(" \t")) ;
+      location.erase(location.find_last_not_of(" \t\r\n") + 1) ;
+      size_t colon = location.rfind(':') ;
+      if ((end == line.c_str() + pos) || !colon || (colon == std::string::npos) || (addr >= _mcu.FlashSize()))
+      {
+        fprintf(stderr, "unknown line \"%s\"\n", location.c_str()) ;
+        continue ;
+      }
+      _lines[addr] = std::make_pair(location.substr(0, colon), (uint32_t)strtoul(location.c_str() + colon + 1, nullptr, 10)) ;
+    }
+
+    fclose(file) ;
+    return true ;
+  }
+
+  std::vector<Mcu::Coverage::FctCoverage> Mcu::Coverage::PerFunction() const
+  {
+    std::vector<FctCoverage> result ;
+    if (_flags.empty())
+      return result ;
+
+    std::map<uint32_t, const Xref*> functions = _mcu.Functions() ;
+    for (uint32_t pc = 0 ; pc < _mcu._loadedFlashSize ; )
+    {
+      const Xref *xref = Function(functions, pc) ;
+      if (result.empty() || (result.back()._xref != xref))
+        result.push_back(FctCoverage{ xref ? xref->Addr() : pc, xref, 0, 0, 0, 0, 0 }) ;
+      FctCoverage &fct = result.back() ;
+
+      const Instruction *instr = _mcu.Instr(pc) ;
+      uint8_t flags = _flags[pc] ;
+      fct._instrs   += 1 ;
+      fct._executed += flags ? 1 : 0 ;
+      if (instr && instr->IsBranch())
+      {
+        fct._branches += 1 ;
+        fct._taken    += (flags & kJumped) ? 1 : 0 ;
+        fct._notTaken += (flags & kNext  ) ? 1 : 0 ;
+      }
+      pc += instr ? instr->Size() : 1 ;
+    }
+    return result ;
+  }
+
+  void Mcu::Coverage::Report(FILE *file) const
+  {
+    std::vector<FctCoverage> fcts = PerFunction() ;
+    if (fcts.empty())
+    {
+      fprintf(file, "no coverage\n") ;
+      return ;
+    }
+
+    FctCoverage total{ 0, nullptr, 0, 0, 0, 0, 0 } ;
+    fprintf(file, "%-7s%14s %8s %7s %8s %6s %10s  %s\n", "address", "instructions", "executed", "", "branches", "taken", "not taken", "function") ;
+    for (const FctCoverage &fct : fcts)
+    {
+      fprintf(file, "%05x  %14u %8u %6.2f%% %8u %6u %10u  %s\n", fct._addr, fct._instrs, fct._executed, 100.0 * fct._executed / fct._instrs,
+              fct._branches, fct._taken, fct._notTaken, fct._xref ? fct._xref->Label().c_str() : "") ;
+      total._instrs   += fct._instrs   ;
+      total._executed += fct._executed ;
+      total._branches += fct._branches ;
+      total._taken    += fct._taken    ;
+      total._notTaken += fct._notTaken ;
+    }
+    fprintf(file, "%-7s%14u %8u %6.2f%% %8u %6u %10u\n", "total", total._instrs, total._executed, 100.0 * total._executed / total._instrs,
+            total._branches, total._taken, total._notTaken) ;
+  }
+
+  bool Mcu::Coverage::WriteJson(const std::string &filename) const
+  {
+    FILE *file = fopen(filename.c_str(), "w") ;
+    if (!file)
+      return false ;
+
+    auto quote = [](const std::string &s)
+    {
+      std::string q = "\"" ;
+      for (char c : s)
+      {
+        if ((c == '"') || (c == '\\'))
+          q += '\\' ;
+        q += c ;
+      }
+      return q + "\"" ;
+    } ;
+
+    fprintf(file, "{\n  \"mcu\": %s,\n  \"functions\": [", quote(_mcu.Name()).c_str()) ;
+    const char *sep = "\n" ;
+    for (const FctCoverage &fct : PerFunction())
+    {
+      fprintf(file, "%s    { \"addr\": %u, \"name\": %s, \"instructions\": %u, \"executed\": %u, \"branches\": %u, \"taken\": %u, \"notTaken\": %u }",
+              sep, fct._addr, fct._xref ? quote(fct._xref->Label()).c_str() : "null", fct._instrs, fct._executed, fct._branches, fct._taken, fct._notTaken) ;
+      sep = ",\n" ;
+    }
+    fprintf(file, "\n  ]\n}\n") ;
+
+    return fclose(file) == 0 ;
+  }
+
+  bool Mcu::Coverage::WriteLcov(const std::string &filename) const
+  {
+    if (_lines.empty())
+    {
+      fprintf(stderr, "no line info for lcov\n") ;
+      return false ;
+    }
+
+    // flash words to source lines: hit if any instruction of the line was executed
+    struct Line
+    {
+      bool _hit ;
+      std::vector<std::pair<uint32_t, uint8_t>> _branches ; // addr, flags
+    } ;
+    std::map<std::string, std::map<uint32_t, Line>> files ;
+    std::map<std::string, std::vector<std::pair<uint32_t, std::pair<std::string, bool>>>> fcts ; // file -> line, name, hit
+    std::map<uint32_t, const Xref*> functions = _mcu.Functions() ;
+    for (uint32_t addr = 0 ; addr < _mcu._loadedFlashSize ; )
+    {
+      const Instruction *instr = _mcu.Instr(addr) ;
+      uint32_t size = instr ? instr->Size() : 1 ;
+
+      // the line entry at or before addr, like Mcu::Function()
+      auto iLine = _lines.upper_bound(addr) ;
+      if (iLine == _lines.begin())
+      {
+        addr += size ;
+        continue ;
+      }
+      --iLine ;
+
+      uint8_t flags = _flags.size() ? _flags[addr] : 0 ;
+      Line &line = files[iLine->second.first][iLine->second.second] ;
+      line._hit = line._hit || flags ;
+      if (instr && instr->IsBranch())
+        line._branches.push_back(std::make_pair(addr, flags)) ;
+
+      auto iFct = functions.find(addr) ;
+      if (iFct != functions.end())
+        fcts[iLine->second.first].push_back(std::make_pair(iLine->second.second, std::make_pair(iFct->second->Label(), flags != 0))) ;
+
+      addr += size ;
+    }
+
+    FILE *file = fopen(filename.c_str(), "w") ;
+    if (!file)
+      return false ;
+
+    fprintf(file, "TN:%s\n", _mcu.Name().c_str()) ;
+    for (const auto &iFile : files)
+    {
+      fprintf(file, "SF:%s\n", iFile.first.c_str()) ;
+
+      uint32_t fnHit = 0 ;
+      const auto &fileFcts = fcts[iFile.first] ;
+      for (const auto &iFct : fileFcts)
+        fprintf(file, "FN:%u,%s\n", iFct.first, iFct.second.first.c_str()) ;
+      for (const auto &iFct : fileFcts)
+      {
+        fprintf(file, "FNDA:%u,%s\n", iFct.second.second ? 1 : 0, iFct.second.first.c_str()) ;
+        fnHit += iFct.second.second ? 1 : 0 ;
+      }
+      fprintf(file, "FNF:%zu\nFNH:%u\n", fileFcts.size(), fnHit) ;
+
+      uint32_t brFound = 0, brHit = 0 ;
+      for (const auto &iLine : iFile.second)
+      {
+        for (const auto &iBranch : iLine.second._branches)
+        {
+          uint8_t flags = iBranch.second ;
+          if (flags)
+            fprintf(file, "BRDA:%u,%u,0,%u\nBRDA:%u,%u,1,%u\n", iLine.first, iBranch.first, (flags & kJumped) ? 1 : 0, iLine.first, iBranch.first, (flags & kNext) ? 1 : 0) ;
+          else
+            fprintf(file, "BRDA:%u,%u,0,-\nBRDA:%u,%u,1,-\n", iLine.first, iBranch.first, iLine.first, iBranch.first) ;
+          brFound += 2 ;
+          brHit   += ((flags & kJumped) ? 1 : 0) + ((flags & kNext) ? 1 : 0) ;
+        }
+      }
+      fprintf(file, "BRF:%u\nBRH:%u\n", brFound, brHit) ;
+
+      uint32_t lnHit = 0 ;
+      for (const auto &iLine : iFile.second)
+      {
+        fprintf(file, "DA:%u,%u\n", iLine.first, iLine.second._hit ? 1 : 0) ;
+        lnHit += iLine.second._hit ? 1 : 0 ;
+      }
+      fprintf(file, "LF:%zu\nLH:%u\n", iFile.second.size(), lnHit) ;
+      fprintf(file, "end_of_record\n") ;
+    }
+
+    return fclose(file) == 0 ;
+  }
+
   ////////////////////////////////////////////////////////////////////////////////
   // ATany
   ////////////////////////////////////////////////////////////////////////////////
 
   ATany::ATany() : Mcu("ATany", 0x40000, 0x1000, 0x1000, 0x1000, 0x1fff)
   {
-    const Instruction *instructions[]
+    std::vector<const Instruction*> instructions
     {
       &instrADD, &instrADC, &instrADIW, &instrSUB, &instrSUBI, &instrSBC, &instrSBCI, &instrSBIW, &instrAND, &instrANDI,
       &instrOR, &instrORI, &instrEOR, &instrCOM, &instrNEG, &instrINC, &instrDEC, &instrMUL, &instrMULS, &instrMULSU,
@@ -1070,8 +2838,7 @@ namespace AVR
 
       &instrBREAK, &instrNOP, &instrSLEEP, &instrWDR,
     } ;
-    for (const Instruction* iInstr: instructions)
-      AddInstruction(iInstr) ;
+    SetInstructions(instructions) ;
   }
 
   ATany::~ATany()
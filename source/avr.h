@@ -8,7 +8,10 @@
 #include <vector>
 #include <map>
 #include <set>
+#include <memory>
+#include <atomic>
 #include <cstdint>
+#include <signal.h>
 
 #include "io.h"
 
@@ -46,6 +49,80 @@ namespace AVR
   VerboseType operator|=(VerboseType &a, VerboseType b) ;
   VerboseType operator&=(VerboseType &a, VerboseType b) ;
 
+  ////////////////////////////////////////////////////////////////////////////////
+  // VerboseEvent
+  ////////////////////////////////////////////////////////////////////////////////
+
+  enum class VerboseEventType
+  {
+    EepromRead,
+    EepromWrite,
+    IllegalEepromRead,
+    IllegalEepromWrite,
+    IllegalIoRead,
+    IllegalIoWrite,
+    IllegalRamRead,
+    IllegalRamWrite,
+    IllegalDataRead,
+    IllegalDataWrite,
+    UninitializedProgramRead,
+    InvalidProgramRead,
+    InvalidProgramWrite,
+  } ;
+
+  class VerboseEvent // diagnostic, formatted only when someone listens (see Mcu::Verbose())
+  {
+  public:
+    VerboseEvent(VerboseEventType type, uint32_t pc, uint32_t addr, uint32_t value = 0)
+      : _type(type), _pc(pc), _addr(addr), _value(value) {}
+
+    VerboseEventType Type()  const { return _type  ; }
+    uint32_t         Pc()    const { return _pc    ; }
+    uint32_t         Addr()  const { return _addr  ; }
+    uint32_t         Value() const { return _value ; }
+    VerboseType      Verbose() const
+    {
+      switch (_type) // no default, -Wswitch reports new event types
+      {
+      case VerboseEventType::EepromRead:
+      case VerboseEventType::EepromWrite:
+        return VerboseType::Eeprom ;
+      case VerboseEventType::IllegalEepromRead:
+      case VerboseEventType::IllegalEepromWrite:
+      case VerboseEventType::IllegalIoRead:
+      case VerboseEventType::IllegalIoWrite:
+      case VerboseEventType::IllegalRamRead:
+      case VerboseEventType::IllegalRamWrite:
+      case VerboseEventType::IllegalDataRead:
+      case VerboseEventType::IllegalDataWrite:
+        return VerboseType::DataError ;
+      case VerboseEventType::UninitializedProgramRead:
+      case VerboseEventType::InvalidProgramRead:
+      case VerboseEventType::InvalidProgramWrite:
+        return VerboseType::ProgError ;
+      }
+      return VerboseType::ProgError ;
+    }
+    std::string Text() const ;
+
+  private:
+    VerboseEventType _type ;
+    uint32_t         _pc ;
+    uint32_t         _addr ;
+    uint32_t         _value ;
+  } ;
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // EngineType
+  ////////////////////////////////////////////////////////////////////////////////
+
+  enum class EngineType
+  {
+    Reference, // virtual Instruction::Execute() per step
+    Fast,      // threaded dispatch of inlined handlers (see Mcu::RunThreaded())
+    Block,     // cached straight-line blocks of predecoded handlers
+  } ;
+
   ////////////////////////////////////////////////////////////////////////////////
   // Xref
   ////////////////////////////////////////////////////////////////////////////////
@@ -63,6 +140,19 @@ namespace AVR
   XrefType operator&(XrefType a, XrefType b) ;
   XrefType operator&=(XrefType &a, XrefType b) ;
 
+  ////////////////////////////////////////////////////////////////////////////////
+  // Operands
+  ////////////////////////////////////////////////////////////////////////////////
+
+  struct Operands // instruction fields, extracted once per flash word (see Instruction::Decode())
+  {
+    Operands() : _d(0), _r(0), _k(0), _b(0) {}
+    Command _d ; // destination register
+    Command _r ; // source register
+    Command _k ; // constant, branch offset, displacement or io address
+    Command _b ; // bit or SREG flag number
+  } ;
+
   ////////////////////////////////////////////////////////////////////////////////
   // Instruction
   ////////////////////////////////////////////////////////////////////////////////
@@ -76,8 +166,13 @@ namespace AVR
     virtual ~Instruction() ;
 
   public:
+    using ExecuteFct = uint8_t (*)(Mcu &mcu, const Operands &op) ;
+
     // returns execution time
     virtual uint8_t     Execute(Mcu &mcu, Command cmd) const = 0 ; // execute next instruction
+    virtual void        Decode (Command cmd, Operands &op) const = 0 ;
+    virtual ExecuteFct  Fct() const = 0 ; // Execute() on decoded operands, without virtual dispatch
+    virtual uint8_t     Id()  const = 0 ; // handler index of the threaded dispatch (see Mcu::RunThreaded())
     virtual std::string Disasm (Mcu &mcu, Command cmd) const = 0 ;
     virtual XrefType    Xref   (Mcu &mcu, Command cmd, uint32_t &addr) const = 0 ;
 
@@ -165,6 +260,86 @@ namespace AVR
       std::string _description ;
     } ;
 
+    struct Decoded // predecoded flash word
+    {
+      Decoded() : _instr(nullptr), _fct(nullptr), _cmd(0), _size(1), _break(false), _id(0) {}
+      const Instruction       *_instr ;
+      Instruction::ExecuteFct  _fct ;
+      Operands                 _operands ;
+      Command                  _cmd ;
+      uint8_t                  _size ;
+      bool                     _break ; // copy of _breakpoints for Run()
+      uint8_t                  _id ;    // Instruction::Id()
+    } ;
+
+    struct Block // straight-line run, only the last instruction may jump
+    {
+      std::vector<Decoded> _code ;
+      uint32_t             _end ;      // address after the last instruction
+      uint64_t             _maxTicks ; // worst case of the whole run
+    } ;
+
+    struct Image // flash and its predecoded form, shared by clones until written
+    {
+      Image(uint32_t flashSize) : _flash(flashSize), _decoded(flashSize) {}
+      std::vector<Command> _flash ;
+      std::vector<Decoded> _decoded ;
+    } ;
+
+    class Pages // RAM / EEPROM in 256 byte pages, shared by clones until written
+    {
+    public:
+      Pages(uint32_t size, uint8_t init) ;
+      void Origin(uint32_t origin) ; // byte 0 at origin & 0xff of the first page, for constructors, resets the content
+
+      uint8_t        operator[](uint32_t addr) const { addr += _origin ; return _pages[addr >> 8]->_bytes[addr & 0xff] ; }
+      bool           Set(uint32_t addr, uint8_t value) ; // true if a page was copied, pointers from Write() are stale
+      const uint8_t* Read(uint32_t page) const { return _pages[page]->_bytes ; }
+      uint8_t*       Write(uint32_t page) const { return _unique[page] ? _pages[page]->_bytes : nullptr ; } // nullptr: Set() copies first
+      bool           Shared() const { return _shared.load(std::memory_order_relaxed) ; } // Write() pointers are stale
+      void           Share(const Pages &pages) ; // use the pages of pages, copy on write in both
+
+      std::vector<uint8_t> Bytes() const ;
+      void                 Bytes(const std::vector<uint8_t> &bytes) ;
+
+    private:
+      struct Page { uint8_t _bytes[0x100] ; } ;
+      static std::shared_ptr<Page> Blank(uint8_t init) ;
+      uint32_t _size ;
+      uint8_t  _init ;
+      uint32_t _origin ;
+      std::vector<std::shared_ptr<Page>> _pages ;
+      std::vector<bool>                  _unique ; // written since the last Share(), not used by another Pages
+      mutable std::atomic<bool>          _shared ; // Share() used these pages, _unique is stale
+    } ;
+
+    struct IrqSource
+    {
+      AVR::Io *_io ;
+      uint8_t  _level ;
+    } ;
+
+    struct ScheduledEvent
+    {
+      uint64_t  _ticks ;
+      uint64_t  _seq ; // events at the same tick in scheduling order
+      AVR::Io  *_io ;
+      uint32_t  _id ;
+    } ;
+
+    class XrefTable // shared by clones until modified
+    {
+    public:
+      XrefTable() {}
+      XrefTable(const XrefTable &table) ;
+      XrefTable& operator=(const XrefTable&) = delete ;
+      ~XrefTable() ;
+
+      std::vector<Xref*>            _xrefs ;
+      std::map<uint32_t, Xref*>     _xrefByAddr ;
+      std::map<std::string, Xref*>  _xrefByLabel ;
+    } ;
+
     class IoSP : public Io
     {
     public:
@@ -227,6 +402,32 @@ namespace AVR
       uint8_t _sreg ;
     } ;
 
+    class IoSleep : public Io // SMCR, MCUCR or SLEEP_CTRL
+    {
+    public:
+      class Ctrl : public Io::Register
+      {
+      public:
+        Ctrl(const Mcu &mcu, const std::string &name, IoSleep &sleep) : Register(mcu, name), _sleep(sleep) {}
+        virtual uint8_t  Get() const    { return VG(_sleep.Get()) ; }
+        virtual void     Set(uint8_t v) { _sleep.Set(VS(v)) ; }
+      private:
+        IoSleep &_sleep ;
+      } ;
+
+      IoSleep() : _ctrl(0x00), _se(0x00), _sm(0x00) {}
+      void     Bits(uint8_t se, uint8_t sm) { _se = se ; _sm = sm ; } // sleep enable, sleep mode
+      uint8_t  Get() const    { return _ctrl ; }
+      void     Set(uint8_t v) { _ctrl = v ; }
+      bool     Enabled() const { return _ctrl & _se ; }
+      uint8_t  Mode() const    { return _sm ? (_ctrl & _sm) / (_sm & -_sm) : 0 ; } // 0: idle
+
+    private:
+      uint8_t _ctrl ;
+      uint8_t _se ;
+      uint8_t _sm ;
+    } ;
+
     class IoRamp : public Io
     {
     public:
@@ -255,15 +456,19 @@ namespace AVR
       Trace(const Mcu &mcu) ;
       ~Trace() ;
 
-      bool Open(const std::string &filename, uint32_t addr = 0) ;
+      bool Open(const std::string &filename, uint32_t addr = 0, bool binary = false) ; // binary: see trace.h
       void Add(uint32_t src, uint32_t dst, const Instruction &instr) ;
       bool Close() ;
-      bool operator()() const { return _file != nullptr ; }
+      bool operator()() const { return _file || _writer.IsOpen() ; }
       uint32_t StopAddr() const { return _stop ; }
 
     private:
+      void Text() ;   // previous branch as text line
+      void Binary() ; // previous branch as record
+
       const Mcu &_mcu ;
       FILE      *_file ;
+      Writer     _writer ;
       uint32_t   _src ;
       uint32_t   _dst ;
       uint32_t   _cnt ;
@@ -271,8 +476,154 @@ namespace AVR
       bool       _isCall ;
       uint32_t   _lvl ;
       uint32_t   _stop ;
+      uint64_t   _ticks ;     // first branch of _src -> _dst
+      uint32_t   _prevDst ;   // last record written
+      uint64_t   _prevTicks ;
     } ;
-    
+
+    // execution count and cycles per flash word, SLEEP includes the skipped cycles
+    class Profile
+    {
+    public:
+      Profile(const Mcu &mcu) : _mcu(mcu), _on(false) {}
+
+      void Start() ; // counts are kept until the next Start()
+      void Stop() { _on = false ; }
+      bool operator()() const { return _on ; }
+      void Add(uint32_t pc, uint64_t ticks) { ++_count[pc] ; _ticks[pc] += ticks ; }
+      // skipped busy wait loop [head, branch]: repeat the last iteration, counts before it saved by Get()
+      void Get(uint32_t head, uint32_t branch, uint64_t *count, uint64_t *ticks) const ;
+      void Repeat(uint32_t head, uint32_t branch, const uint64_t *count, const uint64_t *ticks, uint64_t n) ;
+      void Report(FILE *file, uint32_t top) const ; // per function and hot spots, sorted by cycles
+
+    private:
+      const Mcu &_mcu ;
+      bool       _on ;
+      std::vector<uint64_t> _count ;
+      std::vector<uint64_t> _ticks ;
+    } ;
+
+    // cycles per function (exclusive) and per caller -> callee (calls, inclusive) along _stackFrames
+    class CallGraph
+    {
+    public:
+      CallGraph(const Mcu &mcu) : _mcu(mcu), _on(false) {}
+
+      void Start() ; // cleared, the current PC is the root
+      void Stop() ;
+      bool operator()() const { return _on ; }
+      void Call(uint32_t site, uint32_t target) ; // call or interrupt entered, site: PC of the call / interrupted PC
+      void Return(uint32_t site) ;
+      bool Write(const std::string &filename) const ; // callgrind format, open frames up to now
+
+    private:
+      struct Frame
+      {
+        uint32_t _site ;   // caller, see Key()
+        uint32_t _fct ;    // entry address
+        uint64_t _enter ;  // ticks
+        uint64_t _resume ; // ticks, exclusive time counted from
+      } ;
+      using Edge = std::pair<uint32_t, uint32_t> ; // caller, callee; resolved to functions by Write()
+      struct Cost
+      {
+        uint64_t _calls ;
+        uint64_t _ticks ;
+      } ;
+      // called functions by entry address, the root by PC as it may be left by jumps (reset vector)
+      static uint32_t Key(const std::vector<Frame> &frames, uint32_t pc) { return (frames.size() > 1) ? frames.back()._fct : pc ; }
+      static void Leave(std::vector<Frame> &frames, std::map<uint32_t, uint64_t> &self, std::map<Edge, Cost> &edges, uint32_t pc, uint64_t ticks) ;
+
+      const Mcu &_mcu ;
+      bool       _on ;
+      std::vector<Frame>           _frames ;
+      std::map<uint32_t, uint64_t> _self ; // exclusive ticks, see Key()
+      std::map<Edge, Cost>         _edges ;
+    } ;
+
+    // statistical profile: SIGPROF (host CPU time) samples PC and the top of _stackFrames while Run() executes
+    class Sampler
+    {
+    public:
+      Sampler(const Mcu &mcu) : _mcu(mcu), _on(false), _period(0), _remain(0), _fct(kRoot), _head(0), _tail(0), _dropped(0), _samples(0) {}
+      ~Sampler() { Stop() ; }
+
+      bool Start(uint32_t period) ; // us, samples are kept until the next Start()
+      void Stop() ;
+      bool operator()() const { return _on ; }
+      void Frames(const std::vector<StackFrame> &frames) { _fct = frames.empty() ? kRoot : frames.back().second ; } // after push / pop
+      void Arm() ;    // Run() entered
+      void Disarm() ; // Run() left, remaining interval kept for the next Run()
+      void Poll() { if (_head.load(std::memory_order_relaxed) - _tail.load(std::memory_order_relaxed) >= kSize / 2) Drain() ; } // during Run(), a half full ring to histograms
+      void Report(FILE *file, uint32_t top) const ;
+
+    private:
+      static const uint32_t kRoot = 0xffffffff ; // no stack frame
+      static const uint32_t kSize = 0x10000 ;    // ring entries, drained by Poll() every 32s at 1000us
+      struct Sample
+      {
+        uint32_t _pc ;
+        uint32_t _fct ; // entry address of the top stack frame or kRoot
+      } ;
+      static void SigProf(int) ;
+      void Drain() ; // ring to histograms
+
+      static Sampler *_active ; // set while armed
+      const Mcu &_mcu ;
+      bool       _on ;
+      uint32_t   _period ;
+      long       _remain ; // us of the interval left by Disarm()
+      volatile uint32_t      _fct ;
+      std::vector<Sample>    _ring ;
+      std::atomic<uint32_t>  _head ; // written by SigProf() only
+      std::atomic<uint32_t>  _tail ; // written by Drain() only
+      std::atomic<uint32_t>  _dropped ;
+      struct sigaction       _prevAction ;
+      uint64_t                     _samples ;
+      std::map<uint32_t, uint64_t> _pcs ;
+      std::map<uint32_t, uint64_t> _fcts ;
+    } ;
+
+    // executed instructions and taken / not taken conditional branches and skips (IsBranch()),
+    // two flag bits per flash word, merged across runs by Read()
+    class Coverage
+    {
+    public:
+      Coverage(const Mcu &mcu) : _mcu(mcu), _on(false) {}
+
+      void Start() ; // flags are kept, see Clear()
+      void Stop() { _on = false ; }
+      void Clear() ;
+      bool operator()() const { return _on ; }
+      void Add(uint32_t pc, bool next) { _flags[pc] |= next ? kNext : kJumped ; }
+      bool Read(const std::string &filename) ; // or'ed into the current flags
+      bool Write(const std::string &filename) const ;
+      bool ReadLines(const std::string &filename) ; // "<addr> <file>:<line>" per line, word address as in xref files
+      void Report(FILE *file) const ; // per function
+      bool WriteJson(const std::string &filename) const ;
+      bool WriteLcov(const std::string &filename) const ; // needs ReadLines()
+
+    private:
+      static const uint8_t kNext   = 1 ; // executed, continued with the next instruction: branch not taken
+      static const uint8_t kJumped = 2 ; // executed, PC set otherwise: branch taken
+      struct FctCoverage
+      {
+        uint32_t    _addr ;
+        const Xref *_xref ;
+        uint32_t    _instrs ;
+        uint32_t    _executed ;
+        uint32_t    _branches ; // conditional instructions, two outcomes each
+        uint32_t    _taken ;
+        uint32_t    _notTaken ;
+      } ;
+      std::vector<FctCoverage> PerFunction() const ; // loaded flash split at Mcu::Functions()
+
+      const Mcu &_mcu ;
+      bool       _on ;
+      std::vector<uint8_t> _flags ; // per flash word
+      std::map<uint32_t, std::pair<std::string, uint32_t>> _lines ; // flash word -> file, line
+    } ;
+
   protected:
     Mcu(const std::string &name, uint32_t flashSize, uint32_t ioSize, uint32_t ramSize , uint32_t eepromSize, uint32_t sp) ;
     Mcu() = delete ;
@@ -289,6 +640,7 @@ namespace AVR
     uint32_t EepromSize() const { return _eepromSize  ; }
     
     void Execute() ;
+    uint64_t Run(uint64_t count, const volatile bool &stop, uint32_t stopAddr = 0xffffffff) ; // returns number of executed instructions
     uint8_t Skip() ;
     void Status() ;
     std::string Disasm() ;
@@ -300,11 +652,36 @@ namespace AVR
     uint32_t& PC()       { return _pc ; }
 
     uint64_t  Ticks() const { return _ticks ; }
+
+    // Run() stops at, SLEEP and busy wait loops do not fast forward beyond
+    uint64_t  TickLimit() const { return _tickLimit ; }
+    uint64_t& TickLimit()       { return _tickLimit ; }
+
+    // event scheduler: io->Wakeup(id) is called once _ticks reaches ticks,
+    // one event per io / id, scheduling again replaces it.
+    // io must be one of _peripherals to survive Save() / Clone()
+    void     Schedule(uint64_t ticks, AVR::Io *io, uint32_t id = 0) ;
+    void     Unschedule(AVR::Io *io, uint32_t id = 0) ;
+    uint64_t NextEvent() const { return _nextEvent ; }
+
+    // interrupts: a peripheral requests a vector (number, not address) while its flag and enable bits are set,
+    // level is the XMEGA PMIC level (1: low, 2: medium, 3: high), classic AVRs use fixed priority by vector number
+    void Irq(uint32_t vector, bool request, AVR::Io *io, uint8_t level = 1) ;
+    void IrqUpdate() ; // interrupt controller changed, see _irqReady
+    virtual void Reti() ;
+
+    // independent copy of the current state, immutable parts shared copy on write.
+    // Threading: a clone may run on another thread. Clone() marks the shared parts of
+    // the source too, so clone and modify the source on the source's own thread only.
+    Mcu* Clone() const ;
+
+    EngineType  Engine() const { return _engine ; }
+    EngineType& Engine()       { return _engine ; }
     
-    uint8_t  Reg(uint32_t reg) const ;
-    void     Reg(uint32_t reg, uint8_t value) ;
-    uint16_t RegW(uint32_t reg) const ;
-    void     RegW(uint32_t reg, uint16_t value) ;
+    uint8_t  Reg(uint32_t reg) const                { return _reg[reg] ; }
+    void     Reg(uint32_t reg, uint8_t value)       { _reg[reg] = value ; }
+    uint16_t RegW(uint32_t reg) const               { return *(const uint16_t*)(_reg + reg) ; }
+    void     RegW(uint32_t reg, uint16_t value)     { *(uint16_t*)(_reg + reg) = value ; }
     uint8_t  Io(uint32_t io) const ;
     bool     Io(uint32_t io, uint8_t &byte) const ;
     void     Io(uint32_t io, uint8_t value) ;
@@ -314,9 +691,9 @@ namespace AVR
     uint8_t  Eeprom(uint32_t address, bool resetOnError = true) const ;
     Command  Flash(uint32_t addr) const ;
     void     Flash(uint32_t addr, Command cmd) ;
-    virtual uint8_t Data(uint32_t addr, bool resetOnError = true) const ;
-    virtual bool    Data(uint32_t addr, uint8_t &byte) const ;
-    virtual void    Data(uint32_t addr, uint8_t value, bool resetOnError = true) ;
+    uint8_t  Data(uint32_t addr, bool resetOnError = true) const ;
+    bool     Data(uint32_t addr, uint8_t &byte) const ;
+    void     Data(uint32_t addr, uint8_t value, bool resetOnError = true) ;
     virtual Command Program(uint32_t addr) const ;
     virtual void    Program(uint32_t addr, Command cmd) ;
     virtual bool    InRam(uint32_t addr) const ;
@@ -348,31 +725,40 @@ namespace AVR
     void  PopPC() ;
 
     const std::vector<StackFrame>& StackFrames() const { return _stackFrames ; }
-    void ResetStackFrames()                            { _stackFrames.clear() ; }
+    void ResetStackFrames()                            { _stackFrames.clear() ; _sampler.Frames(_stackFrames) ; }
+
+    static const uint32_t kHistorySize = 256 ; // power of 2
+    void BranchHistory(FILE *file, uint32_t count = kHistorySize) const ; // last taken branches, oldest first
     
     void  Break() ; // call BREAK handlers
     void  Sleep() ;
     void  WDR() ;
     void  NotImplemented(const Instruction&) ; // unimplemented instructions
 
-    const std::vector<const Instruction*>& Instructions() const { return _instructions ; }
-    const std::vector<Command>&            Flash()        const { return _flash        ; }
+    const std::vector<const Instruction*>& Instructions() const { return *_instructions  ; }
+    const std::vector<Command>&            Flash()        const { return _image->_flash ; }
     const std::vector<Io::Register*>&      Io()           const { return _io           ; }
     
     void   ClearFlash() ;
     uint32_t SetFlash(uint32_t address, const std::vector<Command> &prg) ;
     uint32_t SetEeprom(uint32_t address, const std::vector<uint8_t> &eeprom) ;
 
+    bool Save(const std::string &filename) const ; // snapshot of the complete MCU state
+    bool Load(const std::string &filename) ;       // snapshot of the same MCU type only
+
     const Xref* XrefByAddr(uint32_t addr) const ;
     const Xref* XrefByLabel(const std::string &label) const ;
     bool        XrefAdd(const Xref &xref) ;
     bool        XrefAdd(XrefType type, uint32_t target, uint32_t source) ;
-    const std::vector<Xref*>&           Xrefs() const { return _xrefs ; }
-    const std::map<uint32_t   , Xref*>& XrefByAddr()  const { return _xrefByAddr  ; }
-    const std::map<std::string, Xref*>& XrefByLabel() const { return _xrefByLabel ; }
-
-    void AddBreakpoint(uint32_t addr) { _breakpoints.insert(addr) ; }
-    void DelBreakpoint(uint32_t addr) { _breakpoints.erase(addr) ; }
+    const std::vector<Xref*>&           Xrefs() const { return _xrefTable->_xrefs ; }
+    const std::map<uint32_t   , Xref*>& XrefByAddr()  const { return _xrefTable->_xrefByAddr  ; }
+    const std::map<std::string, Xref*>& XrefByLabel() const { return _xrefTable->_xrefByLabel ; }
+    // function entries: called, named (xref file, vectors) or jumped to from a named address (vector table)
+    std::map<uint32_t, const Xref*> Functions() const ;
+    static const Xref* Function(const std::map<uint32_t, const Xref*> &functions, uint32_t pc) ; // entry at or before pc
+
+    void AddBreakpoint(uint32_t addr) ;
+    void DelBreakpoint(uint32_t addr) ;
     bool IsBreakpoint(uint32_t addr) const { return _breakpoints.find(addr) != _breakpoints.end() ; }
     bool IsBreakpoint()                 const { return _breakpoints.find(_pc ) != _breakpoints.end() ; }
     const std::set<uint32_t>& Breakpoints() const { return _breakpoints ; }
@@ -381,19 +767,79 @@ namespace AVR
     bool IsXmega()       const { return _isXMega       ; }
     bool IsTinyReduced() const { return _isTinyReduced ; }
 
-    bool TraceOn(const std::string &filename, uint32_t addr = 0) { return _trace.Open(filename, addr) ; }
-    bool TraceOff()                                                 { return _trace.Close()              ; }
+    bool TraceOn(const std::string &filename, uint32_t addr = 0, bool binary = false) { return _trace.Open(filename, addr, binary) ; }
+    bool TraceOff()                                                                    { return _trace.Close()                      ; }
+
+    void ProfileOn()  { _profile.Start() ; }
+    void ProfileOff() { _profile.Stop()  ; }
+    bool IsProfile() const { return _profile() ; }
+    void ProfileReport(FILE *file, uint32_t top = 20) const { _profile.Report(file, top) ; }
+
+    void CallGraphOn()  { _callGraph.Start() ; }
+    void CallGraphOff() { _callGraph.Stop()  ; }
+    bool CallGraphWrite(const std::string &filename) const { return _callGraph.Write(filename) ; }
+
+    bool SamplerOn(uint32_t period = 1000) { return _sampler.Start(period) ; }
+    void SamplerOff() { _sampler.Stop() ; }
+    void SamplerReport(FILE *file, uint32_t top = 20) const { _sampler.Report(file, top) ; }
+
+    void CoverageOn()    { _coverage.Start() ; }
+    void CoverageOff()   { _coverage.Stop()  ; }
+    void CoverageClear() { _coverage.Clear() ; }
+    bool CoverageRead (const std::string &filename)       { return _coverage.Read(filename)  ; } // merged
+    bool CoverageWrite(const std::string &filename) const { return _coverage.Write(filename) ; }
+    bool CoverageLines(const std::string &filename)       { return _coverage.ReadLines(filename) ; }
+    void CoverageReport(FILE *file) const                 { _coverage.Report(file) ; }
+    bool CoverageJson(const std::string &filename) const  { return _coverage.WriteJson(filename) ; }
+    bool CoverageLcov(const std::string &filename) const  { return _coverage.WriteLcov(filename) ; }
 
     VerboseType  Verbose() const { return _verbose ; }
     VerboseType& Verbose()       { return _verbose ; }
+    bool IsVerbose(VerboseType vt) const { return ((unsigned int)_verbose | (unsigned int)_filterVerbose) & (unsigned int)vt ; } // stdout or any filter listening
     void Verbose(VerboseType vt, const std::string &text) const ;
+    void Verbose(const VerboseEvent &event) const { if (IsVerbose(event.Verbose()) || (_executing && (event.Verbose() == VerboseType::ProgError))) Verbose(event.Verbose(), event.Text()) ; }
     void AddFilter(VerboseType vt, const std::string &command) ;
+    uint64_t ProgErrors() const                 { return _progErrors   ; } // during Run() / Execute()
+    void StopOnProgError(volatile bool *stop)   { _progErrorStop = stop ; } // *stop = true on the next ProgError, nullptr: keep running
     void DelFilter(pid_t pid) ;
     const std::vector<Filter*>& Filters() const { return _filters ; }
     
   protected:
-    void AddInstruction(const Instruction *instr) ;
+    virtual Mcu* New() const = 0 ; // fresh instance of the same type, for Clone()
+    void SaveState(Snapshot &snapshot, bool memory = true) const ; // everything but flash, RAM and EEPROM only with memory
+    bool LoadState(Snapshot &snapshot, bool memory = true) ;       // false for a damaged snapshot, the state is then undefined
+    void UniqueImage() ; // copy on write of _image
+    void UniqueXrefs() ; // copy on write of _xrefTable
+    static std::shared_ptr<Image> BlankImage(uint32_t flashSize) ;
+
+    // data space not mapped by _dataPages / _dataWrite
+    virtual uint8_t DataSpace(uint32_t addr, bool resetOnError) const ;
+    virtual bool    DataSpace(uint32_t addr, uint8_t &byte) const ;
+    virtual void    DataSpace(uint32_t addr, uint8_t value, bool resetOnError) ;
+    void MapRam(uint32_t addr) ; // RAM at addr of the data space
+    void MapPages() ;            // _dataPages / _dataWrite after _ram changed pages
+
+    void ExecuteReference() ;
+    void ExecuteFast() ;
+    void ExecuteDone(uint32_t pc0, uint16_t sp0, const Instruction &instr) ;
+    uint64_t RunThreaded(uint64_t count, const volatile bool &stop, uint32_t stopAddr) ; // instr.cpp
+    void Events() ; // due scheduled events
+    void Interrupt() ; // take the pending interrupt
+    virtual bool IrqSelect(uint32_t &vector) const ; // pending interrupt that can be taken
+    virtual void IrqEnter(uint32_t vector) ;
+    static bool EventLater(const ScheduledEvent &a, const ScheduledEvent &b) ;
+    bool EventLive(const ScheduledEvent &event) const ; // not replaced or unscheduled
+    void EventsTidy() ; // drop stale events, update _nextEvent
+    uint64_t RunBlocks(uint64_t count, const volatile bool &stop, uint32_t stopAddr) ;
+    const Block* FindBlock(uint32_t addr) ;
+    void DropTranslations() ; // _blocks and _idleLoops after flash or breakpoint changes
+    uint64_t IdleLoop(uint32_t branch, uint64_t count, uint32_t stopAddr) ; // returns number of executed and skipped instructions
+    bool IdleLoopBody(uint32_t head, uint32_t branch) const ;
+    bool IdleLoopUntil(uint32_t head, uint32_t branch, uint64_t &until) const ;
+    void SetInstructions(const std::vector<const Instruction*> &instructions) ;
     void AnalyzeXrefs() ;
+    void Decode(uint32_t addr) ;
+    void Decode() ;
 
   protected:
     const std::string _name ;
@@ -401,44 +847,138 @@ namespace AVR
     uint32_t _pc ;
     IoSP     _sp ;
     IoSREG   _sreg ;
+    IoSleep  _sleep ;
     IoRamp   _rampx, _rampy, _rampz ;
     IoRamp   _rampd, _eind ;
     uint64_t _ticks ;
+    uint64_t _tickLimit ;
+
+    std::vector<ScheduledEvent> _events ; // min heap, live and stale entries, the front is live
+    uint64_t                    _nextEvent ; // _events.front()._ticks, UINT64_MAX if none
+    uint64_t                    _eventSeq ;
+    std::map<std::pair<AVR::Io*, uint32_t>, uint64_t> _eventSeqs ; // io / id to _seq of its live entry
+    size_t                      _eventsStale ; // stale entries in _events
+
+    static const uint32_t kIrqVectors = 128 ;
+    uint64_t  _irqPending[kIrqVectors / 64] ; // requested vectors
+    IrqSource _irqSources[kIrqVectors] ;
+    uint8_t   _irqReady ;      // SREG I bit if IrqSelect() finds an interrupt, checked after each instruction
+    uint32_t  _irqVectorSize ; // words per vector, 2 with JMP
     
     uint32_t             _flashSize ;
     uint32_t             _loadedFlashSize ;
-    std::vector<Command> _flash ;
+    std::shared_ptr<Image> _image ; // call UniqueImage() before writing
+    mutable std::atomic<bool> _imageShared ; // _image is (or was) used by another Mcu, immutable
+    Command             *_flash ;   // _image->_flash
+    Decoded             *_decoded ; // _image->_decoded, _flash predecoded, kept in sync by Flash() / SetFlash()
+    std::vector<uint32_t> _blockIdx ; // flash address to _blocks index + 1, 0: not translated
+    std::vector<Block>    _blocks ;
+    bool                  _blocksDirty ; // flash or breakpoints changed, drop _blocks and _idleLoops
+    bool                  _leaveBlock ;  // checks at block entry are stale: interrupt ready or earlier event
+    static const uint64_t kMaxInstrTicks = 5 ; // CALL, RETI with 22 bit PC; SLEEP and SPM are not in blocks
+
+    static const uint32_t kIdleLoopSize = 16 ; // max words of a busy wait loop
+    enum : uint8_t { IdleUnknown, IdleNo, IdleBody } ;
+    std::vector<uint8_t>  _idleLoops ; // flash address of a backward branch to IdleUnknown, IdleNo or IdleBody
 
     uint8_t                     _reg[0x20] ;
 
     uint32_t                    _ioSize ;
     std::vector<Io::Register*>  _io ;
+    std::vector<AVR::Io*>       _peripherals ; // peripheral state for snapshots, registered by derived MCUs
 
     uint32_t             _ramSize ;
-    std::vector<uint8_t> _ram ;
+    uint32_t             _ramAddr ;
+    Pages                _ram ;
+    const uint8_t       *_dataPages[0x100] ; // 256 byte pages of the 64k data space, _ram if the whole page is RAM else nullptr
+    uint8_t             *_dataWrite[0x100] ; // as _dataPages, nullptr while the page is shared with a clone
     
     uint32_t             _eepromSize ;
-    std::vector<uint8_t> _eeprom ;
+    Pages                _eeprom ;
 
     std::vector<StackFrame> _stackFrames ;
+
+    // last taken jumps / branches / skips / calls / returns / interrupts, always on
+    struct Branch
+    {
+      uint32_t _src ; // kBranchIrq: interrupted PC
+      uint32_t _dst ;
+      uint64_t _ticks ;
+    } ;
+    static const uint32_t kBranchIrq = 0x80000000 ;
+    Branch   _history[kHistorySize] ;
+    uint64_t _historyPos ; // total count, next entry at _historyPos % kHistorySize
     
     bool _pcIs22Bit     ;
     bool _isXMega       ;
     bool _isTinyReduced ;
     
     std::vector<KnownProgramAddress> _knownProgramAddresses ;
-    std::vector<Xref*>               _xrefs ;
-    std::map<uint32_t, Xref*>        _xrefByAddr ;
-    std::map<std::string, Xref*>     _xrefByLabel ;
+    std::shared_ptr<XrefTable>       _xrefTable ; // call UniqueXrefs() before writing
+    mutable std::atomic<bool>        _xrefsShared ; // _xrefTable is (or was) used by another Mcu, immutable
     std::set<uint32_t>               _breakpoints ;
-    std::vector<const Instruction*>  _instructions ; // map cmd to instruction
+    std::shared_ptr<const std::vector<const Instruction*>> _instructions ; // map cmd to instruction, shared per instruction set
 
     std::vector<Filter*> _filters ;
+    VerboseType          _filterVerbose ; // all _filters Verbose() combined
     Trace _trace ;
+    Profile _profile ;
+    CallGraph _callGraph ;
+    Sampler _sampler ;
+    Coverage _coverage ;
 
     VerboseType _verbose ;
+    EngineType  _engine ;
+    bool        _executing ; // in Run() / Execute(), ProgErrors go to stderr with the branch history
+    mutable uint64_t _progErrors ;
+    volatile bool   *_progErrorStop ;
   } ;
 
+  ////////////////////////////////////////////////////////////////////////////////
+  // Mcu data space
+
+  inline uint8_t Mcu::Data(uint32_t addr, bool resetOnError) const
+  {
+    const uint8_t *page = (addr < 0x10000) ? _dataPages[addr >> 8] : nullptr ;
+    return page ? page[addr & 0xff] : DataSpace(addr, resetOnError) ;
+  }
+
+  inline bool Mcu::Data(uint32_t addr, uint8_t &byte) const
+  {
+    const uint8_t *page = (addr < 0x10000) ? _dataPages[addr >> 8] : nullptr ;
+    if (!page)
+      return DataSpace(addr, byte) ;
+    byte = page[addr & 0xff] ;
+    return true ;
+  }
+
+  inline void Mcu::Data(uint32_t addr, uint8_t value, bool resetOnError)
+  {
+    uint8_t *page = (addr < 0x10000) ? _dataWrite[addr >> 8] : nullptr ;
+    if (page && !_ram.Shared())
+      page[addr & 0xff] = value ;
+    else
+      DataSpace(addr, value, resetOnError) ;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Io::Register verbose
+  ////////////////////////////////////////////////////////////////////////////////
+
+  inline uint8_t Io::Register::VG(uint8_t v) const
+  {
+    if (_mcu.IsVerbose(VerboseType::Io))
+      VerboseIo("read", v) ;
+    return v ;
+  }
+
+  inline uint8_t Io::Register::VS(uint8_t v) const
+  {
+    if (_mcu.IsVerbose(VerboseType::Io))
+      VerboseIo("write", v) ;
+    return v ;
+  }
+
   ////////////////////////////////////////////////////////////////////////////////
   // AVR any
   ////////////////////////////////////////////////////////////////////////////////
@@ -448,6 +988,9 @@ namespace AVR
   public:
     ATany() ;
     virtual ~ATany() ;
+
+  protected:
+    virtual Mcu* New() const { return new ATany() ; }
   } ;
 
   ////////////////////////////////////////////////////////////////////////////////
@@ -457,11 +1000,12 @@ namespace AVR
   class ATmegaXX8 : public Mcu
   {
   protected:
-    ATmegaXX8(const std::string &name, uint32_t flashSize, uint32_t ramSize, uint32_t eepromSize) ;
+    ATmegaXX8(const std::string &name, uint32_t flashSize, uint32_t ramSize, uint32_t eepromSize, bool hasJmpCall) ;
     virtual ~ATmegaXX8() ;
 
     IoEeprom ioEeprom ;
     IoUsart  _usart0 ;
+    IoTimer8 _timer0 ;
   } ;
 
   class ATmega328P : public ATmegaXX8
@@ -469,6 +1013,9 @@ namespace AVR
   public:
     ATmega328P() ;
     virtual ~ATmega328P() ;
+
+  protected:
+    virtual Mcu* New() const { return new ATmega328P() ; }
   } ;
 
   class ATmega168PA : public ATmegaXX8
@@ -476,6 +1023,9 @@ namespace AVR
   public:
     ATmega168PA() ;
     virtual ~ATmega168PA() ;
+
+  protected:
+    virtual Mcu* New() const { return new ATmega168PA() ; }
   } ;
 
   class ATmega88PA : public ATmegaXX8
@@ -483,6 +1033,9 @@ namespace AVR
   public:
     ATmega88PA() ;
     virtual ~ATmega88PA() ;
+
+  protected:
+    virtual Mcu* New() const { return new ATmega88PA() ; }
   } ;
 
   class ATmega48PA : public ATmegaXX8
@@ -490,6 +1043,9 @@ namespace AVR
   public:
     ATmega48PA() ;
     virtual ~ATmega48PA() ;
+
+  protected:
+    virtual Mcu* New() const { return new ATmega48PA() ; }
   } ;
 
   ////////////////////////////////////////////////////////////////////////////////
@@ -503,7 +1059,10 @@ namespace AVR
     virtual ~ATmega8A() ;
 
   protected:
+    virtual Mcu* New() const { return new ATmega8A() ; }
+
     IoEeprom ioEeprom ;
+    IoTimer8 _timer0 ;
   } ;
 
   ////////////////////////////////////////////////////////////////////////////////
@@ -518,6 +1077,7 @@ namespace AVR
 
   protected:
     IoEeprom ioEeprom ;
+    IoTimer8 _timer0 ;
   } ;
 
   class ATtiny84A : public ATtinyX4
@@ -525,6 +1085,9 @@ namespace AVR
   public:
     ATtiny84A() ;
     virtual ~ATtiny84A() ;
+
+  protected:
+    virtual Mcu* New() const { return new ATtiny84A() ; }
   } ;
 
   class ATtiny44A : public ATtinyX4
@@ -532,6 +1095,9 @@ namespace AVR
   public:
     ATtiny44A() ;
     virtual ~ATtiny44A() ;
+
+  protected:
+    virtual Mcu* New() const { return new ATtiny44A() ; }
   } ;
 
   class ATtiny24A : public ATtinyX4
@@ -539,6 +1105,9 @@ namespace AVR
   public:
     ATtiny24A() ;
     virtual ~ATtiny24A() ;
+
+  protected:
+    virtual Mcu* New() const { return new ATtiny24A() ; }
   } ;
 
   ////////////////////////////////////////////////////////////////////////////////
@@ -553,6 +1122,7 @@ namespace AVR
 
   protected:
     IoEeprom ioEeprom ;
+    IoTimer8 _timer0 ;
   } ;
 
   class ATtiny85 : public ATtinyX5
@@ -560,6 +1130,9 @@ namespace AVR
   public:
     ATtiny85() ;
     virtual ~ATtiny85() ;
+
+  protected:
+    virtual Mcu* New() const { return new ATtiny85() ; }
   } ;
 
   class ATtiny45 : public ATtinyX5
@@ -567,6 +1140,9 @@ namespace AVR
   public:
     ATtiny45() ;
     virtual ~ATtiny45() ;
+
+  protected:
+    virtual Mcu* New() const { return new ATtiny45() ; }
   } ;
 
   class ATtiny25 : public ATtinyX5
@@ -574,6 +1150,9 @@ namespace AVR
   public:
     ATtiny25() ;
     virtual ~ATtiny25() ;
+
+  protected:
+    virtual Mcu* New() const { return new ATtiny25() ; }
   } ;
 
   ////////////////////////////////////////////////////////////////////////////////
@@ -582,13 +1161,16 @@ namespace AVR
 
   class ATxmegaAU : public Mcu
   {
-    virtual uint8_t Data(uint32_t addr, bool resetOnError = true) const ;
-    virtual bool    Data(uint32_t addr, uint8_t &byte) const ;
-    virtual void    Data(uint32_t addr, uint8_t value, bool resetOnError = true) ;
+    virtual uint8_t DataSpace(uint32_t addr, bool resetOnError) const ;
+    virtual bool    DataSpace(uint32_t addr, uint8_t &byte) const ;
+    virtual void    DataSpace(uint32_t addr, uint8_t value, bool resetOnError) ;
     virtual Command Program(uint32_t addr) const ;
     virtual void    Program(uint32_t addr, Command cmd) ;
     virtual bool    InRam(uint32_t addr) const ;
     virtual void    RamRange(uint32_t &min, uint32_t &max) const ;
+    virtual bool    IrqSelect(uint32_t &vector) const ;
+    virtual void    IrqEnter(uint32_t vector) ;
+    virtual void    Reti() ;
 
     uint8_t UserSignature(uint32_t addr) const ;
     uint8_t ProductionSignature(uint32_t addr) const ;
@@ -597,10 +1179,16 @@ namespace AVR
     ATxmegaAU(const std::string &name, uint32_t flashSize, uint32_t ramSize, uint32_t eepromSize) ;
     virtual ~ATxmegaAU() ;
 
+    IoXmegaPmic  _pmic ;
     IoXmegaCpu   _cpu ;
     IoXmegaClk   _clk ;
     IoXmegaNvm   _nvm ;
     IoXmegaRtc   _rtc ;
+    IoXmegaTc    _tcC0 ;
+    IoXmegaTc    _tcC1 ;
+    IoXmegaTc    _tcD0 ;
+    IoXmegaTc    _tcD1 ;
+    IoXmegaTc    _tcE0 ;
     IoXmegaUsart _usartC0 ;
     IoXmegaUsart _usartC1 ;
     IoXmegaUsart _usartD0 ;
@@ -613,6 +1201,9 @@ namespace AVR
   public:
     ATxmega128A4U() ;
     virtual ~ATxmega128A4U() ;
+
+  protected:
+    virtual Mcu* New() const { return new ATxmega128A4U() ; }
   } ;
 
   class ATxmega64A4U : public ATxmegaAU
@@ -620,6 +1211,9 @@ namespace AVR
   public:
     ATxmega64A4U() ;
     virtual ~ATxmega64A4U() ;
+
+  protected:
+    virtual Mcu* New() const { return new ATxmega64A4U() ; }
   } ;
 
   class ATxmega32A4U : public ATxmegaAU
@@ -627,6 +1221,9 @@ namespace AVR
   public:
     ATxmega32A4U() ;
     virtual ~ATxmega32A4U() ;
+
+  protected:
+    virtual Mcu* New() const { return new ATxmega32A4U() ; }
   } ;
 
   class ATxmega16A4U : public ATxmegaAU
@@ -634,6 +1231,9 @@ namespace AVR
   public:
     ATxmega16A4U() ;
     virtual ~ATxmega16A4U() ;
+
+  protected:
+    virtual Mcu* New() const { return new ATxmega16A4U() ; }
   } ;
 
 }
@@ -276,12 +276,7 @@ bool CommandStep::Execute(AVR::Mcu &mcu)
   switch (mode[0])
   {
   case 's':
-    for (uint32_t i = 0 ; (i < count) && !SigInt ; ++i)
-    {
-      mcu.Execute() ;
-      if (mcu.IsBreakpoint())
-        break ;
-    }
+    mcu.Run(count, SigInt) ;
     break ;
   case 'n':
     for (uint32_t i = 0 ; (i < count) && !SigInt ; ++i)
@@ -364,13 +359,7 @@ bool CommandRun::Execute(AVR::Mcu &mcu)
     return false ;
   }
   
-  while (!SigInt)
-  {
-    mcu.Execute() ;
-    if ((!infinity && (mcu.PC() == addr)) ||
-        mcu.IsBreakpoint())
-      break ;
-  }
+  mcu.Run(UINT64_MAX, SigInt, infinity ? 0xffffffff : addr) ;
   signal(SIGINT, prevIntHdl) ;
   if (SigInt)
     _exec.SigInt() ;
@@ -894,6 +883,36 @@ bool CommandListStackFrames::Execute(AVR::Mcu &mcu)
   return true ;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// CommandBranchHistory
+////////////////////////////////////////////////////////////////////////////////
+
+class CommandBranchHistory : public Command
+{
+public:
+  CommandBranchHistory() : Command(R"XXX(\s*bh(?:\s+)XXX" + _reNum + R"XXX()?\s*)XXX") { }
+  ~CommandBranchHistory() { }
+
+  virtual strings Help() const ;
+  virtual bool    Execute(AVR::Mcu &mcu) ;
+} ;
+
+strings CommandBranchHistory::Help() const
+{
+  return strings { "bh [<count>]                  list last taken branches, calls, returns and interrupts (default 20)" } ;
+}
+bool CommandBranchHistory::Execute(AVR::Mcu &mcu)
+{
+  const std::string &num = _match[1] ;
+
+  uint32_t count = 20 ;
+  if (num.size() && !Num(num, count))
+    return false ;
+  mcu.BranchHistory(stdout, count) ;
+
+  return false ;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // CommandListSymbols
 ////////////////////////////////////////////////////////////////////////////////
@@ -1169,7 +1188,7 @@ bool CommandFilterList::Execute(AVR::Mcu &mcu)
 class CommandTrace : public Command
 {
 public:
-  CommandTrace() : Command{R"XXX(\s*t\s+(?:(?:on\s+([-_/.0-9a-zA-Z]+))?(?:\s+)XXX" + _reAddr + R"XXX()?|off)\s*)XXX"} {}
+  CommandTrace() : Command{R"XXX(\s*t\s+(?:(?:(on|bin)\s+([-_/.0-9a-zA-Z]+))?(?:\s+)XXX" + _reAddr + R"XXX()?|off)\s*)XXX"} {}
   ~CommandTrace() {}
 
   virtual strings Help() const ;
@@ -1181,14 +1200,16 @@ strings CommandTrace::Help() const
   return strings
   {
     "t on <name> [<addr>]          log to trace file until addr is reached (default 0x00000)",
+    "t bin <name> [<addr>]         log to binary trace file, see AVRtrace",
     "t off                         close trace file",
   } ;
 }
 bool CommandTrace::Execute(AVR::Mcu &mcu)
 {
-  const std::string &name = _match[1] ;
-  const std::string &num  = _match[2] ;
-  const std::string &lbl  = _match[3] ;
+  const std::string &mode = _match[1] ;
+  const std::string &name = _match[2] ;
+  const std::string &num  = _match[3] ;
+  const std::string &lbl  = _match[4] ;
 
   if (name.size())
   {
@@ -1198,7 +1219,7 @@ bool CommandTrace::Execute(AVR::Mcu &mcu)
       std::cout << "illegal value" << std::endl ;
       return false ;
     }
-    mcu.TraceOn(name, addr) ;
+    mcu.TraceOn(name, addr, mode == "bin") ;
   }
   else
   {
@@ -1208,6 +1229,233 @@ bool CommandTrace::Execute(AVR::Mcu &mcu)
   return false ;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+// CommandProfile
+////////////////////////////////////////////////////////////////////////////////
+class CommandProfile : public Command
+{
+public:
+  CommandProfile() : Command{R"XXX(\s*prof(?:\s+(on|off)|\s+)XXX" + _reNum + R"XXX()?\s*)XXX"} {}
+  ~CommandProfile() {}
+
+  virtual strings Help() const ;
+  virtual bool Execute(AVR::Mcu &mcu) ;
+} ;
+
+strings CommandProfile::Help() const
+{
+  return strings
+  {
+    "prof on                       clear and start execution profile",
+    "prof off                      stop execution profile",
+    "prof [<count>]                list hot functions and addresses (default 20)",
+  } ;
+}
+bool CommandProfile::Execute(AVR::Mcu &mcu)
+{
+  const std::string &onOff = _match[1] ;
+  const std::string &num   = _match[2] ;
+
+  if (onOff == "on")
+    mcu.ProfileOn() ;
+  else if (onOff == "off")
+    mcu.ProfileOff() ;
+  else
+  {
+    uint32_t top = 20 ;
+    if (num.size())
+      Num(num, top) ;
+    mcu.ProfileReport(stdout, top) ;
+  }
+
+  return false ;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CommandCallGraph
+////////////////////////////////////////////////////////////////////////////////
+class CommandCallGraph : public Command
+{
+public:
+  CommandCallGraph() : Command{R"XXX(\s*cg\s+(?:(on|off)|([-_/.0-9a-zA-Z]+))\s*)XXX"} {}
+  ~CommandCallGraph() {}
+
+  virtual strings Help() const ;
+  virtual bool Execute(AVR::Mcu &mcu) ;
+} ;
+
+strings CommandCallGraph::Help() const
+{
+  return strings
+  {
+    "cg on                         clear and start call graph profile",
+    "cg off                        stop call graph profile",
+    "cg <name>                     write call graph to callgrind file",
+  } ;
+}
+bool CommandCallGraph::Execute(AVR::Mcu &mcu)
+{
+  const std::string &onOff = _match[1] ;
+  const std::string &name  = _match[2] ;
+
+  if (onOff == "on")
+    mcu.CallGraphOn() ;
+  else if (onOff == "off")
+    mcu.CallGraphOff() ;
+  else if (!mcu.CallGraphWrite(name))
+    std::cout << "failed to write callgrind file " << name << std::endl ;
+
+  return false ;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CommandSampler
+////////////////////////////////////////////////////////////////////////////////
+class CommandSampler : public Command
+{
+public:
+  CommandSampler() : Command{R"XXX(\s*sample(?:\s+(on|off))?(?:\s+)XXX" + _reNum + R"XXX()?\s*)XXX"} {}
+  ~CommandSampler() {}
+
+  virtual strings Help() const ;
+  virtual bool Execute(AVR::Mcu &mcu) ;
+} ;
+
+strings CommandSampler::Help() const
+{
+  return strings
+  {
+    "sample on [<us>]              clear and start sampling PC every us host CPU time (default 1000)",
+    "sample off                    stop sampling",
+    "sample [<count>]              list sampled functions and addresses (default 20)",
+  } ;
+}
+bool CommandSampler::Execute(AVR::Mcu &mcu)
+{
+  const std::string &onOff = _match[1] ;
+  const std::string &num   = _match[2] ;
+
+  uint32_t value = 0 ;
+  if (num.size() && !Num(num, value))
+    return false ;
+
+  if (onOff == "on")
+  {
+    if (!mcu.SamplerOn(num.size() ? value : 1000))
+      std::cout << "failed to start sampler" << std::endl ;
+  }
+  else if (onOff == "off")
+    mcu.SamplerOff() ;
+  else
+    mcu.SamplerReport(stdout, num.size() ? value : 20) ;
+
+  return false ;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CommandCoverage
+////////////////////////////////////////////////////////////////////////////////
+class CommandCoverage : public Command
+{
+public:
+  CommandCoverage() : Command{R"XXX(\s*cov(?:\s+(on|off|clear)|\s+(load|save|lines|json|lcov)\s+([-_/.0-9a-zA-Z]+))?\s*)XXX"} {}
+  ~CommandCoverage() {}
+
+  virtual strings Help() const ;
+  virtual bool Execute(AVR::Mcu &mcu) ;
+} ;
+
+strings CommandCoverage::Help() const
+{
+  return strings
+  {
+    "cov on                        start instruction and branch coverage",
+    "cov off                       stop coverage",
+    "cov clear                     clear coverage",
+    "cov load <name>               merge coverage file",
+    "cov save <name>               write coverage file",
+    "cov lines <name>              read line info, lines of \"<addr> <file>:<line>\"",
+    "cov json <name>               write coverage per function as JSON",
+    "cov lcov <name>               write coverage as lcov tracefile (needs line info)",
+    "cov                           list coverage per function",
+  } ;
+}
+bool CommandCoverage::Execute(AVR::Mcu &mcu)
+{
+  const std::string &onOff = _match[1] ;
+  const std::string &op    = _match[2] ;
+  const std::string &name  = _match[3] ;
+
+  bool ok = true ;
+  if      (onOff == "on"   ) mcu.CoverageOn()    ;
+  else if (onOff == "off"  ) mcu.CoverageOff()   ;
+  else if (onOff == "clear") mcu.CoverageClear() ;
+  else if (op == "load"    ) ok = mcu.CoverageRead(name)  ;
+  else if (op == "save"    ) ok = mcu.CoverageWrite(name) ;
+  else if (op == "lines"   ) ok = mcu.CoverageLines(name) ;
+  else if (op == "json"    ) ok = mcu.CoverageJson(name)  ;
+  else if (op == "lcov"    ) ok = mcu.CoverageLcov(name)  ;
+  else                       mcu.CoverageReport(stdout)   ;
+  if (!ok)
+    std::cout << "cov " << op << " " << name << " failed" << std::endl ;
+
+  return false ;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CommandSave
+////////////////////////////////////////////////////////////////////////////////
+class CommandSave : public Command
+{
+public:
+  CommandSave() : Command{R"XXX(\s*save\s+([-_/.0-9a-zA-Z]+)\s*)XXX"} {}
+  ~CommandSave() {}
+
+  virtual strings Help() const ;
+  virtual bool Execute(AVR::Mcu &mcu) ;
+} ;
+
+strings CommandSave::Help() const
+{
+  return strings { "save <name>                   save MCU state to snapshot file" } ;
+}
+bool CommandSave::Execute(AVR::Mcu &mcu)
+{
+  const std::string &name = _match[1] ;
+
+  if (!mcu.Save(name))
+    std::cout << "failed to write snapshot file " << name << std::endl ;
+
+  return false ;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// CommandLoad
+////////////////////////////////////////////////////////////////////////////////
+class CommandLoad : public Command
+{
+public:
+  CommandLoad() : Command{R"XXX(\s*load\s+([-_/.0-9a-zA-Z]+)\s*)XXX"} {}
+  ~CommandLoad() {}
+
+  virtual strings Help() const ;
+  virtual bool Execute(AVR::Mcu &mcu) ;
+} ;
+
+strings CommandLoad::Help() const
+{
+  return strings { "load <name>                   restore MCU state from snapshot file" } ;
+}
+bool CommandLoad::Execute(AVR::Mcu &mcu)
+{
+  const std::string &name = _match[1] ;
+
+  if (!mcu.Load(name))
+    std::cout << "failed to read snapshot file " << name << std::endl ;
+
+  return false ;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // CommandMacro
 ////////////////////////////////////////////////////////////////////////////////
@@ -1473,6 +1721,7 @@ namespace AVR
       new CommandWriteData(),
       new CommandWriteProg(),
       new CommandListStackFrames(),
+      new CommandBranchHistory(),
       new CommandListSymbols(),
       new CommandIoAddHex(),
       new CommandIoAddAsc(),
@@ -1483,6 +1732,12 @@ namespace AVR
       new CommandFilterAdd(),
       new CommandFilterList(),
       new CommandTrace(),
+      new CommandProfile(),
+      new CommandCallGraph(),
+      new CommandSampler(),
+      new CommandCoverage(),
+      new CommandSave(),
+      new CommandLoad(),
       new CommandEcho(),
       new CommandQuit(*this),
       new CommandHelp(*this),
@@ -1551,6 +1806,53 @@ namespace AVR
       }
     }
   }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Batch
+  ////////////////////////////////////////////////////////////////////////////////
+
+  Batch::Result Batch::Run(uint64_t maxCycles, uint32_t stopAddr)
+  {
+    void (*prevIntHdl)(int) ;
+    SigInt = false ;
+    prevIntHdl = signal(SIGINT, SigIntHdl) ;
+
+    Result result = Stopped ;
+    uint64_t tickLimit = _mcu.TickLimit() ;
+    uint64_t progErrors = _mcu.ProgErrors() ;
+    _mcu.TickLimit() = maxCycles ;
+    _mcu.StopOnProgError(&SigInt) ; // leave Run() at once
+    while (true)
+    {
+      if (_mcu.ProgErrors() != progErrors)
+      {
+        result = ProgError ;
+        break ;
+      }
+      if (SigInt)
+      {
+        result = Interrupted ;
+        break ;
+      }
+      if (_mcu.PC() == stopAddr)
+        break ;
+      if (_mcu.Ticks() >= maxCycles)
+      {
+        if (stopAddr != 0xffffffff)
+          result = CycleLimit ;
+        break ;
+      }
+
+      // no instruction takes more than 5 cycles, SLEEP and busy wait loops stop at TickLimit()
+      uint64_t count = (maxCycles - _mcu.Ticks()) / 5 ;
+      _mcu.Run(count ? count : 1, SigInt, stopAddr) ;
+    }
+    _mcu.TickLimit() = tickLimit ;
+    _mcu.StopOnProgError(nullptr) ;
+
+    signal(SIGINT, prevIntHdl) ;
+    return result ;
+  }
   
 }
 
@@ -39,6 +39,30 @@ namespace AVR
     ::Command *_lastCommand ;
   } ;
 
+  ////////////////////////////////////////////////////////////////////////////////
+  // Batch
+  // non-interactive run (-run), result is the process exit code
+  ////////////////////////////////////////////////////////////////////////////////
+
+  class Batch
+  {
+  public:
+    enum Result
+    {
+      Stopped     = 0, // stop address reached, or cycle limit without stop address
+      CycleLimit  = 2, // cycle limit reached before stop address
+      Interrupted = 3, // SIGINT
+      ProgError   = 4, // illegal instruction or program memory access, reported on stderr
+    } ;
+
+    Batch(Mcu &mcu) : _mcu(mcu) {}
+
+    Result Run(uint64_t maxCycles, uint32_t stopAddr = 0xffffffff) ;
+
+  private:
+    Mcu &_mcu ;
+  } ;
+
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -474,11 +474,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrADD::Execute(Mcu &mcu, Command cmd) const
+  void InstrADD::Decode(Command cmd, Operands &op) const
   {
-    Command nr, nd ;
-    xxxxxxRxxxxxRRRR(cmd, nr) ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    xxxxxxRxxxxxRRRR(cmd, op._r) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrADD::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nr = op._r, nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11000000 ;
     uint8_t rr = mcu.Reg(nr) ;
@@ -522,11 +525,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrADC::Execute(Mcu &mcu, Command cmd) const
+  void InstrADC::Decode(Command cmd, Operands &op) const
   {
-    Command nr, nd ;
-    xxxxxxRxxxxxRRRR(cmd, nr) ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    xxxxxxRxxxxxRRRR(cmd, op._r) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrADC::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nr = op._r, nd = op._d ;
 
     uint8_t sreg0 = mcu.GetSREG() ;
     uint8_t sreg = sreg0 & 0b11000000 ;
@@ -571,11 +577,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrADIW::Execute(Mcu &mcu, Command cmd) const
+  void InstrADIW::Decode(Command cmd, Operands &op) const
   {
-    Command k, nd ;
-    xxxxxxxxKKxxKKKK(cmd, k) ;
-    xxxxxxxxxxRRxxxx(cmd, nd) ;
+    xxxxxxxxKKxxKKKK(cmd, op._k) ;
+    xxxxxxxxxxRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrADIW::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command k = op._k, nd = op._d ;
 
     uint8_t  sreg = mcu.GetSREG() & 0b11100000 ;
     uint16_t rd   = mcu.RegW(nd) ;
@@ -614,11 +623,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSUB::Execute(Mcu &mcu, Command cmd) const
+  void InstrSUB::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxRxxxxxRRRR(cmd, op._r) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrSUB::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nr, nd ;
-    xxxxxxRxxxxxRRRR(cmd, nr) ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nr = op._r, nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11000000 ;
     uint8_t rr = mcu.Reg(nr) ;
@@ -662,11 +674,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSUBI::Execute(Mcu &mcu, Command cmd) const
+  void InstrSUBI::Decode(Command cmd, Operands &op) const
   {
-    Command k, nd ;
-    xxxxKKKKxxxxKKKK(cmd, k) ;
-    xxxxxxxxRRRRxxxx1(cmd, nd) ;
+    xxxxKKKKxxxxKKKK(cmd, op._k) ;
+    xxxxxxxxRRRRxxxx1(cmd, op._d) ;
+  }
+  uint8_t InstrSUBI::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command k = op._k, nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11000000 ;
     uint8_t rd = mcu.Reg(nd) ;
@@ -709,11 +724,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSBC::Execute(Mcu &mcu, Command cmd) const
+  void InstrSBC::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxRxxxxxRRRR(cmd, op._r) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrSBC::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nr, nd ;
-    xxxxxxRxxxxxRRRR(cmd, nr) ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nr = op._r, nd = op._d ;
 
     uint8_t sreg0 = mcu.GetSREG() ;
     uint8_t sreg = sreg0 & 0b11000000 ;
@@ -758,11 +776,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSBCI::Execute(Mcu &mcu, Command cmd) const
+  void InstrSBCI::Decode(Command cmd, Operands &op) const
   {
-    Command k, nd ;
-    xxxxKKKKxxxxKKKK(cmd, k) ;
-    xxxxxxxxRRRRxxxx1(cmd, nd) ;
+    xxxxKKKKxxxxKKKK(cmd, op._k) ;
+    xxxxxxxxRRRRxxxx1(cmd, op._d) ;
+  }
+  uint8_t InstrSBCI::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command k = op._k, nd = op._d ;
 
     uint8_t sreg0 = mcu.GetSREG() ;
     uint8_t sreg = sreg0 & 0b11000000 ;
@@ -806,11 +827,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSBIW::Execute(Mcu &mcu, Command cmd) const
+  void InstrSBIW::Decode(Command cmd, Operands &op) const
   {
-    Command k, nd ;
-    xxxxxxxxKKxxKKKK(cmd, k) ;
-    xxxxxxxxxxRRxxxx(cmd, nd) ;
+    xxxxxxxxKKxxKKKK(cmd, op._k) ;
+    xxxxxxxxxxRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrSBIW::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command k = op._k, nd = op._d ;
 
     uint8_t  sreg = mcu.GetSREG() & 0b11100000 ;
     uint16_t rd   = mcu.RegW(nd) ;
@@ -849,11 +873,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrAND::Execute(Mcu &mcu, Command cmd) const
+  void InstrAND::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxRxxxxxRRRR(cmd, op._r) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrAND::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nr, nd ;
-    xxxxxxRxxxxxRRRR(cmd, nr) ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nr = op._r, nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11100001 ;
     uint8_t rr = mcu.Reg(nr) ;
@@ -889,11 +916,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrANDI::Execute(Mcu &mcu, Command cmd) const
+  void InstrANDI::Decode(Command cmd, Operands &op) const
   {
-    Command k, nd ;
-    xxxxKKKKxxxxKKKK(cmd, k) ;
-    xxxxxxxxRRRRxxxx1(cmd, nd) ;
+    xxxxKKKKxxxxKKKK(cmd, op._k) ;
+    xxxxxxxxRRRRxxxx1(cmd, op._d) ;
+  }
+  uint8_t InstrANDI::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command k = op._k, nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11100001 ;
     uint8_t rd = mcu.Reg(nd) ;
@@ -928,11 +958,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrOR::Execute(Mcu &mcu, Command cmd) const
+  void InstrOR::Decode(Command cmd, Operands &op) const
   {
-    Command nr, nd ;
-    xxxxxxRxxxxxRRRR(cmd, nr) ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    xxxxxxRxxxxxRRRR(cmd, op._r) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrOR::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nr = op._r, nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11100001 ;
     uint8_t rr = mcu.Reg(nr) ;
@@ -968,11 +1001,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrORI::Execute(Mcu &mcu, Command cmd) const
+  void InstrORI::Decode(Command cmd, Operands &op) const
   {
-    Command k, nd ;
-    xxxxKKKKxxxxKKKK(cmd, k) ;
-    xxxxxxxxRRRRxxxx1(cmd, nd) ;
+    xxxxKKKKxxxxKKKK(cmd, op._k) ;
+    xxxxxxxxRRRRxxxx1(cmd, op._d) ;
+  }
+  uint8_t InstrORI::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command k = op._k, nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11100001 ;
     uint8_t rd = mcu.Reg(nd) ;
@@ -1007,11 +1043,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrEOR::Execute(Mcu &mcu, Command cmd) const
+  void InstrEOR::Decode(Command cmd, Operands &op) const
   {
-    Command nr, nd ;
-    xxxxxxRxxxxxRRRR(cmd, nr) ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    xxxxxxRxxxxxRRRR(cmd, op._r) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrEOR::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nr = op._r, nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11100001 ;
     uint8_t rr = mcu.Reg(nr) ;
@@ -1047,10 +1086,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrCOM::Execute(Mcu &mcu, Command cmd) const
+  void InstrCOM::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrCOM::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11100000 ;
     uint8_t rd = mcu.Reg(nd) ;
@@ -1086,10 +1128,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrNEG::Execute(Mcu &mcu, Command cmd) const
+  void InstrNEG::Decode(Command cmd, Operands &op) const
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrNEG::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11000000 ;
     uint8_t rd = mcu.Reg(nd) ;
@@ -1131,10 +1176,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrINC::Execute(Mcu &mcu, Command cmd) const
+  void InstrINC::Decode(Command cmd, Operands &op) const
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrINC::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11100001 ;
     uint8_t rd = mcu.Reg(nd) ;
@@ -1171,10 +1219,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrDEC::Execute(Mcu &mcu, Command cmd) const
+  void InstrDEC::Decode(Command cmd, Operands &op) const
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrDEC::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11100001 ;
     uint8_t rd = mcu.Reg(nd) ;
@@ -1211,11 +1262,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrMUL::Execute(Mcu &mcu, Command cmd) const
+  void InstrMUL::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxRxxxxxRRRR(cmd, op._r) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrMUL::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nr, nd ;
-    xxxxxxRxxxxxRRRR(cmd, nr) ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nr = op._r, nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11111100 ;
     uint16_t rr = mcu.Reg(nr) ;
@@ -1249,11 +1303,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrMULS::Execute(Mcu &mcu, Command cmd) const
+  void InstrMULS::Decode(Command cmd, Operands &op) const
   {
-    Command nr, nd ;
-    xxxxxxxxRRRRxxxx1(cmd, nd) ;
-    xxxxxxxxxxxxRRRR1(cmd, nr) ;
+    xxxxxxxxRRRRxxxx1(cmd, op._d) ;
+    xxxxxxxxxxxxRRRR1(cmd, op._r) ;
+  }
+  uint8_t InstrMULS::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nr = op._r, nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11111100 ;
     int16_t rr = (int8_t)mcu.Reg(nr) ;
@@ -1287,10 +1344,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrMULSU::Execute(Mcu &mcu, Command cmd) const
+  void InstrMULSU::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrMULSU::Exec(Mcu &mcu, const Operands &op)
   {
     // todo exec InstrMULSU
-    mcu.NotImplemented(*this) ;
+    mcu.NotImplemented(instrMULSU) ;
 
     return 2 ;
   }
@@ -1313,10 +1373,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrFMUL::Execute(Mcu &mcu, Command cmd) const
+  void InstrFMUL::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrFMUL::Exec(Mcu &mcu, const Operands &op)
   {
     // todo exec InstrFMUL
-    mcu.NotImplemented(*this) ;
+    mcu.NotImplemented(instrFMUL) ;
 
     return 2 ;
   }
@@ -1339,10 +1402,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrFMULS::Execute(Mcu &mcu, Command cmd) const
+  void InstrFMULS::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrFMULS::Exec(Mcu &mcu, const Operands &op)
   {
     // todo exec InstrFMULS
-    mcu.NotImplemented(*this) ;
+    mcu.NotImplemented(instrFMULS) ;
 
     return 2 ;
   }
@@ -1365,10 +1431,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrFMULSU::Execute(Mcu &mcu, Command cmd) const
+  void InstrFMULSU::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrFMULSU::Exec(Mcu &mcu, const Operands &op)
   {
     // todo exec InstrFMULSU
-    mcu.NotImplemented(*this) ;
+    mcu.NotImplemented(instrFMULSU) ;
 
     return 2 ;
   }
@@ -1391,10 +1460,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrDES::Execute(Mcu &mcu, Command cmd) const
+  void InstrDES::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrDES::Exec(Mcu &mcu, const Operands &op)
   {
     // todo exec InstrDES
-    mcu.NotImplemented(*this) ;
+    mcu.NotImplemented(instrDES) ;
 
     return 2 ; // todo ticks
   }
@@ -1417,10 +1489,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrRJMP::Execute(Mcu &mcu, Command cmd) const
+  void InstrRJMP::Decode(Command cmd, Operands &op) const
   {
-    Command k ;
-    xxxxKKKKKKKKKKKK(cmd, k) ;
+    xxxxKKKKKKKKKKKK(cmd, op._k) ;
+  }
+  uint8_t InstrRJMP::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command k = op._k ;
     mcu.PC() = mcu.PC() + (int16_t)k ;
 
     return 2 ;
@@ -1445,7 +1520,10 @@ namespace AVR
   {
   }
 
-  uint8_t InstrIJMP::Execute(Mcu &mcu, Command cmd) const
+  void InstrIJMP::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrIJMP::Exec(Mcu &mcu, const Operands &op)
   {
     mcu.XrefAdd(XrefType::jmp, mcu.RegW(30), mcu.PC()-1) ;
     mcu.PC() = mcu.RegW(30) ;
@@ -1471,7 +1549,10 @@ namespace AVR
   {
   }
 
-  uint8_t InstrEIJMP::Execute(Mcu &mcu, Command cmd) const
+  void InstrEIJMP::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrEIJMP::Exec(Mcu &mcu, const Operands &op)
   {
     mcu.XrefAdd(XrefType::jmp, mcu.GetEind() | mcu.RegW(30), mcu.PC()-1) ;
     mcu.PC() = mcu.GetEind() | mcu.RegW(30) ;
@@ -1497,10 +1578,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrJMP::Execute(Mcu &mcu, Command cmd) const
+  void InstrJMP::Decode(Command cmd, Operands &op) const
   {
-    Command k ;
-    xxxxxxxKKKKKxxxK(cmd, k) ;
+    xxxxxxxKKKKKxxxK(cmd, op._k) ;
+  }
+  uint8_t InstrJMP::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command k = op._k ;
     uint32_t addr = (((uint32_t)k) << 16) + mcu.ProgramNext() ;
     mcu.PC() = addr ;
 
@@ -1526,10 +1610,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrRCALL::Execute(Mcu &mcu, Command cmd) const
+  void InstrRCALL::Decode(Command cmd, Operands &op) const
   {
-    Command k ;
-    xxxxKKKKKKKKKKKK(cmd, k) ;
+    xxxxKKKKKKKKKKKK(cmd, op._k) ;
+  }
+  uint8_t InstrRCALL::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command k = op._k ;
     mcu.PushPC() ;
     mcu.PC() = mcu.PC() + (int16_t)k ;
 
@@ -1559,7 +1646,10 @@ namespace AVR
   {
   }
 
-  uint8_t InstrICALL::Execute(Mcu &mcu, Command cmd) const
+  void InstrICALL::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrICALL::Exec(Mcu &mcu, const Operands &op)
   {
     mcu.XrefAdd(XrefType::call, mcu.RegW(30), mcu.PC()-1) ;
     mcu.PushPC() ;
@@ -1588,7 +1678,10 @@ namespace AVR
   {
   }
 
-  uint8_t InstrEICALL::Execute(Mcu &mcu, Command cmd) const
+  void InstrEICALL::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrEICALL::Exec(Mcu &mcu, const Operands &op)
   {
     mcu.XrefAdd(XrefType::call, mcu.GetEind() | mcu.RegW(30), mcu.PC()-1) ;
     mcu.PushPC() ;
@@ -1617,10 +1710,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrCALL::Execute(Mcu &mcu, Command cmd) const
+  void InstrCALL::Decode(Command cmd, Operands &op) const
   {
-    Command k ;
-    xxxxxxxKKKKKxxxK(cmd, k) ;
+    xxxxxxxKKKKKxxxK(cmd, op._k) ;
+  }
+  uint8_t InstrCALL::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command k = op._k ;
     uint32_t addr = (((uint32_t)k) << 16) + mcu.ProgramNext() ;
     mcu.PushPC() ;
     mcu.PC() = addr ;
@@ -1649,7 +1745,10 @@ namespace AVR
   {
   }
 
-  uint8_t InstrRET::Execute(Mcu &mcu, Command cmd) const
+  void InstrRET::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrRET::Exec(Mcu &mcu, const Operands &op)
   {
     mcu.PopPC() ;
 
@@ -1674,12 +1773,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrRETI::Execute(Mcu &mcu, Command cmd) const
+  void InstrRETI::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrRETI::Exec(Mcu &mcu, const Operands &op)
   {
     mcu.PopPC() ;
-    uint8_t sreg = mcu.GetSREG() ;
-    sreg |= SREG::I ;
-    mcu.SetSREG(sreg) ;
+    mcu.Reti() ;
 
     return mcu.PcIs22bit() ? 5 : 4 ;
   }
@@ -1702,11 +1802,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrCPSE::Execute(Mcu &mcu, Command cmd) const
+  void InstrCPSE::Decode(Command cmd, Operands &op) const
   {
-    Command nr, nd ;
-    xxxxxxRxxxxxRRRR(cmd, nr) ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    xxxxxxRxxxxxRRRR(cmd, op._r) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrCPSE::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nr = op._r, nd = op._d ;
 
     uint8_t rr = mcu.Reg(nr) ;
     uint8_t rd = mcu.Reg(nd) ;
@@ -1734,11 +1837,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrCP::Execute(Mcu &mcu, Command cmd) const
+  void InstrCP::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxRxxxxxRRRR(cmd, op._r) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrCP::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nr, nd ;
-    xxxxxxRxxxxxRRRR(cmd, nr) ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nr = op._r, nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11000000 ;
     uint8_t rr = mcu.Reg(nr) ;
@@ -1781,11 +1887,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrCPC::Execute(Mcu &mcu, Command cmd) const
+  void InstrCPC::Decode(Command cmd, Operands &op) const
   {
-    Command nr, nd ;
-    xxxxxxRxxxxxRRRR(cmd, nr) ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    xxxxxxRxxxxxRRRR(cmd, op._r) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrCPC::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nr = op._r, nd = op._d ;
 
     uint8_t sreg0 = mcu.GetSREG() ;
     uint8_t sreg = sreg0 & 0b11000000 ;
@@ -1829,11 +1938,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrCPI::Execute(Mcu &mcu, Command cmd) const
+  void InstrCPI::Decode(Command cmd, Operands &op) const
   {
-    Command k, nd ;
-    xxxxKKKKxxxxKKKK(cmd, k) ;
-    xxxxxxxxRRRRxxxx1(cmd, nd) ;
+    xxxxKKKKxxxxKKKK(cmd, op._k) ;
+    xxxxxxxxRRRRxxxx1(cmd, op._d) ;
+  }
+  uint8_t InstrCPI::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command k = op._k, nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11000000 ;
     uint8_t rd = mcu.Reg(nd) ;
@@ -1875,11 +1987,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSBRC::Execute(Mcu &mcu, Command cmd) const
+  void InstrSBRC::Decode(Command cmd, Operands &op) const
   {
-    Command nr, b ;
-    xxxxxxxRRRRRxxxx(cmd, nr) ;
-    xxxxxxxxxxxxxBBB(cmd, b) ;
+    xxxxxxxRRRRRxxxx(cmd, op._r) ;
+    xxxxxxxxxxxxxBBB(cmd, op._b) ;
+  }
+  uint8_t InstrSBRC::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nr = op._r, b = op._b ;
 
     uint8_t r = mcu.Reg(nr) ;
     if (!(r & (1<<b)))
@@ -1905,11 +2020,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSBRS::Execute(Mcu &mcu, Command cmd) const
+  void InstrSBRS::Decode(Command cmd, Operands &op) const
   {
-    Command nr, b ;
-    xxxxxxxRRRRRxxxx(cmd, nr) ;
-    xxxxxxxxxxxxxBBB(cmd, b) ;
+    xxxxxxxRRRRRxxxx(cmd, op._r) ;
+    xxxxxxxxxxxxxBBB(cmd, op._b) ;
+  }
+  uint8_t InstrSBRS::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nr = op._r, b = op._b ;
 
     uint8_t r = mcu.Reg(nr) ;
     if (r & (1<<b))
@@ -1935,11 +2053,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSBIC::Execute(Mcu &mcu, Command cmd) const
+  void InstrSBIC::Decode(Command cmd, Operands &op) const
   {
-    Command ni, b ;
-    xxxxxxxxAAAAAxxx(cmd, ni) ;
-    xxxxxxxxxxxxxBBB(cmd, b) ;
+    xxxxxxxxAAAAAxxx(cmd, op._k) ;
+    xxxxxxxxxxxxxBBB(cmd, op._b) ;
+  }
+  uint8_t InstrSBIC::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command ni = op._k, b = op._b ;
 
     uint8_t i = mcu.Io(ni) ;
     if (!(i & (1<<b)))
@@ -1965,11 +2086,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSBIS::Execute(Mcu &mcu, Command cmd) const
+  void InstrSBIS::Decode(Command cmd, Operands &op) const
   {
-    Command ni, b ;
-    xxxxxxxxAAAAAxxx(cmd, ni) ;
-    xxxxxxxxxxxxxBBB(cmd, b) ;
+    xxxxxxxxAAAAAxxx(cmd, op._k) ;
+    xxxxxxxxxxxxxBBB(cmd, op._b) ;
+  }
+  uint8_t InstrSBIS::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command ni = op._k, b = op._b ;
 
     uint8_t i = mcu.Io(ni) ;
     if (i & (1<<b))
@@ -1995,11 +2119,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrBRBS::Execute(Mcu &mcu, Command cmd) const
+  void InstrBRBS::Decode(Command cmd, Operands &op) const
   {
-    Command k, s ;
-    xxxxxxKKKKKKKxxx(cmd, k) ;
-    xxxxxxxxxxxxxSSS(cmd, s) ;
+    xxxxxxKKKKKKKxxx(cmd, op._k) ;
+    xxxxxxxxxxxxxSSS(cmd, op._b) ;
+  }
+  uint8_t InstrBRBS::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command k = op._k, s = op._b ;
 
     if (mcu.GetSREG() & (1<<s))
     {
@@ -2028,11 +2155,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrBRBC::Execute(Mcu &mcu, Command cmd) const
+  void InstrBRBC::Decode(Command cmd, Operands &op) const
   {
-    Command k, s ;
-    xxxxxxKKKKKKKxxx(cmd, k) ;
-    xxxxxxxxxxxxxSSS(cmd, s) ;
+    xxxxxxKKKKKKKxxx(cmd, op._k) ;
+    xxxxxxxxxxxxxSSS(cmd, op._b) ;
+  }
+  uint8_t InstrBRBC::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command k = op._k, s = op._b ;
 
     if (!(mcu.GetSREG() & (1<<s)))
     {
@@ -2061,11 +2191,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrMOV::Execute(Mcu &mcu, Command cmd) const
+  void InstrMOV::Decode(Command cmd, Operands &op) const
   {
-    Command r, d ;
-    xxxxxxRxxxxxRRRR(cmd, r) ;
-    xxxxxxxRRRRRxxxx(cmd, d) ;
+    xxxxxxRxxxxxRRRR(cmd, op._r) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrMOV::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command r = op._r, d = op._d ;
     mcu.Reg(d, mcu.Reg(r)) ;
 
     return 1 ;
@@ -2089,11 +2222,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrMOVW::Execute(Mcu &mcu, Command cmd) const
+  void InstrMOVW::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxxRRRRxxxx2(cmd, op._d) ;
+    xxxxxxxxxxxxRRRR2(cmd, op._r) ;
+  }
+  uint8_t InstrMOVW::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nr, nd ;
-    xxxxxxxxRRRRxxxx2(cmd, nd) ;
-    xxxxxxxxxxxxRRRR2(cmd, nr) ;
+    Command nr = op._r, nd = op._d ;
     mcu.RegW(nd, mcu.RegW(nr)) ;
 
     return 1 ;
@@ -2117,11 +2253,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLDI::Execute(Mcu &mcu, Command cmd) const
+  void InstrLDI::Decode(Command cmd, Operands &op) const
   {
-    Command k, d ;
-    xxxxKKKKxxxxKKKK(cmd, k) ;
-    xxxxxxxxRRRRxxxx1(cmd, d) ;
+    xxxxKKKKxxxxKKKK(cmd, op._k) ;
+    xxxxxxxxRRRRxxxx1(cmd, op._d) ;
+  }
+  uint8_t InstrLDI::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command k = op._k, d = op._d ;
     mcu.Reg(d, (uint8_t)k) ;
 
     return 1 ;
@@ -2145,10 +2284,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLDS::Execute(Mcu &mcu, Command cmd) const
+  void InstrLDS::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrLDS::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
     uint32_t addr = mcu.GetRampD() | mcu.ProgramNext() ;
     mcu.Reg(nd, mcu.Data(addr)) ;
 
@@ -2173,10 +2315,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLDx1::Execute(Mcu &mcu, Command cmd) const
+  void InstrLDx1::Decode(Command cmd, Operands &op) const
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrLDx1::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nd = op._d ;
     uint32_t x = mcu.GetRampX() | mcu.RegW(26) ;
     mcu.Reg(nd, mcu.Data(x)) ;
 
@@ -2201,10 +2346,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLDx2::Execute(Mcu &mcu, Command cmd) const
+  void InstrLDx2::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrLDx2::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
     uint32_t x = mcu.GetRampX() | mcu.RegW(26) ;
     mcu.Reg(nd, mcu.Data(x++)) ;
     mcu.SetRampX(x) ;
@@ -2231,10 +2379,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLDx3::Execute(Mcu &mcu, Command cmd) const
+  void InstrLDx3::Decode(Command cmd, Operands &op) const
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrLDx3::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nd = op._d ;
     uint32_t x = mcu.GetRampX() | mcu.RegW(26) ;
     mcu.Reg(nd, mcu.Data(--x)) ;
     mcu.SetRampX(x) ;
@@ -2261,10 +2412,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLDy1::Execute(Mcu &mcu, Command cmd) const
+  void InstrLDy1::Decode(Command cmd, Operands &op) const
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrLDy1::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nd = op._d ;
     uint32_t y = mcu.GetRampY() | mcu.RegW(28) ;
     mcu.Reg(nd, mcu.Data(y)) ;
 
@@ -2289,10 +2443,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLDy2::Execute(Mcu &mcu, Command cmd) const
+  void InstrLDy2::Decode(Command cmd, Operands &op) const
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrLDy2::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nd = op._d ;
     uint32_t y = mcu.GetRampY() | mcu.RegW(28) ;
     mcu.Reg(nd, mcu.Data(y++)) ;
     mcu.SetRampY(y) ;
@@ -2319,10 +2476,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLDy3::Execute(Mcu &mcu, Command cmd) const
+  void InstrLDy3::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrLDy3::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
     uint32_t y = mcu.GetRampY() | mcu.RegW(28) ;
     mcu.Reg(nd, mcu.Data(--y)) ;
     mcu.SetRampY(y) ;
@@ -2349,11 +2509,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLDy4::Execute(Mcu &mcu, Command cmd) const
+  void InstrLDy4::Decode(Command cmd, Operands &op) const
   {
-    Command nd, q ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
-    xxQxQQxxxxxxxQQQ(cmd, q) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+    xxQxQQxxxxxxxQQQ(cmd, op._k) ;
+  }
+  uint8_t InstrLDy4::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nd = op._d, q = op._k ;
     uint32_t y = mcu.GetRampY() | mcu.RegW(28) ;
     mcu.Reg(nd, mcu.Data(y+q)) ;
 
@@ -2378,10 +2541,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLDz1::Execute(Mcu &mcu, Command cmd) const
+  void InstrLDz1::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrLDz1::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
     uint32_t z = mcu.GetRampZ() | mcu.RegW(30) ;
     mcu.Reg(nd, mcu.Data(z)) ;
 
@@ -2406,10 +2572,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLDz2::Execute(Mcu &mcu, Command cmd) const
+  void InstrLDz2::Decode(Command cmd, Operands &op) const
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrLDz2::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nd = op._d ;
     uint32_t z = mcu.GetRampZ() | mcu.RegW(30) ;
     mcu.Reg(nd, mcu.Data(z++)) ;
     mcu.SetRampZ(z) ;
@@ -2436,10 +2605,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLDz3::Execute(Mcu &mcu, Command cmd) const
+  void InstrLDz3::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrLDz3::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
     uint32_t z = mcu.GetRampZ() | mcu.RegW(30) ;
     mcu.Reg(nd, mcu.Data(--z)) ;
     mcu.SetRampZ(z) ;
@@ -2466,11 +2638,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLDz4::Execute(Mcu &mcu, Command cmd) const
+  void InstrLDz4::Decode(Command cmd, Operands &op) const
   {
-    Command nd, q ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
-    xxQxQQxxxxxxxQQQ(cmd, q) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+    xxQxQQxxxxxxxQQQ(cmd, op._k) ;
+  }
+  uint8_t InstrLDz4::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nd = op._d, q = op._k ;
     uint32_t z = mcu.GetRampZ() | mcu.RegW(30) ;
     mcu.Reg(nd, mcu.Data(z+q)) ;
 
@@ -2495,10 +2670,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSTS::Execute(Mcu &mcu, Command cmd) const
+  void InstrSTS::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrSTS::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
     uint32_t addr = mcu.GetRampD() | mcu.ProgramNext() ;
     mcu.Data(addr, mcu.Reg(nd)) ;
 
@@ -2523,10 +2701,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSTx1::Execute(Mcu &mcu, Command cmd) const
+  void InstrSTx1::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._r) ;
+  }
+  uint8_t InstrSTx1::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nr ;
-    xxxxxxxRRRRRxxxx(cmd, nr) ;
+    Command nr = op._r ;
     uint32_t x = mcu.GetRampX() | mcu.RegW(26) ;
     mcu.Data(x, mcu.Reg(nr)) ;
 
@@ -2551,10 +2732,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSTx2::Execute(Mcu &mcu, Command cmd) const
+  void InstrSTx2::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._r) ;
+  }
+  uint8_t InstrSTx2::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nr ;
-    xxxxxxxRRRRRxxxx(cmd, nr) ;
+    Command nr = op._r ;
     uint32_t x = mcu.GetRampX() | mcu.RegW(26) ;
     mcu.Data(x++, mcu.Reg(nr)) ;
     mcu.SetRampX(x) ;
@@ -2581,10 +2765,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSTx3::Execute(Mcu &mcu, Command cmd) const
+  void InstrSTx3::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._r) ;
+  }
+  uint8_t InstrSTx3::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nr ;
-    xxxxxxxRRRRRxxxx(cmd, nr) ;
+    Command nr = op._r ;
     uint32_t x = mcu.GetRampX() | mcu.RegW(26) ;
     mcu.Data(--x, mcu.Reg(nr)) ;
     mcu.SetRampX(x) ;
@@ -2611,10 +2798,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSTy1::Execute(Mcu &mcu, Command cmd) const
+  void InstrSTy1::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._r) ;
+  }
+  uint8_t InstrSTy1::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nr ;
-    xxxxxxxRRRRRxxxx(cmd, nr) ;
+    Command nr = op._r ;
     uint32_t y = mcu.GetRampY() | mcu.RegW(28) ;
     mcu.Data(y, mcu.Reg(nr)) ;
 
@@ -2639,10 +2829,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSTy2::Execute(Mcu &mcu, Command cmd) const
+  void InstrSTy2::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._r) ;
+  }
+  uint8_t InstrSTy2::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nr ;
-    xxxxxxxRRRRRxxxx(cmd, nr) ;
+    Command nr = op._r ;
     uint32_t y = mcu.GetRampY() | mcu.RegW(28) ;
     mcu.Data(y++, mcu.Reg(nr)) ;
     mcu.SetRampY(y) ;
@@ -2669,10 +2862,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSTy3::Execute(Mcu &mcu, Command cmd) const
+  void InstrSTy3::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._r) ;
+  }
+  uint8_t InstrSTy3::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nr ;
-    xxxxxxxRRRRRxxxx(cmd, nr) ;
+    Command nr = op._r ;
     uint32_t y = mcu.GetRampY() | mcu.RegW(28) ;
     mcu.Data(--y, mcu.Reg(nr)) ;
     mcu.SetRampY(y) ;
@@ -2699,11 +2895,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSTy4::Execute(Mcu &mcu, Command cmd) const
+  void InstrSTy4::Decode(Command cmd, Operands &op) const
   {
-    Command nr, q ;
-    xxxxxxxRRRRRxxxx(cmd, nr) ;
-    xxQxQQxxxxxxxQQQ(cmd, q) ;
+    xxxxxxxRRRRRxxxx(cmd, op._r) ;
+    xxQxQQxxxxxxxQQQ(cmd, op._k) ;
+  }
+  uint8_t InstrSTy4::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nr = op._r, q = op._k ;
     uint32_t y = mcu.GetRampY() | mcu.RegW(28) ;
     mcu.Data(y+q, mcu.Reg(nr)) ;
 
@@ -2728,10 +2927,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSTz1::Execute(Mcu &mcu, Command cmd) const
+  void InstrSTz1::Decode(Command cmd, Operands &op) const
   {
-    Command nr ;
-    xxxxxxxRRRRRxxxx(cmd, nr) ;
+    xxxxxxxRRRRRxxxx(cmd, op._r) ;
+  }
+  uint8_t InstrSTz1::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nr = op._r ;
     uint32_t z = mcu.GetRampZ() | mcu.RegW(30) ;
     mcu.Data(z, mcu.Reg(nr)) ;
 
@@ -2756,10 +2958,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSTz2::Execute(Mcu &mcu, Command cmd) const
+  void InstrSTz2::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._r) ;
+  }
+  uint8_t InstrSTz2::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nr ;
-    xxxxxxxRRRRRxxxx(cmd, nr) ;
+    Command nr = op._r ;
     uint32_t z = mcu.GetRampZ() | mcu.RegW(30) ;
     mcu.Data(z++, mcu.Reg(nr)) ;
     mcu.SetRampZ(z) ;
@@ -2786,10 +2991,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSTz3::Execute(Mcu &mcu, Command cmd) const
+  void InstrSTz3::Decode(Command cmd, Operands &op) const
   {
-    Command nr ;
-    xxxxxxxRRRRRxxxx(cmd, nr) ;
+    xxxxxxxRRRRRxxxx(cmd, op._r) ;
+  }
+  uint8_t InstrSTz3::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nr = op._r ;
     uint32_t z = mcu.GetRampZ() | mcu.RegW(30) ;
     mcu.Data(--z, mcu.Reg(nr)) ;
     mcu.SetRampZ(z) ;
@@ -2816,11 +3024,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSTz4::Execute(Mcu &mcu, Command cmd) const
+  void InstrSTz4::Decode(Command cmd, Operands &op) const
   {
-    Command nr, q ;
-    xxxxxxxRRRRRxxxx(cmd, nr) ;
-    xxQxQQxxxxxxxQQQ(cmd, q) ;
+    xxxxxxxRRRRRxxxx(cmd, op._r) ;
+    xxQxQQxxxxxxxQQQ(cmd, op._k) ;
+  }
+  uint8_t InstrSTz4::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nr = op._r, q = op._k ;
     uint32_t z = mcu.GetRampZ() | mcu.RegW(30) ;
     mcu.Data(z+q, mcu.Reg(nr)) ;
 
@@ -2845,7 +3056,10 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLPM1::Execute(Mcu &mcu, Command cmd) const
+  void InstrLPM1::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrLPM1::Exec(Mcu &mcu, const Operands &op)
   {
     mcu.XrefAdd(XrefType::data, mcu.RegW(30)>>1, mcu.PC()-1) ;
     Command z, p ;
@@ -2876,11 +3090,15 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLPM2::Execute(Mcu &mcu, Command cmd) const
+  void InstrLPM2::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrLPM2::Exec(Mcu &mcu, const Operands &op)
   {
     mcu.XrefAdd(XrefType::data, mcu.RegW(30)>>1, mcu.PC()-1) ;
-    Command z, nd, p ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
+    Command z, p ;
     z = mcu.RegW(30) ;
     p = mcu.Program(z>>1) ;
     if (z&1)
@@ -2908,11 +3126,15 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLPM3::Execute(Mcu &mcu, Command cmd) const
+  void InstrLPM3::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrLPM3::Exec(Mcu &mcu, const Operands &op)
   {
     mcu.XrefAdd(XrefType::data, mcu.RegW(30)>>1, mcu.PC()-1) ;
-    Command z, nd, p ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
+    Command z, p ;
     z = mcu.RegW(30) ;
     p = mcu.Program(z>>1) ;
     if (z&1)
@@ -2941,7 +3163,10 @@ namespace AVR
   {
   }
 
-  uint8_t InstrELPM1::Execute(Mcu &mcu, Command cmd) const
+  void InstrELPM1::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrELPM1::Exec(Mcu &mcu, const Operands &op)
   {
     uint32_t z = mcu.GetRampZ() | mcu.RegW(30) ;
     mcu.XrefAdd(XrefType::data, z>>1, mcu.PC()-1) ;
@@ -2972,12 +3197,16 @@ namespace AVR
   {
   }
 
-  uint8_t InstrELPM2::Execute(Mcu &mcu, Command cmd) const
+  void InstrELPM2::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrELPM2::Exec(Mcu &mcu, const Operands &op)
   {
     uint32_t z = mcu.GetRampZ() | mcu.RegW(30) ;
     mcu.XrefAdd(XrefType::data, z>>1, mcu.PC()-1) ;
-    Command nd, p ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
+    Command p ;
     p = mcu.Program(z>>1) ;
     if (z&1)
       p >>= 8 ;
@@ -3004,12 +3233,16 @@ namespace AVR
   {
   }
 
-  uint8_t InstrELPM3::Execute(Mcu &mcu, Command cmd) const
+  void InstrELPM3::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrELPM3::Exec(Mcu &mcu, const Operands &op)
   {
     uint32_t z = mcu.GetRampZ() | mcu.RegW(30) ;
     mcu.XrefAdd(XrefType::data, z>>1, mcu.PC()-1) ;
-    Command nd, p ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
+    Command p ;
     p = mcu.Program(z>>1) ;
     if (z&1)
       p >>= 8 ;
@@ -3038,9 +3271,12 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSPM1::Execute(Mcu &mcu, Command cmd) const
+  void InstrSPM1::Decode(Command cmd, Operands &op) const
   {
-    mcu.NotImplemented(*this) ;
+  }
+  uint8_t InstrSPM1::Exec(Mcu &mcu, const Operands &op)
+  {
+    mcu.NotImplemented(instrSPM1) ;
     return 99 ;
   }
   std::string InstrSPM1::Disasm(Mcu &mcu, Command cmd) const
@@ -3062,9 +3298,12 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSPM2::Execute(Mcu &mcu, Command cmd) const
+  void InstrSPM2::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrSPM2::Exec(Mcu &mcu, const Operands &op)
   {
-    mcu.NotImplemented(*this) ;
+    mcu.NotImplemented(instrSPM2) ;
     return 99 ;
   }
   std::string InstrSPM2::Disasm(Mcu &mcu, Command cmd) const
@@ -3086,11 +3325,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrIN::Execute(Mcu &mcu, Command cmd) const
+  void InstrIN::Decode(Command cmd, Operands &op) const
   {
-    Command nd, a ;
-    xxxxxAAxxxxxAAAA(cmd, a) ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    xxxxxAAxxxxxAAAA(cmd, op._k) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrIN::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nd = op._d, a = op._k ;
     mcu.Reg(nd, mcu.Io(a)) ;
 
     return 1 ;
@@ -3114,11 +3356,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrOUT::Execute(Mcu &mcu, Command cmd) const
+  void InstrOUT::Decode(Command cmd, Operands &op) const
   {
-    Command nr, a ;
-    xxxxxAAxxxxxAAAA(cmd, a) ;
-    xxxxxxxRRRRRxxxx(cmd, nr) ;
+    xxxxxAAxxxxxAAAA(cmd, op._k) ;
+    xxxxxxxRRRRRxxxx(cmd, op._r) ;
+  }
+  uint8_t InstrOUT::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nr = op._r, a = op._k ;
     mcu.Io(a, mcu.Reg(nr)) ;
 
     return 1 ;
@@ -3142,10 +3387,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrPUSH::Execute(Mcu &mcu, Command cmd) const
+  void InstrPUSH::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._r) ;
+  }
+  uint8_t InstrPUSH::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nr ;
-    xxxxxxxRRRRRxxxx(cmd, nr) ;
+    Command nr = op._r ;
     mcu.Push(mcu.Reg(nr)) ;
 
     return mcu.IsXmega() ? 1 : 2 ;
@@ -3169,10 +3417,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrPOP::Execute(Mcu &mcu, Command cmd) const
+  void InstrPOP::Decode(Command cmd, Operands &op) const
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrPOP::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nd = op._d ;
     mcu.Reg(nd, mcu.Pop()) ;
 
     return 2 ;
@@ -3196,10 +3447,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrXCH::Execute(Mcu &mcu, Command cmd) const
+  void InstrXCH::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrXCH::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
 
     uint8_t  rd = mcu.Reg(nd) ;
     uint32_t z = mcu.GetRampZ() | mcu.RegW(30) ;
@@ -3228,10 +3482,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLAS::Execute(Mcu &mcu, Command cmd) const
+  void InstrLAS::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrLAS::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
 
     uint8_t  rd = mcu.Reg(nd) ;
     uint32_t z = mcu.GetRampZ() | mcu.RegW(30) ;
@@ -3260,10 +3517,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLAC::Execute(Mcu &mcu, Command cmd) const
+  void InstrLAC::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrLAC::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
 
     uint8_t  rd = mcu.Reg(nd) ;
     uint32_t z = mcu.GetRampZ() | mcu.RegW(30) ;
@@ -3292,10 +3552,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLAT::Execute(Mcu &mcu, Command cmd) const
+  void InstrLAT::Decode(Command cmd, Operands &op) const
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrLAT::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nd = op._d ;
 
     uint8_t  rd = mcu.Reg(nd) ;
     uint32_t z = mcu.GetRampZ() | mcu.RegW(30) ;
@@ -3324,10 +3587,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrLSR::Execute(Mcu &mcu, Command cmd) const
+  void InstrLSR::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrLSR::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11100000 ;
     uint8_t rd = mcu.Reg(nd) ;
@@ -3364,10 +3630,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrROR::Execute(Mcu &mcu, Command cmd) const
+  void InstrROR::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrROR::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
 
     uint8_t sreg0 = mcu.GetSREG() ;
     uint8_t sreg = sreg0 & 0b11100000 ;
@@ -3409,10 +3678,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrASR::Execute(Mcu &mcu, Command cmd) const
+  void InstrASR::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrASR::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
 
     uint8_t sreg = mcu.GetSREG() & 0b11100000 ;
     uint8_t rd = mcu.Reg(nd) ;
@@ -3451,10 +3723,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSWAP::Execute(Mcu &mcu, Command cmd) const
+  void InstrSWAP::Decode(Command cmd, Operands &op) const
+  {
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+  }
+  uint8_t InstrSWAP::Exec(Mcu &mcu, const Operands &op)
   {
-    Command nd ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
+    Command nd = op._d ;
 
     uint8_t rd = mcu.Reg(nd) ;
     uint8_t r = ((rd & 0xf0) >> 4) | ((rd & 0x0f) << 4) ;
@@ -3481,10 +3756,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrBSET::Execute(Mcu &mcu, Command cmd) const
+  void InstrBSET::Decode(Command cmd, Operands &op) const
   {
-    Command s ;
-    xxxxxxxxxSSSxxxx(cmd, s) ;
+    xxxxxxxxxSSSxxxx(cmd, op._b) ;
+  }
+  uint8_t InstrBSET::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command s = op._b ;
 
     uint8_t sreg = mcu.GetSREG() ;
     sreg |= 1 << s ;
@@ -3511,10 +3789,13 @@ namespace AVR
   {
   }
 
-  uint8_t InstrBCLR::Execute(Mcu &mcu, Command cmd) const
+  void InstrBCLR::Decode(Command cmd, Operands &op) const
   {
-    Command s ;
-    xxxxxxxxxSSSxxxx(cmd, s) ;
+    xxxxxxxxxSSSxxxx(cmd, op._b) ;
+  }
+  uint8_t InstrBCLR::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command s = op._b ;
 
     uint8_t sreg = mcu.GetSREG() ;
     sreg &= ~(1 << s) ;
@@ -3541,11 +3822,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSBI::Execute(Mcu &mcu, Command cmd) const
+  void InstrSBI::Decode(Command cmd, Operands &op) const
   {
-    Command a, b ;
-    xxxxxxxxAAAAAxxx(cmd, a) ;
-    xxxxxxxxxxxxxBBB(cmd, b) ;
+    xxxxxxxxAAAAAxxx(cmd, op._k) ;
+    xxxxxxxxxxxxxBBB(cmd, op._b) ;
+  }
+  uint8_t InstrSBI::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command a = op._k, b = op._b ;
     mcu.Io(a, mcu.Io(a) | (1<<b)) ;
 
     return (mcu.IsXmega() || mcu.IsTinyReduced()) ? 1 : 2 ;
@@ -3569,11 +3853,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrCBI::Execute(Mcu &mcu, Command cmd) const
+  void InstrCBI::Decode(Command cmd, Operands &op) const
   {
-    Command a, b ;
-    xxxxxxxxAAAAAxxx(cmd, a) ;
-    xxxxxxxxxxxxxBBB(cmd, b) ;
+    xxxxxxxxAAAAAxxx(cmd, op._k) ;
+    xxxxxxxxxxxxxBBB(cmd, op._b) ;
+  }
+  uint8_t InstrCBI::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command a = op._k, b = op._b ;
     mcu.Io(a, mcu.Io(a) & ~(1<<b)) ;
 
     return (mcu.IsXmega() || mcu.IsTinyReduced()) ? 1 : 2 ;
@@ -3597,11 +3884,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrBST::Execute(Mcu &mcu, Command cmd) const
+  void InstrBST::Decode(Command cmd, Operands &op) const
   {
-    Command nr, b ;
-    xxxxxxxRRRRRxxxx(cmd, nr) ;
-    xxxxxxxxxxxxxBBB(cmd, b) ;
+    xxxxxxxRRRRRxxxx(cmd, op._r) ;
+    xxxxxxxxxxxxxBBB(cmd, op._b) ;
+  }
+  uint8_t InstrBST::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nr = op._r, b = op._b ;
 
     uint8_t sreg = mcu.GetSREG() & 0b10111111 ;
     if (mcu.Reg(nr) & (1<<b))
@@ -3629,11 +3919,14 @@ namespace AVR
   {
   }
 
-  uint8_t InstrBLD::Execute(Mcu &mcu, Command cmd) const
+  void InstrBLD::Decode(Command cmd, Operands &op) const
   {
-    Command nd, b ;
-    xxxxxxxRRRRRxxxx(cmd, nd) ;
-    xxxxxxxxxxxxxBBB(cmd, b) ;
+    xxxxxxxRRRRRxxxx(cmd, op._d) ;
+    xxxxxxxxxxxxxBBB(cmd, op._b) ;
+  }
+  uint8_t InstrBLD::Exec(Mcu &mcu, const Operands &op)
+  {
+    Command nd = op._d, b = op._b ;
 
     uint8_t d = mcu.Reg(nd) & ~(1<<b) ;
     if (mcu.GetSREG() && SREG::T)
@@ -3661,7 +3954,10 @@ namespace AVR
   {
   }
 
-  uint8_t InstrBREAK::Execute(Mcu &mcu, Command cmd) const
+  void InstrBREAK::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrBREAK::Exec(Mcu &mcu, const Operands &op)
   {
     mcu.Break() ;
 
@@ -3686,7 +3982,10 @@ namespace AVR
   {
   }
 
-  uint8_t InstrNOP::Execute(Mcu &mcu, Command cmd) const
+  void InstrNOP::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrNOP::Exec(Mcu &mcu, const Operands &op)
   {
     return 1 ;
   }
@@ -3709,7 +4008,10 @@ namespace AVR
   {
   }
 
-  uint8_t InstrSLEEP::Execute(Mcu &mcu, Command cmd) const
+  void InstrSLEEP::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrSLEEP::Exec(Mcu &mcu, const Operands &op)
   {
     mcu.Sleep() ;
 
@@ -3734,7 +4036,10 @@ namespace AVR
   {
   }
 
-  uint8_t InstrWDR::Execute(Mcu &mcu, Command cmd) const
+  void InstrWDR::Decode(Command cmd, Operands &op) const
+  {
+  }
+  uint8_t InstrWDR::Exec(Mcu &mcu, const Operands &op)
   {
     mcu.WDR() ;
 
@@ -3753,7 +4058,14 @@ namespace AVR
   // Instruction Instances
   ////////////////////////////////////////////////////////////////////////////////
 
-#define INSTRinst(name) Instr##name instr##name
+#define INSTRinst(name)                                                  \
+  uint8_t Instr##name::Execute(Mcu &mcu, Command cmd) const              \
+  {                                                                      \
+    Operands op ;                                                        \
+    Instr##name::Decode(cmd, op) ;                                       \
+    return Exec(mcu, op) ;                                               \
+  }                                                                      \
+  Instr##name instr##name
 
   ////////////////////////////////////////////////////////////////////////////////
   // Arithmetic and Logic Instructions
@@ -3885,6 +4197,102 @@ namespace AVR
   INSTRinst(NOP) ;
   INSTRinst(SLEEP) ;
   INSTRinst(WDR) ;
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Threaded Dispatch
+  ////////////////////////////////////////////////////////////////////////////////
+
+  // fast engine: every handler has the instruction inlined and ends with its own
+  // dispatch of the next one (computed goto with GCC / clang, switch otherwise).
+  // Handlers only run while no interrupt is ready, so no interrupt can follow them.
+  // Events, jumps, breakpoints, errors, profile and coverage leave the handler
+  // chain for resume / single.
+
+#if defined(__GNUC__)
+#define INSTR_DISPATCH goto *handler[dec->_id]
+#else
+#define INSTR_DISPATCH continue
+#endif
+
+#define INSTR_HANDLER(name)                                                   \
+      case (uint8_t)InstrId::name:                                            \
+      L##name:                                                                \
+      {                                                                       \
+        Operands op = dec->_operands ; /* SPM may move _decoded */            \
+        pc0    = _pc ;                                                        \
+        pcNext = pc0 + dec->_size ;                                           \
+        sp0    = _sp() ;                                                      \
+        instr  = dec->_instr ;                                                \
+        _pc    = pc0 + 1 ;                                                    \
+        _ticks += Instr##name::Exec(*this, op) ;                              \
+        ++n ;                                                                 \
+      }                                                                       \
+      if (_pc != pcNext) /* call / jump / return / skip */                    \
+        goto flow ;                                                           \
+      if ((_ticks >= _nextEvent) || (_ticks >= _tickLimit) || (n >= count) || \
+          _irqReady || stop || (_pc == stopAddr) || (_pc >= _loadedFlashSize)) \
+        goto resume ;                                                         \
+      dec = &_decoded[_pc] ;                                                  \
+      if (dec->_break || !dec->_fct)                                          \
+        goto resume ;                                                         \
+      INSTR_DISPATCH ;
+
+  __attribute__((flatten)) // handlers inline their instruction
+  uint64_t Mcu::RunThreaded(uint64_t count, const volatile bool &stop, uint32_t stopAddr)
+  {
+#if defined(__GNUC__)
+#define INSTR_LABEL(name) &&L##name,
+    static void *const handler[] = { INSTR_ALL(INSTR_LABEL) } ;
+#undef INSTR_LABEL
+#endif
+
+    uint64_t n = 0 ;
+    uint32_t pc0, pcNext ;
+    uint16_t sp0 ;
+    const Instruction *instr ;
+    const Decoded *dec ;
+
+    if (!count || stop || (_ticks >= _tickLimit))
+      return 0 ;
+
+  single: // pending interrupt, error reporting, profile, coverage, first step from a breakpoint
+    pc0 = _pc ;
+    Execute() ;
+    ++n ;
+    if ((_pc < pc0) && (n < count)) // backward jump
+      n += IdleLoop(pc0, count - n, stopAddr) ;
+    goto resume ;
+
+  flow:
+    ExecuteDone(pc0, sp0, *instr) ;
+    if (_ticks >= _nextEvent)
+      Events() ;
+    if ((_pc < pc0) && (n < count)) // backward jump
+      n += IdleLoop(pc0, count - n, stopAddr) ;
+
+  resume:
+    if (_ticks >= _nextEvent)
+      Events() ;
+    if ((n >= count) || stop || (_ticks >= _tickLimit) || (_pc == stopAddr) || ((_pc < _flashSize) && _decoded[_pc]._break))
+      return n ;
+    if (_irqReady || (_pc >= _loadedFlashSize) || !_decoded[_pc]._fct || _profile() || _coverage())
+      goto single ;
+
+    dec = &_decoded[_pc] ;
+    for (;;)
+    {
+#if defined(__GNUC__)
+      INSTR_DISPATCH ;
+#endif
+      switch (dec->_id)
+      {
+        INSTR_ALL(INSTR_HANDLER)
+      }
+    }
+  }
+
+#undef INSTR_HANDLER
+#undef INSTR_DISPATCH
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -7,6 +7,31 @@
 
 namespace AVR
 {
+  ////////////////////////////////////////////////////////////////////////////////
+  // Instruction List
+  ////////////////////////////////////////////////////////////////////////////////
+
+  // every implemented instruction, in the order of InstrId
+#define INSTR_ALL(X)                                                           \
+  X(ADD) X(ADC) X(ADIW) X(SUB) X(SUBI) X(SBC) X(SBCI) X(SBIW) X(AND) X(ANDI)   \
+  X(OR) X(ORI) X(EOR) X(COM) X(NEG) X(INC) X(DEC) X(MUL) X(MULS) X(MULSU)      \
+  X(FMUL) X(FMULS) X(FMULSU) X(DES) X(RJMP) X(IJMP) X(EIJMP) X(JMP) X(RCALL)   \
+  X(ICALL) X(EICALL) X(CALL) X(RET) X(RETI) X(CPSE) X(CP) X(CPC) X(CPI)        \
+  X(SBRC) X(SBRS) X(SBIC) X(SBIS) X(BRBS) X(BRBC) X(MOV) X(MOVW) X(LDI)        \
+  X(LDS) X(LDx1) X(LDx2) X(LDx3) X(LDy1) X(LDy2) X(LDy3) X(LDy4) X(LDz1)       \
+  X(LDz2) X(LDz3) X(LDz4) X(STS) X(STx1) X(STx2) X(STx3) X(STy1) X(STy2)       \
+  X(STy3) X(STy4) X(STz1) X(STz2) X(STz3) X(STz4) X(LPM1) X(LPM2) X(LPM3)      \
+  X(ELPM1) X(ELPM2) X(ELPM3) X(SPM1) X(SPM2) X(IN) X(OUT) X(PUSH) X(POP)       \
+  X(XCH) X(LAS) X(LAC) X(LAT) X(LSR) X(ROR) X(ASR) X(SWAP) X(BSET) X(BCLR)     \
+  X(SBI) X(CBI) X(BST) X(BLD) X(BREAK) X(NOP) X(SLEEP) X(WDR)
+
+#define INSTR_ID(name) name,
+  enum class InstrId : uint8_t // Instruction::Id(), handler of Mcu::RunThreaded()
+  {
+    INSTR_ALL(INSTR_ID)
+  } ;
+#undef INSTR_ID
+
   ////////////////////////////////////////////////////////////////////////////////
   // Instruction Classes
   ////////////////////////////////////////////////////////////////////////////////
@@ -18,6 +43,10 @@ namespace AVR
     Instr##name() ;                                                            \
     virtual ~Instr##name() ;                                                   \
     virtual uint8_t     Execute(Mcu &mcu, Command cmd) const ;                 \
+    virtual void        Decode (Command cmd, Operands &op) const ;             \
+    virtual ExecuteFct  Fct() const { return &Exec ; }                         \
+    virtual uint8_t     Id()  const { return (uint8_t)InstrId::name ; }        \
+    static  uint8_t     Exec   (Mcu &mcu, const Operands &op) ;                \
     virtual std::string Disasm (Mcu &mcu, Command cmd) const ;                 \
     virtual XrefType    Xref   (Mcu &mcu, Command cmd, uint32_t &addr) const ; \
   } ;                                                                          \
@@ -2,44 +2,444 @@
 // avrEmu.cpp
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <fcntl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <termios.h>
+
+#include <algorithm>
+
 #include "avr.h"
 
 namespace AVR
 {
   ////////////////////////////////////////////////////////////////////////////////
-  // Io::Register
+  // Snapshot
   ////////////////////////////////////////////////////////////////////////////////
 
-  uint8_t Io::Register::VG(uint8_t v) const
+  bool Snapshot::Read(const std::string &filename)
   {
-    char buff[1024] ;
-    char *ptr = buff ;
-    
-    if (_notImplemented)
-      ptr += sprintf(ptr, "not implemented ") ;
-    ptr += sprintf(ptr, "IO %s read at %05x: %02x", _name.c_str(), _mcu.PC(), v) ;
-    if ((' ' < v) && (v <= '~'))
-      ptr += sprintf(ptr, " %c", v) ;
-    ptr += sprintf(ptr, "\n") ;
-    _mcu.Verbose(VerboseType::Io, buff) ;
+    FILE *f = fopen(filename.c_str(), "rb") ;
+    if (!f)
+      return false ;
 
-    return v ;
+    _data.clear() ;
+    _pos = 0 ;
+    _ok  = true ;
+    while (true)
+    {
+      uint8_t bytes[0x1000] ;
+      size_t nByte = fread(bytes, sizeof(uint8_t), sizeof(bytes), f) ;
+      if (!nByte)
+        break ;
+      _data.insert(_data.end(), bytes, bytes + nByte) ;
+    }
+    fclose(f) ;
+    return true ;
   }
-  
-  uint8_t Io::Register::VS(uint8_t v) const
+
+  bool Snapshot::Write(const std::string &filename) const
+  {
+    FILE *f = fopen(filename.c_str(), "wb") ;
+    if (!f)
+      return false ;
+
+    bool ok = fwrite(_data.data(), sizeof(uint8_t), _data.size(), f) == _data.size() ;
+    return (fclose(f) == 0) && ok ;
+  }
+
+  void Snapshot::Put(const std::string &s)
+  {
+    Put((uint32_t)s.size()) ;
+    _data.insert(_data.end(), s.begin(), s.end()) ;
+  }
+
+  void Snapshot::Get(std::string &s)
+  {
+    uint32_t size = 0 ;
+    Get(size) ;
+    if (!_ok || (size > _data.size() - _pos))
+    {
+      _ok = false ;
+      return ;
+    }
+    s.assign((const char*)&_data[_pos], size) ;
+    _pos += size ;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Sink
+  ////////////////////////////////////////////////////////////////////////////////
+
+  bool Sink::Open(const std::string &target)
+  {
+    if (target == "-")
+    {
+      Attach(STDOUT_FILENO, false) ;
+      return true ;
+    }
+    if (!target.compare(0, 3, "fd:"))
+    {
+      char *end ;
+      long fd = strtol(target.c_str() + 3, &end, 0) ;
+      if (*end || (fd < 0) || (fcntl(fd, F_GETFD) < 0))
+        return false ;
+      Attach(fd, false) ;
+      return true ;
+    }
+
+    int fd = open(target.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666) ;
+    if (fd < 0)
+      return false ;
+    Attach(fd, true) ;
+    return true ;
+  }
+
+  void Sink::Attach(int fd, bool close)
+  {
+    Close() ;
+    _fd      = fd ;
+    _close   = close ;
+    _dropped = 0 ;
+    _buff.reserve(kSize) ;
+  }
+
+  void Sink::Close()
+  {
+    if (_fd < 0)
+      return ;
+    Flush() ;
+    if (_dropped)
+      fprintf(stderr, "output fd %d: %llu bytes dropped\n", _fd, (unsigned long long)_dropped) ;
+    if (_close)
+      close(_fd) ;
+    _fd      = -1 ;
+    _close   = false ;
+    _dropped = 0 ;
+    _buff.clear() ;
+  }
+
+  void Sink::Flush()
+  {
+    if ((_fd < 0) || _buff.empty())
+      return ;
+    if (_fd == STDOUT_FILENO)
+      fflush(stdout) ; // keep order with verbose output
+
+    size_t pos = 0 ;
+    while (pos < _buff.size())
+    {
+      ssize_t n = write(_fd, _buff.data() + pos, _buff.size() - pos) ;
+      if (n > 0)
+        pos += n ;
+      else if ((n < 0) && (errno == EINTR))
+        continue ;
+      else
+        break ; // EAGAIN on a non-blocking fd, retried with the next batch
+    }
+    _buff.erase(_buff.begin(), _buff.begin() + pos) ;
+    if (_buff.size() >= 4*kSize) // nobody reads, keep the newest kSize bytes
+    {
+      size_t drop = _buff.size() - kSize ;
+      _buff.erase(_buff.begin(), _buff.begin() + drop) ;
+      if (!_dropped)
+        fprintf(stderr, "output fd %d not read, dropping oldest bytes\n", _fd) ;
+      _dropped += drop ;
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Writer
+  ////////////////////////////////////////////////////////////////////////////////
+
+  bool Writer::Open(const std::string &filename)
+  {
+    Close() ;
+    _fd = open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0666) ;
+    if (_fd < 0)
+      return false ;
+    _fill.clear() ;
+    _fill.reserve(kSize) ;
+    _flush.clear() ;
+    _flush.reserve(kSize) ;
+    _busy = false ;
+    _done = false ;
+    _ok   = true ;
+    _thread = std::thread(&Writer::Run, this) ;
+    return true ;
+  }
+
+  bool Writer::Close()
+  {
+    if (_fd < 0)
+      return false ;
+    Swap() ;
+    {
+      std::unique_lock<std::mutex> lock(_mutex) ;
+      _cond.wait(lock, [this] { return !_busy ; }) ;
+      _done = true ;
+    }
+    _cond.notify_all() ;
+    _thread.join() ;
+    if (close(_fd))
+      _ok = false ;
+    _fd = -1 ;
+    return _ok ;
+  }
+
+  void Writer::Swap()
+  {
+    {
+      std::unique_lock<std::mutex> lock(_mutex) ;
+      _cond.wait(lock, [this] { return !_busy ; }) ;
+      _fill.swap(_flush) ;
+      _busy = true ;
+    }
+    _cond.notify_all() ;
+  }
+
+  void Writer::Run()
+  {
+    sigset_t signals ; // handled by the emulation thread, e.g. SIGINT, SIGPROF
+    sigfillset(&signals) ;
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr) ;
+
+    std::unique_lock<std::mutex> lock(_mutex) ;
+    while (true)
+    {
+      _cond.wait(lock, [this] { return _busy || _done ; }) ;
+      if (!_busy)
+        return ;
+
+      lock.unlock() ; // _flush is owned by this thread until _busy is cleared
+      for (size_t pos = 0 ; pos < _flush.size() ; )
+      {
+        ssize_t n = write(_fd, _flush.data() + pos, _flush.size() - pos) ;
+        if (n < 0)
+        {
+          if (errno == EINTR)
+            continue ;
+          _ok = false ;
+          break ;
+        }
+        pos += n ;
+      }
+      _flush.clear() ;
+      lock.lock() ;
+
+      _busy = false ;
+      _cond.notify_all() ;
+    }
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Source
+  ////////////////////////////////////////////////////////////////////////////////
+
+  bool Source::Open(const std::string &source)
+  {
+    if (source == "-")
+    {
+      Attach(STDIN_FILENO, false) ;
+      return true ;
+    }
+    if (!source.compare(0, 3, "fd:"))
+    {
+      char *end ;
+      long fd = strtol(source.c_str() + 3, &end, 0) ;
+      if (*end || (fd < 0) || (fcntl(fd, F_GETFD) < 0))
+        return false ;
+      Attach(fd, false) ;
+      return true ;
+    }
+
+    int fd = open(source.c_str(), O_RDONLY) ;
+    if (fd < 0)
+      return false ;
+
+    struct stat st ;
+    if ((fstat(fd, &st) < 0) || !S_ISREG(st.st_mode))
+    {
+      Attach(fd, true) ; // pipe, fifo, character device
+      return true ;
+    }
+
+    Close() ;
+    if (st.st_size)
+    {
+      void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) ;
+      if (map == MAP_FAILED)
+      {
+        close(fd) ;
+        return false ;
+      }
+      madvise(map, st.st_size, MADV_SEQUENTIAL) ;
+      _map     = (const uint8_t*)map ;
+      _mapSize = st.st_size ;
+      _mapPos  = 0 ;
+    }
+    close(fd) ;
+    Fill(false) ;
+    return true ;
+  }
+
+  void Source::Attach(int fd, bool close)
+  {
+    Close() ;
+    _fd    = fd ;
+    _close = close ;
+    Fill(true) ;
+  }
+
+  void Source::Close()
+  {
+    if (_map)
+      munmap((void*)_map, _mapSize) ;
+    _map     = nullptr ;
+    _mapSize = 0 ;
+    _mapPos  = 0 ;
+
+    if ((_fd >= 0) && _close)
+      close(_fd) ;
+    _fd    = -1 ;
+    _close = false ;
+  }
+
+  void Source::Add(const std::vector<uint8_t> &data)
+  {
+    _queue.insert(_queue.end(), data.begin(), data.end()) ;
+    Fill(false) ;
+  }
+
+  void Source::Fill(bool read)
+  {
+    while (_tail - _head < kSize)
+    {
+      uint32_t pos  = _tail & (kSize - 1) ;
+      size_t   room = std::min(kSize - (_tail - _head), kSize - pos) ; // contiguous
+      size_t   n    = 0 ;
+
+      if (_queuePos < _queue.size())
+      {
+        n = std::min(room, _queue.size() - _queuePos) ;
+        memcpy(&_ring[pos], &_queue[_queuePos], n) ;
+        _queuePos += n ;
+        if (_queuePos == _queue.size())
+        {
+          _queue.clear() ;
+          _queuePos = 0 ;
+        }
+      }
+      else if (_map)
+      {
+        n = std::min(room, _mapSize - _mapPos) ;
+        memcpy(&_ring[pos], _map + _mapPos, n) ;
+        _mapPos += n ;
+        if (_mapPos == _mapSize)
+          Close() ;
+      }
+      else if (read && (_fd >= 0))
+      {
+        struct pollfd pfd = { _fd, POLLIN, 0 } ;
+        if (poll(&pfd, 1, 0) <= 0)
+          break ;
+        ssize_t r = ::read(_fd, &_ring[pos], room) ;
+        if (r > 0)
+          n = r ;
+        else if ((r < 0) && ((errno == EINTR) || (errno == EAGAIN)))
+          break ;
+        else
+        {
+          Close() ; // end of stream
+          break ;
+        }
+      }
+
+      if (!n)
+        break ;
+      _tail += n ;
+    }
+  }
+
+  void Source::Save(Snapshot &snapshot) const
+  {
+    std::vector<uint8_t> data ;
+    for (uint32_t i = _head ; i != _tail ; ++i)
+      data.push_back(_ring[i & (kSize - 1)]) ;
+    data.insert(data.end(), _queue.begin() + _queuePos, _queue.end()) ;
+    snapshot.Put(data) ;
+  }
+
+  void Source::Load(Snapshot &snapshot)
+  {
+    _head = _tail = 0 ;
+    _queuePos = 0 ;
+    snapshot.Get(_queue) ;
+    Fill(false) ;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Pty
+  ////////////////////////////////////////////////////////////////////////////////
+
+  bool Pty::Open()
+  {
+    Close() ;
+
+    _master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK) ;
+    if ((_master < 0) || grantpt(_master) || unlockpt(_master) || !ptsname(_master))
+    {
+      Close() ;
+      return false ;
+    }
+    _name  = ptsname(_master) ;
+    _slave = open(_name.c_str(), O_RDWR | O_NOCTTY) ;
+    if (_slave < 0)
+    {
+      Close() ;
+      return false ;
+    }
+
+    struct termios tio ;
+    if (!tcgetattr(_slave, &tio))
+    {
+      cfmakeraw(&tio) ;
+      tcsetattr(_slave, TCSANOW, &tio) ;
+    }
+    return true ;
+  }
+
+  void Pty::Close()
+  {
+    if (_slave >= 0)
+      close(_slave) ;
+    if (_master >= 0)
+      close(_master) ;
+    _master = _slave = -1 ;
+    _name.clear() ;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Io::Register
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void Io::Register::VerboseIo(const char *access, uint8_t v) const
   {
     char buff[1024] ;
     char *ptr = buff ;
     
     if (_notImplemented)
       ptr += sprintf(ptr, "not implemented ") ;
-    ptr += sprintf(ptr, "IO %s write at %05x: %02x", _name.c_str(), _mcu.PC(), v) ;
+    ptr += sprintf(ptr, "IO %s %s at %05x: %02x", _name.c_str(), access, _mcu.PC(), v) ;
     if ((' ' < v) && (v <= '~'))
       ptr += sprintf(ptr, " %c", v) ;
     ptr += sprintf(ptr, "\n") ;
     _mcu.Verbose(VerboseType::Io, buff) ;
-    
-    return v  ;
   }
   
   ////////////////////////////////////////////////////////////////////////////////
@@ -57,25 +457,108 @@ namespace AVR
   
   uint8_t IoXmegaUsart::Rx() const
   {
-    if (_rxPos < _rx.size())
-      return (unsigned char) _rx[_rxPos++] ;
+    if (!RxAvail())
+      return 0 ;
 
-    _rx.clear() ;
-    _rxPos = 0 ;
-    return 0 ;
+    uint8_t c = _rx.Get() ;
+    _rx.Fill(false) ;
+    if (_paced)
+      _rxReady = std::max(_rxReady, _mcu.Ticks()) + FrameTicks() ;
+    RxSchedule() ;
+    Irq() ;
+    return c ;
+  }
+  bool IoXmegaUsart::RxAvail() const
+  {
+    return !_rx.Empty() && (!_paced || (_mcu.Ticks() >= _rxReady)) ;
+  }
+  void IoXmegaUsart::RxSchedule() const
+  {
+    IoXmegaUsart *port = const_cast<IoXmegaUsart*>(this) ;
+    if (_paced && !_rx.Empty() && (_rxReady > _mcu.Ticks()))
+      _mcu.Schedule(_rxReady, port, kEventRxReady) ;
   }
   void IoXmegaUsart::Tx(uint8_t c) const
   {
+    _tx.Put(c) ;
+    _txc = true ;
+    Irq() ;
   }
   void IoXmegaUsart::Add(const std::vector<uint8_t> &data)
   {
-    _rx.insert(std::end(_rx), std::begin(data), std::end(data));
+    _rx.Add(data) ;
+    RxSchedule() ;
+    Irq() ;
+  }
+  bool IoXmegaUsart::OpenPty(std::string &name)
+  {
+    if (!_pty.Open())
+      return false ;
+    _rx.Attach(_pty.Master(), false) ;
+    _tx.Attach(_pty.Master(), false) ;
+    _mcu.Schedule(_mcu.Ticks() + Source::kPollTicks, this, kEventPoll) ;
+    name = _pty.Name() ;
+    return true ;
+  }
+  bool IoXmegaUsart::Input(const std::string &source, bool paced)
+  {
+    if (!_rx.Open(source))
+      return false ;
+    _paced = paced ;
+    if (_rx.Polling())
+      _mcu.Schedule(_mcu.Ticks() + Source::kPollTicks, this, kEventPoll) ;
+    RxSchedule() ;
+    Irq() ;
+    return true ;
+  }
+  void IoXmegaUsart::Save(Snapshot &snapshot) const
+  {
+    _rx.Save(snapshot)       ; snapshot.Put(_rxReady)   ; snapshot.Put(_txc) ;
+    snapshot.Put(_ctrlA)     ; snapshot.Put(_ctrlB)     ; snapshot.Put(_ctrlC) ;
+    snapshot.Put(_baudCtrlA) ; snapshot.Put(_baudCtrlB) ;
+  }
+  void IoXmegaUsart::Load(Snapshot &snapshot)
+  {
+    _rx.Load(snapshot)       ; snapshot.Get(_rxReady)   ; snapshot.Get(_txc) ;
+    snapshot.Get(_ctrlA)     ; snapshot.Get(_ctrlB)     ; snapshot.Get(_ctrlC) ;
+    snapshot.Get(_baudCtrlA) ; snapshot.Get(_baudCtrlB) ;
+  }
+  void IoXmegaUsart::Wakeup(uint32_t id)
+  {
+    if (id == kEventPoll)
+    {
+      _tx.Flush() ;
+      _rx.Fill(true) ;
+      if (_rx.Polling())
+        _mcu.Schedule(_mcu.Ticks() + Source::kPollTicks, this, kEventPoll) ;
+      RxSchedule() ;
+    }
+    Irq() ;
+  }
+  void IoXmegaUsart::Acknowledge(uint32_t vector)
+  {
+    if (vector == _irqVector + 2) // TXCIF cleared by hardware
+    {
+      _txc = false ;
+      Irq() ;
+    }
+  }
+  void IoXmegaUsart::Irq() const
+  {
+    uint8_t rxcLvl = (_ctrlA >> 4) & 0x03 ;
+    uint8_t txcLvl = (_ctrlA >> 2) & 0x03 ;
+    uint8_t dreLvl = (_ctrlA >> 0) & 0x03 ;
+    IoXmegaUsart *port = const_cast<IoXmegaUsart*>(this) ;
+
+    _mcu.Irq(_irqVector + 0, rxcLvl && RxAvail(), port, rxcLvl) ;
+    _mcu.Irq(_irqVector + 1, dreLvl != 0        , port, dreLvl) ; // data register always empty
+    _mcu.Irq(_irqVector + 2, txcLvl && _txc     , port, txcLvl) ;
   }
 
-  uint8_t IoXmegaUsart::GetStatus() const       { return (RxAvail() ? 0x80 : 0x00) | 0x40 | 0x20 ; }
-  void    IoXmegaUsart::SetStatus(uint8_t v)    { } // ignore
+  uint8_t IoXmegaUsart::GetStatus() const       { return (RxAvail() ? 0x80 : 0x00) | (_txc ? 0x40 : 0x00) | 0x20 ; }
+  void    IoXmegaUsart::SetStatus(uint8_t v)    { if (v & 0x40) { _txc = false ; Irq() ; } } // TXCIF, others ignored
   uint8_t IoXmegaUsart::GetCtrlA() const        { return _ctrlA ; }
-  void    IoXmegaUsart::SetCtrlA(uint8_t v)     { _ctrlA = v & 0x3f ; }
+  void    IoXmegaUsart::SetCtrlA(uint8_t v)     { _ctrlA = v & 0x3f ; Irq() ; }
   uint8_t IoXmegaUsart::GetCtrlB() const        { return _ctrlB ; }
   void    IoXmegaUsart::SetCtrlB(uint8_t v)     { _ctrlB = v & 0x1f ; }
   uint8_t IoXmegaUsart::GetCtrlC() const        { return _ctrlC ; }
@@ -85,6 +568,60 @@ namespace AVR
   uint8_t IoXmegaUsart::GetBaudCtrlB() const    { return _baudCtrlB ; }
   void    IoXmegaUsart::SetBaudCtrlB(uint8_t v) { _baudCtrlB = v ; }
 
+  uint64_t IoXmegaUsart::FrameTicks() const
+  {
+    uint32_t bsel   = ((_baudCtrlB & 0x0f) << 8) | _baudCtrlA ;
+    int      bscale = (int8_t)_baudCtrlB >> 4 ; // -7..7
+    uint64_t mult   = (_ctrlB & 0x04) ? 8 : 16 ; // CLK2X
+    uint64_t bit    = (bscale >= 0) ? ((mult * (bsel + 1)) << bscale) : (((mult * bsel) >> -bscale) + mult) ;
+    uint8_t  chSize = _ctrlC & 0x07 ;
+    uint32_t bits   = 1 + ((chSize == 0x07) ? 9 : (5 + (chSize & 0x03))) + ((_ctrlC & 0x20) ? 1 : 0) + ((_ctrlC & 0x08) ? 2 : 1) ;
+    return bit * bits ; // peripheral clock = CPU clock
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // IoXmegaPmic
+  ////////////////////////////////////////////////////////////////////////////////
+
+  void IoXmegaPmic::Save(Snapshot &snapshot) const
+  {
+    snapshot.Put(_status) ; snapshot.Put(_intPri) ; snapshot.Put(_ctrl) ;
+  }
+
+  void IoXmegaPmic::Load(Snapshot &snapshot)
+  {
+    snapshot.Get(_status) ; snapshot.Get(_intPri) ; snapshot.Get(_ctrl) ;
+  }
+
+  void IoXmegaPmic::SetIntPri(uint8_t v)
+  {
+    _intPri = v ; // round robin scheduling not supported
+  }
+
+  void IoXmegaPmic::SetCtrl(uint8_t v)
+  {
+    _ctrl = v & 0xc7 ;
+    _mcu.IrqUpdate() ;
+  }
+
+  bool IoXmegaPmic::Enabled(uint8_t level) const
+  {
+    uint8_t bit = 1 << (level - 1) ; // LOLVLEN / MEDLVLEN / HILVLEN, LOLVLEX / MEDLVLEX / HILVLEX
+    return (_ctrl & bit) && (bit > (_status & 0x07)) ;
+  }
+
+  void IoXmegaPmic::Enter(uint8_t level)
+  {
+    _status |= 1 << (level - 1) ;
+  }
+
+  void IoXmegaPmic::Return()
+  {
+    if      (_status & 0x04) _status &= ~0x04 ;
+    else if (_status & 0x02) _status &= ~0x02 ;
+    else                     _status &= ~0x01 ;
+  }
+
   ////////////////////////////////////////////////////////////////////////////////
   // IoXmegaCpu
   ////////////////////////////////////////////////////////////////////////////////
@@ -93,6 +630,16 @@ namespace AVR
   {
   }
 
+  void IoXmegaCpu::Save(Snapshot &snapshot) const
+  {
+    snapshot.Put(_value) ; snapshot.Put(_ticks) ;
+  }
+
+  void IoXmegaCpu::Load(Snapshot &snapshot)
+  {
+    snapshot.Get(_value) ; snapshot.Get(_ticks) ;
+  }
+
   uint8_t IoXmegaCpu::GetCcp() const
   {
     uint8_t v = (_ticks + 4 > _mcu.Ticks()) ? _value : 0x00 ;
@@ -109,6 +656,12 @@ namespace AVR
     }
   }  
 
+  bool IoXmegaCpu::Polled(uint64_t &until) const
+  {
+    until = (_ticks + 4 > _mcu.Ticks()) ? _ticks + 4 : UINT64_MAX ;
+    return true ;
+  }
+
   ////////////////////////////////////////////////////////////////////////////////
   // IoXmegaClk
   ////////////////////////////////////////////////////////////////////////////////
@@ -117,6 +670,16 @@ namespace AVR
   {
   }
 
+  void IoXmegaClk::Save(Snapshot &snapshot) const
+  {
+    snapshot.Put(_rtcCtrl) ; snapshot.Put(_rtcFreq) ;
+  }
+
+  void IoXmegaClk::Load(Snapshot &snapshot)
+  {
+    snapshot.Get(_rtcCtrl) ; snapshot.Get(_rtcFreq) ;
+  }
+
   uint8_t IoXmegaClk::GetRtcCtrl() const
   {
     return _rtcCtrl ;
@@ -157,9 +720,23 @@ namespace AVR
   // IoXmegaNvm
   ////////////////////////////////////////////////////////////////////////////////
 
-  IoXmegaNvm::IoXmegaNvm(Mcu &mcu, IoXmegaCpu &cpu)
-    : _mcu(mcu), _cpu(cpu), _lpm(LpmType::Flash)
+  IoXmegaNvm::IoXmegaNvm(Mcu &mcu, IoXmegaCpu &cpu, uint32_t irqVector)
+    : _mcu(mcu), _cpu(cpu), _irqVector(irqVector), _lpm(LpmType::Flash)
+  {
+  }
+
+  void IoXmegaNvm::Save(Snapshot &snapshot) const
+  {
+    snapshot.Put(_addr)    ; snapshot.Put(_data)     ; snapshot.Put(_cmd) ;
+    snapshot.Put(_ctrlB)   ; snapshot.Put(_intCtrl)  ; snapshot.Put(_lockBits) ;
+    snapshot.Put(_lpm)     ;
+  }
+
+  void IoXmegaNvm::Load(Snapshot &snapshot)
   {
+    snapshot.Get(_addr)    ; snapshot.Get(_data)     ; snapshot.Get(_cmd) ;
+    snapshot.Get(_ctrlB)   ; snapshot.Get(_intCtrl)  ; snapshot.Get(_lockBits) ;
+    snapshot.Get(_lpm)     ;
   }
   
   uint8_t  IoXmegaNvm::GetAddr0()
@@ -327,6 +904,12 @@ namespace AVR
   void    IoXmegaNvm::SetIntCtrl(uint8_t v)
   {
     _intCtrl = v & 0x0f ;
+
+    // NVM is never busy, EE and SPM interrupts are requested while enabled
+    uint8_t eeLvl  = (_intCtrl >> 0) & 0x03 ;
+    uint8_t spmLvl = (_intCtrl >> 2) & 0x03 ;
+    _mcu.Irq(_irqVector + 0, eeLvl  != 0, this, eeLvl ) ;
+    _mcu.Irq(_irqVector + 1, spmLvl != 0, this, spmLvl) ;
   }
 
   uint8_t IoXmegaNvm::GetStatus()
@@ -363,84 +946,846 @@ namespace AVR
   // IoXmegaRtc
   ////////////////////////////////////////////////////////////////////////////////
 
-  IoXmegaRtc::IoXmegaRtc(Mcu &mcu, IoXmegaClk &clk) : _mcu(mcu), _clk(clk), _ticks(0), _prescaler(0), _prescalerDiv(1), _cnt(0), _tmp(0)
+  IoXmegaRtc::IoXmegaRtc(Mcu &mcu, IoXmegaClk &clk, uint32_t irqVector)
+    : _mcu(mcu), _clk(clk), _irqVector(irqVector), _ticks(0), _clocks(0), _prescaler(0), _prescalerDiv(1), _cnt(0),
+      _per(0xffff), _comp(0), _intCtrl(0), _intFlags(0), _tmp(0)
   {
   }
 
-  uint8_t IoXmegaRtc::GetCntL() const
+  void IoXmegaRtc::Save(Snapshot &snapshot) const
   {
-    uint64_t ticks = _mcu.Ticks() * _clk.GetRtcFreq() / 32000000 ;
-    
-    if (_clk.GetRtcEnable() && _prescaler)
-    {
-      _cnt += (ticks - _ticks) / _prescalerDiv ;
-      _ticks = ticks ;
-    }
-    _tmp = (_cnt >> 8) & 0xff ;
-    return (_cnt >> 0) & 0xff ;
+    snapshot.Put(_ticks) ; snapshot.Put(_clocks)  ; snapshot.Put(_prescaler) ; snapshot.Put(_prescalerDiv) ;
+    snapshot.Put(_cnt)   ; snapshot.Put(_per)     ; snapshot.Put(_comp)      ;
+    snapshot.Put(_intCtrl) ; snapshot.Put(_intFlags) ; snapshot.Put(_tmp)    ;
   }
-  
-  uint8_t IoXmegaRtc::GetPrescaler() const
+
+  void IoXmegaRtc::Load(Snapshot &snapshot)
   {
-    return _prescaler ;
+    snapshot.Get(_ticks) ; snapshot.Get(_clocks)  ; snapshot.Get(_prescaler) ; snapshot.Get(_prescalerDiv) ;
+    snapshot.Get(_cnt)   ; snapshot.Get(_per)     ; snapshot.Get(_comp)      ;
+    snapshot.Get(_intCtrl) ; snapshot.Get(_intFlags) ; snapshot.Get(_tmp)    ;
   }
-  
-  void    IoXmegaRtc::SetPrescaler(uint8_t v)
+
+  void IoXmegaRtc::Wakeup(uint32_t id)
   {
-    _prescaler = v & 0x07 ;
-    switch (_prescaler)
-    {
-    default: break ;
-    case 1: _prescalerDiv =    1 ; break ;
-    case 2: _prescalerDiv =    2 ; break ;
-    case 3: _prescalerDiv =    8 ; break ;
-    case 4: _prescalerDiv =   16 ; break ;
-    case 5: _prescalerDiv =   64 ; break ;
+    Update() ;
+    Irq() ;
+    Schedule() ;
+  }
+
+  void IoXmegaRtc::Acknowledge(uint32_t vector)
+  {
+    _intFlags &= (vector == _irqVector) ? ~kOvfIf : ~kCompIf ;
+    Irq() ;
+  }
+
+  bool IoXmegaRtc::Running() const
+  {
+    return _clk.GetRtcEnable() && _prescaler && _clk.GetRtcFreq() ;
+  }
+
+  uint64_t IoXmegaRtc::Clock(uint64_t ticks) const
+  {
+    return ticks * _clk.GetRtcFreq() / 32000000 ;
+  }
+
+  void IoXmegaRtc::Update() const
+  {
+    uint64_t ticks = _mcu.Ticks() ;
+
+    if (Running())
+    {
+      _clocks += Clock(ticks) - Clock(_ticks) ;
+      uint64_t n   = _clocks / _prescalerDiv ;
+      uint64_t top = (uint64_t)_per + 1 ;
+      _clocks %= _prescalerDiv ;
+
+      if (n)
+      {
+        _cnt %= top ;
+        if ((_comp < top) && (n > (_comp + top - _cnt - 1) % top))
+          _intFlags |= kCompIf ;
+        if (n >= top - _cnt)
+          _intFlags |= kOvfIf ;
+        _cnt = (_cnt + n) % top ;
+      }
+    }
+    _ticks = ticks ;
+  }
+
+  void IoXmegaRtc::Schedule()
+  {
+    uint64_t top = (uint64_t)_per + 1 ;
+    uint64_t n   = 0 ; // counts to next interrupt
+
+    if (Running())
+    {
+      if (_intCtrl & 0x03)
+        n = top - (_cnt % top) ;
+      if ((_intCtrl & 0x0c) && (_comp < top))
+      {
+        uint64_t nComp = (_comp + top - (_cnt % top) - 1) % top + 1 ;
+        if (!n || (nComp < n))
+          n = nComp ;
+      }
+    }
+
+    if (!n)
+    {
+      _mcu.Unschedule(this) ;
+      return ;
+    }
+
+    _mcu.Schedule(Ticks(n), this) ;
+  }
+
+  uint64_t IoXmegaRtc::Ticks(uint64_t counts) const
+  {
+    uint64_t freq  = _clk.GetRtcFreq() ;
+    uint64_t clock = Clock(_ticks) + counts * _prescalerDiv - _clocks ;
+    return (clock * 32000000 + freq - 1) / freq ;
+  }
+
+  bool IoXmegaRtc::Polled(uint64_t &until, bool cnt) const
+  {
+    Update() ;
+    until = UINT64_MAX ;
+    if (!Running())
+      return true ;
+
+    uint64_t top = (uint64_t)_per + 1 ;
+    uint64_t n   = cnt ? 1 : top - (_cnt % top) ; // counts to next change
+    if (!cnt && (_comp < top))
+      n = std::min(n, (_comp + top - (_cnt % top) - 1) % top + 1) ;
+    until = Ticks(n) ;
+    return true ;
+  }
+
+  void IoXmegaRtc::Irq()
+  {
+    uint8_t ovfLevel  = (_intCtrl >> 0) & 0x03 ;
+    uint8_t compLevel = (_intCtrl >> 2) & 0x03 ;
+
+    _mcu.Irq(_irqVector + 0, ovfLevel  && (_intFlags & kOvfIf) , this, ovfLevel) ;
+    _mcu.Irq(_irqVector + 1, compLevel && (_intFlags & kCompIf), this, compLevel) ;
+  }
+
+  uint8_t IoXmegaRtc::GetPrescaler() const
+  {
+    return _prescaler ;
+  }
+  
+  void    IoXmegaRtc::SetPrescaler(uint8_t v)
+  {
+    Update() ;
+    _prescaler = v & 0x07 ;
+    switch (_prescaler)
+    {
+    default: break ;
+    case 1: _prescalerDiv =    1 ; break ;
+    case 2: _prescalerDiv =    2 ; break ;
+    case 3: _prescalerDiv =    8 ; break ;
+    case 4: _prescalerDiv =   16 ; break ;
+    case 5: _prescalerDiv =   64 ; break ;
     case 6: _prescalerDiv =  256 ; break ;
     case 7: _prescalerDiv = 1024 ; break ;
     }
+    _clocks %= _prescalerDiv ;
+    Schedule() ;
+  }
+
+  uint8_t IoXmegaRtc::GetStatus() const
+  {
+    return 0 ;
+  }
+  
+  void IoXmegaRtc::SetStatus(uint8_t v)
+  {
+    // igonre
+  }
+  
+  uint8_t IoXmegaRtc::GetIntCtrl() const
+  {
+    return _intCtrl ;
+  }
+
+  void    IoXmegaRtc::SetIntCtrl(uint8_t v)
+  {
+    Update() ;
+    _intCtrl = v & 0x0f ;
+    Irq() ;
+    Schedule() ;
+  }
+
+  uint8_t IoXmegaRtc::GetIntFlags() const
+  {
+    Update() ;
+    return _intFlags ;
+  }
+
+  void    IoXmegaRtc::SetIntFlags(uint8_t v)
+  {
+    Update() ;
+    _intFlags &= ~v ;
+    Irq() ;
+  }
+
+  uint8_t IoXmegaRtc::GetCntL() const
+  {
+    Update() ;
+    _tmp = (_cnt >> 8) & 0xff ;
+    return (_cnt >> 0) & 0xff ;
+  }
+  
+  void    IoXmegaRtc::SetCntL(uint8_t v)
+  {
+    _tmp = v ;
+  }
+  
+  uint8_t IoXmegaRtc::GetCntH() const
+  {
+    return _tmp ;
+  }
+  
+  void    IoXmegaRtc::SetCntH(uint8_t v)
+  {
+    Update() ;
+    _cnt = ((uint32_t)v << 8) | _tmp ;
+    Schedule() ;
+  }
+  
+  uint8_t IoXmegaRtc::GetPerL() const
+  {
+    _tmp = (_per >> 8) & 0xff ;
+    return (_per >> 0) & 0xff ;
+  }
+
+  void    IoXmegaRtc::SetPerL(uint8_t v)
+  {
+    _tmp = v ;
+  }
+
+  uint8_t IoXmegaRtc::GetPerH() const
+  {
+    return _tmp ;
+  }
+
+  void    IoXmegaRtc::SetPerH(uint8_t v)
+  {
+    Update() ;
+    _per = ((uint16_t)v << 8) | _tmp ;
+    Schedule() ;
+  }
+
+  uint8_t IoXmegaRtc::GetCompL() const
+  {
+    _tmp = (_comp >> 8) & 0xff ;
+    return (_comp >> 0) & 0xff ;
+  }
+
+  void    IoXmegaRtc::SetCompL(uint8_t v)
+  {
+    _tmp = v ;
+  }
+
+  uint8_t IoXmegaRtc::GetCompH() const
+  {
+    return _tmp ;
+  }
+
+  void    IoXmegaRtc::SetCompH(uint8_t v)
+  {
+    Update() ;
+    _comp = ((uint16_t)v << 8) | _tmp ;
+    Schedule() ;
+  }
+
+  uint8_t IoXmegaRtc::GetTemp() const
+  {
+    return _tmp ;
+  }
+  
+  void    IoXmegaRtc::SetTemp(uint8_t v)
+  {
+    _tmp = v ;
+  }
+  
+  ////////////////////////////////////////////////////////////////////////////////
+  // IoXmegaTc
+  ////////////////////////////////////////////////////////////////////////////////
+
+  IoXmegaTc::IoXmegaTc(Mcu &mcu, const std::string &name, uint32_t irqVector, uint8_t channels)
+    : _mcu(mcu), _name(name), _irqVector(irqVector), _channels(channels), _ticks(0), _cnt(0), _down(false),
+      _ctrlA(0), _ctrlB(0), _ctrlC(0), _ctrlD(0), _ctrlE(0), _intCtrlA(0), _intCtrlB(0), _ctrlF(0), _ctrlG(0),
+      _intFlags(0), _tmp(0), _per(0xffff), _cc(), _perBuf(0xffff), _ccBuf()
+  {
+  }
+
+  void IoXmegaTc::Save(Snapshot &snapshot) const
+  {
+    snapshot.Put(_ticks) ; snapshot.Put(_cnt) ; snapshot.Put(_down) ;
+    snapshot.Put(_ctrlA) ; snapshot.Put(_ctrlB) ; snapshot.Put(_ctrlC) ; snapshot.Put(_ctrlD) ; snapshot.Put(_ctrlE) ;
+    snapshot.Put(_intCtrlA) ; snapshot.Put(_intCtrlB) ; snapshot.Put(_ctrlF) ; snapshot.Put(_ctrlG) ;
+    snapshot.Put(_intFlags) ; snapshot.Put(_tmp) ; snapshot.Put(_per) ; snapshot.Put(_perBuf) ;
+    for (uint8_t ch = 0 ; ch < 4 ; ++ch)
+    {
+      snapshot.Put(_cc[ch]) ; snapshot.Put(_ccBuf[ch]) ;
+    }
+  }
+
+  void IoXmegaTc::Load(Snapshot &snapshot)
+  {
+    snapshot.Get(_ticks) ; snapshot.Get(_cnt) ; snapshot.Get(_down) ;
+    snapshot.Get(_ctrlA) ; snapshot.Get(_ctrlB) ; snapshot.Get(_ctrlC) ; snapshot.Get(_ctrlD) ; snapshot.Get(_ctrlE) ;
+    snapshot.Get(_intCtrlA) ; snapshot.Get(_intCtrlB) ; snapshot.Get(_ctrlF) ; snapshot.Get(_ctrlG) ;
+    snapshot.Get(_intFlags) ; snapshot.Get(_tmp) ; snapshot.Get(_per) ; snapshot.Get(_perBuf) ;
+    for (uint8_t ch = 0 ; ch < 4 ; ++ch)
+    {
+      snapshot.Get(_cc[ch]) ; snapshot.Get(_ccBuf[ch]) ;
+    }
+  }
+
+  void IoXmegaTc::Wakeup(uint32_t id)
+  {
+    Update() ;
+    Irq() ;
+    Schedule() ;
+  }
+
+  void IoXmegaTc::Acknowledge(uint32_t vector)
+  {
+    Update() ;
+    if (vector == _irqVector)
+      _intFlags &= ~kOvfIf ;
+    else if (vector >= _irqVector + 2)
+      _intFlags &= ~(kCcAIf << (vector - _irqVector - 2)) ;
+    Irq() ;
+    Schedule() ;
+  }
+
+  uint32_t IoXmegaTc::Div() const
+  {
+    switch (_ctrlA & 0x0f)
+    {
+    default: return    0 ; // off, event channels not supported
+    case 1:  return    1 ;
+    case 2:  return    2 ;
+    case 3:  return    4 ;
+    case 4:  return    8 ;
+    case 5:  return   64 ;
+    case 6:  return  256 ;
+    case 7:  return 1024 ;
+    }
+  }
+
+  uint32_t IoXmegaTc::Top() const
+  {
+    return (Mode() == 1) ? _cc[0] : _per ; // FRQ: CCA
+  }
+
+  uint32_t IoXmegaTc::Period() const
+  {
+    uint32_t top = Top() ;
+    return DualSlope() ? std::max(2 * top, 1u) : top + 1 ;
+  }
+
+  // positions in a period: up 0..TOP, dual slope down TOP-1..1 as 2*TOP-CNT
+  // CNT above TOP (written) counts up to MAX and wraps to BOTTOM first
+  uint32_t IoXmegaTc::Counts(uint32_t pos0, uint32_t pos1) const
+  {
+    uint32_t top    = Top() ;
+    uint32_t period = Period() ;
+    uint32_t pre    = 0 ;
+    uint32_t pos ;
+
+    if (_cnt > top)
+    {
+      pre = kMax - _cnt ;
+      pos = period - 1 ;
+    }
+    else
+      pos = _down ? period - _cnt : _cnt ;
+
+    return pre + std::min((pos0 + period - pos - 1) % period + 1,
+                          (pos1 + period - pos - 1) % period + 1) ;
+  }
+
+  uint32_t IoXmegaTc::Counts(uint8_t flag) const
+  {
+    uint32_t top    = Top() ;
+    uint32_t period = Period() ;
+
+    if (flag == kOvfIf)
+    {
+      switch (Mode())
+      {
+      case 5:  return Counts(top, top) ; // DSTOP
+      case 6:  return Counts(top, 0) ;   // DSBOTH
+      default: return Counts(0, 0) ;     // TOP -> BOTTOM, DSBOTTOM
+      }
+    }
+
+    uint8_t  ch = __builtin_ctz(flag / kCcAIf) ;
+    uint32_t cc = _cc[ch] ;
+    if (cc > top)
+      return 0 ;
+    return Counts(cc, DualSlope() ? (period - cc) % period : cc) ;
+  }
+
+  bool IoXmegaTc::Buffered() const
+  {
+    return (_ctrlG & ((kPerBv << (_channels + 1)) - 1)) && !(_ctrlF & kLupd) ;
+  }
+
+  void IoXmegaTc::Count(uint64_t n) const
+  {
+    while (n)
+    {
+      uint64_t m      = n ;
+      bool     update = false ;
+      if (Buffered())
+      {
+        uint32_t counts = Counts(0, 0) ;
+        if (counts <= n)
+        {
+          m      = counts ;
+          update = true ;
+        }
+      }
+
+      for (uint8_t ch = 0 ; ch <= _channels ; ++ch)
+      {
+        uint8_t  flag   = ch ? kCcAIf << (ch - 1) : kOvfIf ;
+        uint32_t counts = Counts(flag) ;
+        if (counts && (m >= counts))
+          _intFlags |= flag ;
+      }
+
+      Advance(m) ;
+      if (update)
+        UpdateBuffers() ;
+      n -= m ;
+    }
+  }
+
+  void IoXmegaTc::Advance(uint64_t n) const
+  {
+    uint32_t top    = Top() ;
+    uint32_t period = Period() ;
+    uint32_t pos ;
+    if (_cnt > top)
+    {
+      if (n <= kMax - _cnt)
+      {
+        _cnt += n ;
+        return ;
+      }
+      n  -= kMax + 1 - _cnt ;
+      pos = 0 ;
+    }
+    else
+      pos = _down ? period - _cnt : _cnt ;
+
+    pos   = (pos + n) % period ;
+    _down = pos > top ;
+    _cnt  = _down ? period - pos : pos ;
+  }
+
+  void IoXmegaTc::UpdateBuffers() const
+  {
+    if (_ctrlG & kPerBv)
+      _per = _perBuf ;
+    for (uint8_t ch = 0 ; ch < _channels ; ++ch)
+    {
+      if (_ctrlG & (kPerBv << (ch + 1)))
+        _cc[ch] = _ccBuf[ch] ;
+    }
+    _ctrlG = 0 ;
+    if (_down && (_cnt > Top()))
+      _down = false ;
+  }
+
+  void IoXmegaTc::Update() const
+  {
+    uint64_t ticks = _mcu.Ticks() ;
+    uint32_t div   = Div() ;
+
+    if (div)
+    {
+      uint64_t n = ticks / div - _ticks / div ; // prescaler runs continuously
+      if (n)
+        Count(n) ;
+    }
+    _ticks = ticks ;
+  }
+
+  uint64_t IoXmegaTc::Ticks(uint64_t counts) const
+  {
+    uint32_t div = Div() ;
+    return (_ticks / div + counts) * div ;
+  }
+
+  uint8_t IoXmegaTc::Level(uint8_t flag) const
+  {
+    if (flag == kOvfIf)
+      return _intCtrlA & 0x03 ;
+    return (_intCtrlB >> (2 * __builtin_ctz(flag / kCcAIf))) & 0x03 ;
+  }
+
+  void IoXmegaTc::Schedule()
+  {
+    uint32_t n = 0 ; // counts to next interrupt
+
+    if (Div())
+    {
+      for (uint8_t ch = 0 ; ch <= _channels ; ++ch)
+      {
+        uint8_t flag = ch ? kCcAIf << (ch - 1) : kOvfIf ;
+        if (!Level(flag) || (_intFlags & flag))
+          continue ;
+        uint32_t counts = Counts(flag) ;
+        if (counts && (!n || (counts < n)))
+          n = counts ;
+      }
+      if (n && Buffered())
+        n = std::min(n, Counts(0, 0)) ; // schedule again with the new values
+    }
+
+    if (!n)
+    {
+      _mcu.Unschedule(this) ;
+      return ;
+    }
+
+    _mcu.Schedule(Ticks(n), this) ;
+  }
+
+  bool IoXmegaTc::Polled(uint64_t &until, bool cnt) const
+  {
+    Update() ;
+    until = UINT64_MAX ;
+    if (!Div())
+      return true ;
+
+    uint32_t n = 1 ; // counts to next change
+    if (!cnt)
+    {
+      n = Buffered() ? Counts(0, 0) : 0 ;
+      for (uint8_t ch = 0 ; ch <= _channels ; ++ch)
+      {
+        uint8_t flag = ch ? kCcAIf << (ch - 1) : kOvfIf ;
+        if (_intFlags & flag)
+          continue ;
+        uint32_t counts = Counts(flag) ;
+        if (counts && (!n || (counts < n)))
+          n = counts ;
+      }
+    }
+    if (n)
+      until = Ticks(n) ;
+    return true ;
+  }
+
+  void IoXmegaTc::Irq()
+  {
+    for (uint8_t ch = 0 ; ch <= _channels ; ++ch)
+    {
+      uint8_t flag  = ch ? kCcAIf << (ch - 1) : kOvfIf ;
+      uint8_t level = Level(flag) ;
+      _mcu.Irq(_irqVector + (ch ? ch + 1 : 0), level && (_intFlags & flag), this, level) ; // ERR never set
+    }
+  }
+
+  uint8_t IoXmegaTc::GetCtrlA() const
+  {
+    return _ctrlA ;
+  }
+
+  void    IoXmegaTc::SetCtrlA(uint8_t v)
+  {
+    Update() ;
+    _ctrlA = v & 0x0f ;
+    Schedule() ;
+  }
+
+  uint8_t IoXmegaTc::GetCtrlB() const
+  {
+    return _ctrlB ;
+  }
+
+  void    IoXmegaTc::SetCtrlB(uint8_t v)
+  {
+    Update() ;
+    _ctrlB = v & ((((1 << _channels) - 1) << 4) | 0x07) ; // CCxEN, WGMODE
+    if (!DualSlope())
+      _down = false ;
+    Schedule() ;
+  }
+
+  uint8_t IoXmegaTc::GetIntCtrlA() const
+  {
+    return _intCtrlA ;
+  }
+
+  void    IoXmegaTc::SetIntCtrlA(uint8_t v)
+  {
+    Update() ;
+    _intCtrlA = v & 0x0f ;
+    Irq() ;
+    Schedule() ;
+  }
+
+  uint8_t IoXmegaTc::GetIntCtrlB() const
+  {
+    return _intCtrlB ;
+  }
+
+  void    IoXmegaTc::SetIntCtrlB(uint8_t v)
+  {
+    Update() ;
+    _intCtrlB = v & ((1 << (2 * _channels)) - 1) ;
+    Irq() ;
+    Schedule() ;
+  }
+
+  uint8_t IoXmegaTc::GetCtrlF() const
+  {
+    Update() ;
+    return (_ctrlF & kLupd) | ((DualSlope() ? _down : (_ctrlF & kDir)) ? kDir : 0) ;
+  }
+
+  void    IoXmegaTc::ClrCtrlF(uint8_t v)
+  {
+    Update() ;
+    _ctrlF &= ~(v & (kLupd | kDir)) ; // DIR is stored only, single slope modes count up
+    Schedule() ;
+  }
+
+  void    IoXmegaTc::SetCtrlF(uint8_t v)
+  {
+    Update() ;
+    _ctrlF |= v & (kLupd | kDir) ;
+    switch ((v >> 2) & 0x03)
+    {
+    case 1: // UPDATE
+      UpdateBuffers() ;
+      break ;
+    case 2: // RESTART
+      _cnt  = 0 ;
+      _down = false ;
+      break ;
+    case 3: // RESET
+      if (!Div())
+      {
+        _ctrlA = _ctrlB = _ctrlC = _ctrlD = _ctrlE = _intCtrlA = _intCtrlB = _ctrlF = _ctrlG = _intFlags = 0 ;
+        _cnt    = 0 ;
+        _down   = false ;
+        _per    = _perBuf = 0xffff ;
+        for (uint8_t ch = 0 ; ch < 4 ; ++ch)
+          _cc[ch] = _ccBuf[ch] = 0 ;
+        Irq() ;
+      }
+      break ;
+    }
+    Schedule() ;
+  }
+
+  uint8_t IoXmegaTc::GetCtrlG() const
+  {
+    Update() ;
+    return _ctrlG ;
+  }
+
+  void    IoXmegaTc::ClrCtrlG(uint8_t v)
+  {
+    Update() ;
+    _ctrlG &= ~v ;
+    Schedule() ;
+  }
+
+  void    IoXmegaTc::SetCtrlG(uint8_t v)
+  {
+    Update() ;
+    _ctrlG |= v & ((kPerBv << (_channels + 1)) - 1) ;
+    Schedule() ;
+  }
+
+  uint8_t IoXmegaTc::GetIntFlags() const
+  {
+    Update() ;
+    return _intFlags ;
+  }
+
+  void    IoXmegaTc::SetIntFlags(uint8_t v)
+  {
+    Update() ;
+    _intFlags &= ~v ;
+    Irq() ;
+    Schedule() ;
+  }
+
+  uint8_t IoXmegaTc::GetTemp() const
+  {
+    return _tmp ;
+  }
+
+  void    IoXmegaTc::SetTemp(uint8_t v)
+  {
+    _tmp = v ;
+  }
+
+  uint8_t IoXmegaTc::GetCntL() const
+  {
+    Update() ;
+    _tmp = (_cnt >> 8) & 0xff ;
+    return (_cnt >> 0) & 0xff ;
+  }
+
+  void    IoXmegaTc::SetCntL(uint8_t v)
+  {
+    _tmp = v ;
+  }
+
+  uint8_t IoXmegaTc::GetCntH() const
+  {
+    return _tmp ;
   }
 
-  uint8_t IoXmegaRtc::GetStatus() const
+  void    IoXmegaTc::SetCntH(uint8_t v)
   {
-    return 0 ;
+    Update() ;
+    _cnt = ((uint16_t)v << 8) | _tmp ;
+    if (_down && (_cnt > Top()))
+      _down = false ;
+    Schedule() ;
   }
-  
-  void IoXmegaRtc::SetStatus(uint8_t v)
+
+  uint8_t IoXmegaTc::GetPerL() const
   {
-    // igonre
+    Update() ;
+    _tmp = (_per >> 8) & 0xff ;
+    return (_per >> 0) & 0xff ;
   }
-  
-  void    IoXmegaRtc::SetCntL(uint8_t v)
+
+  void    IoXmegaTc::SetPerL(uint8_t v)
   {
     _tmp = v ;
   }
-  
-  uint8_t IoXmegaRtc::GetCntH() const
+
+  uint8_t IoXmegaTc::GetPerH() const
   {
     return _tmp ;
   }
-  
-  void    IoXmegaRtc::SetCntH(uint8_t v)
+
+  void    IoXmegaTc::SetPerH(uint8_t v)
   {
-    _cnt = ((uint32_t)v << 8) | _tmp ;
-    _ticks = _mcu.Ticks() ;
+    Update() ;
+    _per = ((uint16_t)v << 8) | _tmp ;
+    if (_down && (_cnt > Top()))
+      _down = false ;
+    Schedule() ;
   }
-  
-  uint8_t IoXmegaRtc::GetTemp() const
+
+  uint8_t IoXmegaTc::GetPerBufL() const
+  {
+    _tmp = (_perBuf >> 8) & 0xff ;
+    return (_perBuf >> 0) & 0xff ;
+  }
+
+  void    IoXmegaTc::SetPerBufL(uint8_t v)
+  {
+    _tmp = v ;
+  }
+
+  uint8_t IoXmegaTc::GetPerBufH() const
   {
     return _tmp ;
   }
-  
-  void    IoXmegaRtc::SetTemp(uint8_t v)
+
+  void    IoXmegaTc::SetPerBufH(uint8_t v)
+  {
+    Update() ;
+    _perBuf = ((uint16_t)v << 8) | _tmp ;
+    _ctrlG |= kPerBv ;
+    Schedule() ;
+  }
+
+  uint8_t IoXmegaTc::GetCcL(uint8_t ch) const
+  {
+    Update() ;
+    _tmp = (_cc[ch] >> 8) & 0xff ;
+    return (_cc[ch] >> 0) & 0xff ;
+  }
+
+  void    IoXmegaTc::SetCcL(uint8_t ch, uint8_t v)
   {
     _tmp = v ;
   }
-  
+
+  uint8_t IoXmegaTc::GetCcH(uint8_t ch) const
+  {
+    return _tmp ;
+  }
+
+  void    IoXmegaTc::SetCcH(uint8_t ch, uint8_t v)
+  {
+    Update() ;
+    _cc[ch] = ((uint16_t)v << 8) | _tmp ;
+    if (_down && (_cnt > Top()))
+      _down = false ;
+    Schedule() ;
+  }
+
+  uint8_t IoXmegaTc::GetCcBufL(uint8_t ch) const
+  {
+    _tmp = (_ccBuf[ch] >> 8) & 0xff ;
+    return (_ccBuf[ch] >> 0) & 0xff ;
+  }
+
+  void    IoXmegaTc::SetCcBufL(uint8_t ch, uint8_t v)
+  {
+    _tmp = v ;
+  }
+
+  uint8_t IoXmegaTc::GetCcBufH(uint8_t ch) const
+  {
+    return _tmp ;
+  }
+
+  void    IoXmegaTc::SetCcBufH(uint8_t ch, uint8_t v)
+  {
+    Update() ;
+    _ccBuf[ch] = ((uint16_t)v << 8) | _tmp ;
+    _ctrlG |= kPerBv << (ch + 1) ;
+    Schedule() ;
+  }
+
   ////////////////////////////////////////////////////////////////////////////////
   // IoEeprom
   ////////////////////////////////////////////////////////////////////////////////
   
+  void IoEeprom::Save(Snapshot &snapshot) const
+  {
+    snapshot.Put(_addr)        ; snapshot.Put(_data)           ; snapshot.Put(_control) ;
+    snapshot.Put(_activeTicks) ; snapshot.Put(_writeBusyTicks) ; snapshot.Put(_readBusyTicks) ;
+  }
+
+  void IoEeprom::Load(Snapshot &snapshot)
+  {
+    snapshot.Get(_addr)        ; snapshot.Get(_data)           ; snapshot.Get(_control) ;
+    snapshot.Get(_activeTicks) ; snapshot.Get(_writeBusyTicks) ; snapshot.Get(_readBusyTicks) ;
+  }
+
+  void IoEeprom::Wakeup(uint32_t id)
+  {
+    Irq() ;
+  }
+
+  void IoEeprom::Irq()
+  {
+    _mcu.Irq(_irqVector, (_control & kEERIE) && (_writeBusyTicks < _mcu.Ticks()), this) ;
+  }
+
   void IoEeprom::SetAddr(uint16_t v)
   {
     if (v >= _mcu.EepromSize())
@@ -465,16 +1810,21 @@ namespace AVR
     return _control ;
   }
   
-  void IoEeprom::SetControl(uint8_t v)
+  bool IoEeprom::Polled(uint64_t &until) const
   {
-    v &= _hasEepm ? 0x3f : 0x1f ;
-    
-    if (v & kEERIE)
+    uint64_t ticks = _mcu.Ticks() ;
+    until = UINT64_MAX ;
+    for (uint64_t busy : { _readBusyTicks, _writeBusyTicks, _activeTicks })
     {
-      char buff[80] ;
-      snprintf(buff, sizeof(buff), "EEPROM interrupt not supported\n") ;
-      _mcu.Verbose(VerboseType::Eeprom, buff) ;
+      if ((busy >= ticks) && (busy + 1 < until))
+        until = busy + 1 ;
     }
+    return true ;
+  }
+
+  void IoEeprom::SetControl(uint8_t v)
+  {
+    v &= _hasEepm ? 0x3f : 0x1f ;
     
     if ((_writeBusyTicks < _mcu.Ticks()) && (_readBusyTicks < _mcu.Ticks()))
     {
@@ -502,6 +1852,7 @@ namespace AVR
             _writeBusyTicks = _mcu.Ticks() + 18 ; // dummy - 1.8ms in real
             break ;
           }
+          _mcu.Schedule((uint64_t)_writeBusyTicks + 1, this) ; // EE_READY
         }
         break ;
       case kEERE:
@@ -519,6 +1870,7 @@ namespace AVR
     }
     
     _control = v ;
+    Irq() ;
   }
   
   ////////////////////////////////////////////////////////////////////////////////
@@ -536,19 +1888,448 @@ namespace AVR
 
   uint8_t IoUsart::Rx() const
   {
-    if (_rxPos < _rx.size())
-      return (unsigned char) _rx[_rxPos++] ;
+    if (!RxAvail())
+      return 0 ;
 
-    _rx.clear() ;
-    _rxPos = 0 ;
-    return 0 ;
+    uint8_t c = _rx.Get() ;
+    _rx.Fill(false) ;
+    if (_paced)
+      _rxReady = std::max(_rxReady, _mcu.Ticks()) + FrameTicks() ;
+    RxSchedule() ;
+    Irq() ;
+    return c ;
+  }
+  bool IoUsart::RxAvail() const
+  {
+    return !_rx.Empty() && (!_paced || (_mcu.Ticks() >= _rxReady)) ;
+  }
+  void IoUsart::RxSchedule() const
+  {
+    IoUsart *port = const_cast<IoUsart*>(this) ;
+    if (_paced && !_rx.Empty() && (_rxReady > _mcu.Ticks()))
+      _mcu.Schedule(_rxReady, port, kEventRxReady) ;
   }
   void IoUsart::Tx(uint8_t c) const
   {
+    _tx.Put(c) ;
+    _txc = true ;
+    Irq() ;
   }
   void IoUsart::Add(const std::vector<uint8_t> &data)
   {
-    _rx.insert(std::end(_rx), std::begin(data), std::end(data));
+    _rx.Add(data) ;
+    RxSchedule() ;
+    Irq() ;
+  }
+  bool IoUsart::OpenPty(std::string &name)
+  {
+    if (!_pty.Open())
+      return false ;
+    _rx.Attach(_pty.Master(), false) ;
+    _tx.Attach(_pty.Master(), false) ;
+    _mcu.Schedule(_mcu.Ticks() + Source::kPollTicks, this, kEventPoll) ;
+    name = _pty.Name() ;
+    return true ;
+  }
+  bool IoUsart::Input(const std::string &source, bool paced)
+  {
+    if (!_rx.Open(source))
+      return false ;
+    _paced = paced ;
+    if (_rx.Polling())
+      _mcu.Schedule(_mcu.Ticks() + Source::kPollTicks, this, kEventPoll) ;
+    RxSchedule() ;
+    Irq() ;
+    return true ;
+  }
+
+  void IoUsart::Save(Snapshot &snapshot) const
+  {
+    _rx.Save(snapshot) ; snapshot.Put(_rxReady) ; snapshot.Put(_control) ; snapshot.Put(_txc) ;
+    snapshot.Put(_u2x) ; snapshot.Put(_ucsrC) ; snapshot.Put(_ubrrL) ; snapshot.Put(_ubrrH) ;
+  }
+
+  void IoUsart::Load(Snapshot &snapshot)
+  {
+    _rx.Load(snapshot) ; snapshot.Get(_rxReady) ; snapshot.Get(_control) ; snapshot.Get(_txc) ;
+    snapshot.Get(_u2x) ; snapshot.Get(_ucsrC) ; snapshot.Get(_ubrrL) ; snapshot.Get(_ubrrH) ;
+  }
+
+  void IoUsart::Wakeup(uint32_t id)
+  {
+    if (id == kEventPoll)
+    {
+      _tx.Flush() ;
+      _rx.Fill(true) ;
+      if (_rx.Polling())
+        _mcu.Schedule(_mcu.Ticks() + Source::kPollTicks, this, kEventPoll) ;
+      RxSchedule() ;
+    }
+    Irq() ;
+  }
+
+  void IoUsart::Acknowledge(uint32_t vector)
+  {
+    if (vector == _irqVector + 2) // TXC cleared by hardware
+    {
+      _txc = false ;
+      Irq() ;
+    }
+  }
+
+  uint8_t IoUsart::GetStatus() const
+  {
+    return (RxAvail() ? 0x80 : 0x00) | (_txc ? kTXC : 0x00) | 0x20 | _u2x ; // data register always empty
+  }
+
+  void IoUsart::SetStatus(uint8_t v)
+  {
+    _u2x = v & kU2X ;
+    if (v & kTXC)
+    {
+      _txc = false ;
+      Irq() ;
+    }
+  }
+
+  void IoUsart::SetControl(uint8_t v)
+  {
+    _control = v ;
+    Irq() ;
+  }
+
+  uint64_t IoUsart::FrameTicks() const
+  {
+    uint32_t ubrr = ((_ubrrH & 0x0f) << 8) | _ubrrL ;
+    uint64_t bit  = (_u2x ? 8 : 16) * (ubrr + 1) ;
+    uint32_t bits = 1 + 5 + ((_ucsrC >> 1) & 0x03) + ((_control & 0x04) ? 1 : 0) + ((_ucsrC & 0x20) ? 1 : 0) + ((_ucsrC & 0x08) ? 2 : 1) ;
+    return bit * bits ;
+  }
+
+  void IoUsart::Irq() const
+  {
+    IoUsart *port = const_cast<IoUsart*>(this) ;
+
+    _mcu.Irq(_irqVector + 0, (_control & kRXCIE) && RxAvail(), port) ;
+    _mcu.Irq(_irqVector + 1, (_control & kUDRIE) != 0        , port) ; // data register always empty
+    _mcu.Irq(_irqVector + 2, (_control & kTXCIE) && _txc     , port) ;
+  }
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // IoTimer8 (tiny, mega)
+  ////////////////////////////////////////////////////////////////////////////////
+
+  IoTimer8::IoTimer8(Mcu &mcu, uint32_t ovfVector, uint8_t tov, uint32_t compAVector, uint8_t ocfA, uint32_t compBVector, uint8_t ocfB)
+    : _mcu(mcu), _ovfVector(ovfVector), _compAVector(compAVector), _compBVector(compBVector), _tov(tov), _ocfA(ocfA), _ocfB(ocfB),
+      _ticks(0), _cnt(0), _down(false), _ctrlA(0), _ctrlB(0), _ocrA(0), _ocrB(0), _intMask(0), _intFlags(0)
+  {
+  }
+
+  void IoTimer8::Save(Snapshot &snapshot) const
+  {
+    snapshot.Put(_ticks) ; snapshot.Put(_cnt)  ; snapshot.Put(_down)    ;
+    snapshot.Put(_ctrlA) ; snapshot.Put(_ctrlB) ; snapshot.Put(_ocrA)   ; snapshot.Put(_ocrB) ;
+    snapshot.Put(_intMask) ; snapshot.Put(_intFlags) ;
+  }
+
+  void IoTimer8::Load(Snapshot &snapshot)
+  {
+    snapshot.Get(_ticks) ; snapshot.Get(_cnt)  ; snapshot.Get(_down)    ;
+    snapshot.Get(_ctrlA) ; snapshot.Get(_ctrlB) ; snapshot.Get(_ocrA)   ; snapshot.Get(_ocrB) ;
+    snapshot.Get(_intMask) ; snapshot.Get(_intFlags) ;
+  }
+
+  void IoTimer8::Wakeup(uint32_t id)
+  {
+    Update() ;
+    Irq() ;
+    Schedule() ;
+  }
+
+  void IoTimer8::Acknowledge(uint32_t vector)
+  {
+    Update() ;
+    if (vector == _ovfVector)
+      _intFlags &= ~_tov ;
+    else if (vector == _compAVector)
+      _intFlags &= ~_ocfA ;
+    else if (vector == _compBVector)
+      _intFlags &= ~_ocfB ;
+    Irq() ;
+    Schedule() ;
+  }
+
+  uint32_t IoTimer8::Div() const
+  {
+    switch (_ctrlB & 0x07)
+    {
+    default: return    0 ; // stopped, external clock on T0 not supported
+    case 1:  return    1 ;
+    case 2:  return    8 ;
+    case 3:  return   64 ;
+    case 4:  return  256 ;
+    case 5:  return 1024 ;
+    }
+  }
+
+  uint8_t IoTimer8::Wgm() const
+  {
+    return (_ctrlA & 0x03) | ((_ctrlB & 0x08) >> 1) ;
+  }
+
+  uint32_t IoTimer8::Top() const
+  {
+    uint8_t wgm = Wgm() ;
+    return ((wgm == 2) || (wgm == 5) || (wgm == 7)) ? _ocrA : 0xff ; // CTC, PWM with TOP = OCR0A
+  }
+
+  bool IoTimer8::DualSlope() const
+  {
+    uint8_t wgm = Wgm() ;
+    return (wgm == 1) || (wgm == 5) ;
+  }
+
+  uint32_t IoTimer8::Period() const
+  {
+    uint32_t top = Top() ;
+    return DualSlope() ? std::max(2 * top, 1u) : top + 1 ;
+  }
+
+  // positions in a period: up 0..TOP, phase correct down TOP-1..1 as 2*TOP-TCNT
+  // TCNT above TOP (written) counts up to MAX and wraps to BOTTOM first
+  uint32_t IoTimer8::Counts(uint8_t flag) const
+  {
+    uint32_t top    = Top() ;
+    uint32_t period = Period() ;
+    uint32_t pre    = 0 ;
+    uint32_t pos ;
+
+    if (_cnt > top)
+    {
+      pre = 0xff - _cnt ;
+      pos = period - 1 ;
+    }
+    else
+      pos = _down ? period - _cnt : _cnt ;
+
+    uint32_t target[2] ;
+    if (flag == _tov)
+    {
+      if ((Wgm() == 2) && (top != 0xff) && (_cnt <= top)) // CTC: at MAX only
+        return 0 ;
+      target[0] = target[1] = 0 ; // TOP -> BOTTOM, phase correct at BOTTOM
+    }
+    else
+    {
+      uint32_t ocr = (flag == _ocfA) ? _ocrA : _ocrB ;
+      if (ocr > top)
+        return 0 ;
+      target[0] = ocr ;
+      target[1] = DualSlope() ? (period - ocr) % period : ocr ; // phase correct counting down
+    }
+
+    uint32_t n = std::min((target[0] + period - pos - 1) % period + 1,
+                          (target[1] + period - pos - 1) % period + 1) ;
+    return pre + n ;
+  }
+
+  void IoTimer8::Count(uint64_t n) const
+  {
+    for (uint8_t flag : { _tov, _ocfA, _ocfB })
+    {
+      if (!flag)
+        continue ;
+      uint32_t counts = Counts(flag) ;
+      if (counts && (n >= counts))
+        _intFlags |= flag ;
+    }
+
+    uint32_t top    = Top() ;
+    uint32_t period = Period() ;
+    uint32_t pos ;
+    if (_cnt > top)
+    {
+      if (n <= (uint32_t)(0xff - _cnt))
+      {
+        _cnt += n ;
+        return ;
+      }
+      n  -= 0x100 - _cnt ;
+      pos = 0 ;
+    }
+    else
+      pos = _down ? period - _cnt : _cnt ;
+
+    pos   = (pos + n) % period ;
+    _down = pos > top ;
+    _cnt  = _down ? period - pos : pos ;
+  }
+
+  void IoTimer8::Update() const
+  {
+    uint64_t ticks = _mcu.Ticks() ;
+    uint32_t div   = Div() ;
+
+    if (div)
+    {
+      uint64_t n = ticks / div - _ticks / div ; // prescaler runs continuously
+      if (n)
+        Count(n) ;
+    }
+    _ticks = ticks ;
+  }
+
+  uint64_t IoTimer8::Ticks(uint64_t counts) const
+  {
+    uint32_t div = Div() ;
+    return (_ticks / div + counts) * div ;
+  }
+
+  void IoTimer8::Schedule()
+  {
+    uint32_t n = 0 ; // counts to next interrupt
+
+    if (Div())
+    {
+      for (uint8_t flag : { _tov, _ocfA, _ocfB })
+      {
+        if (!flag || !(_intMask & flag) || (_intFlags & flag))
+          continue ;
+        uint32_t counts = Counts(flag) ;
+        if (counts && (!n || (counts < n)))
+          n = counts ;
+      }
+    }
+
+    if (!n)
+    {
+      _mcu.Unschedule(this) ;
+      return ;
+    }
+
+    _mcu.Schedule(Ticks(n), this) ;
+  }
+
+  bool IoTimer8::Polled(uint64_t &until, bool cnt) const
+  {
+    Update() ;
+    until = UINT64_MAX ;
+    if (!Div())
+      return true ;
+
+    uint32_t n = cnt ? 1 : 0 ; // counts to next change
+    for (uint8_t flag : { _tov, _ocfA, _ocfB })
+    {
+      if (cnt || !flag || (_intFlags & flag))
+        continue ;
+      uint32_t counts = Counts(flag) ;
+      if (counts && (!n || (counts < n)))
+        n = counts ;
+    }
+    if (n)
+      until = Ticks(n) ;
+    return true ;
+  }
+
+  void IoTimer8::Irq()
+  {
+    if (_tov)
+      _mcu.Irq(_ovfVector  , _intMask & _intFlags & _tov , this) ;
+    if (_ocfA)
+      _mcu.Irq(_compAVector, _intMask & _intFlags & _ocfA, this) ;
+    if (_ocfB)
+      _mcu.Irq(_compBVector, _intMask & _intFlags & _ocfB, this) ;
+  }
+
+  uint8_t IoTimer8::GetCtrlA() const
+  {
+    return _ctrlA ;
+  }
+
+  void    IoTimer8::SetCtrlA(uint8_t v)
+  {
+    Update() ;
+    _ctrlA = v & 0xf3 ; // output compare pins not supported
+    Schedule() ;
+  }
+
+  uint8_t IoTimer8::GetCtrlB() const
+  {
+    return _ctrlB ;
+  }
+
+  void    IoTimer8::SetCtrlB(uint8_t v)
+  {
+    Update() ;
+    _ctrlB = v & (_ocfA ? 0x0f : 0x07) ; // FOC0x strobes read as zero
+    Schedule() ;
+  }
+
+  uint8_t IoTimer8::GetCnt() const
+  {
+    Update() ;
+    return _cnt ;
+  }
+
+  void    IoTimer8::SetCnt(uint8_t v)
+  {
+    Update() ;
+    _cnt  = v ;
+    _down = false ;
+    Schedule() ;
+  }
+
+  uint8_t IoTimer8::GetOcrA() const
+  {
+    return _ocrA ;
+  }
+
+  void    IoTimer8::SetOcrA(uint8_t v)
+  {
+    Update() ;
+    _ocrA = v ; // not double buffered in PWM modes
+    if (_down && (_cnt > Top()))
+      _down = false ;
+    Schedule() ;
+  }
+
+  uint8_t IoTimer8::GetOcrB() const
+  {
+    return _ocrB ;
+  }
+
+  void    IoTimer8::SetOcrB(uint8_t v)
+  {
+    Update() ;
+    _ocrB = v ;
+    Schedule() ;
+  }
+
+  uint8_t IoTimer8::GetIntMask() const
+  {
+    return _intMask ;
+  }
+
+  void    IoTimer8::SetIntMask(uint8_t v)
+  {
+    Update() ;
+    _intMask = v ;
+    Irq() ;
+    Schedule() ;
+  }
+
+  uint8_t IoTimer8::GetIntFlags() const
+  {
+    Update() ;
+    return _intFlags ;
+  }
+
+  void    IoTimer8::SetIntFlags(uint8_t v)
+  {
+    Update() ;
+    _intFlags &= ~v ;
+    Irq() ;
+    Schedule() ;
   }
   
 }
@@ -4,10 +4,16 @@
 
 #pragma once
 
+#include <stdio.h>
+#include <string.h>
+
 #include <string>
 #include <vector>
 #include <map>
 #include <set>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace AVR
 {
@@ -15,6 +21,219 @@ namespace AVR
   
   using Command = unsigned short ; // 16 bit instruction
 
+  ////////////////////////////////////////////////////////////////////////////////
+  // Snapshot
+  // binary MCU state, native byte order
+  ////////////////////////////////////////////////////////////////////////////////
+
+  class Snapshot
+  {
+  public:
+    Snapshot() : _pos(0), _ok(true) {}
+
+    bool Read(const std::string &filename) ;
+    bool Write(const std::string &filename) const ;
+    bool Ok() const  { return _ok ; }
+    bool End() const { return _pos == _data.size() ; }
+
+    template<typename T> void Put(const T &v)
+    {
+      const uint8_t *ptr = (const uint8_t*)&v ;
+      _data.insert(_data.end(), ptr, ptr + sizeof(T)) ;
+    }
+    template<typename T> void Get(T &v)
+    {
+      if (!_ok || (_pos + sizeof(T) > _data.size()))
+      {
+        _ok = false ;
+        return ;
+      }
+      memcpy(&v, &_data[_pos], sizeof(T)) ;
+      _pos += sizeof(T) ;
+    }
+    template<typename T> void Put(const std::vector<T> &v) // T: plain data
+    {
+      Put((uint32_t)v.size()) ;
+      const uint8_t *ptr = (const uint8_t*)v.data() ;
+      _data.insert(_data.end(), ptr, ptr + v.size() * sizeof(T)) ;
+    }
+    template<typename T> void Get(std::vector<T> &v)
+    {
+      uint32_t size = 0 ;
+      Get(size) ;
+      if (!_ok || (size > (_data.size() - _pos) / sizeof(T)))
+      {
+        _ok = false ;
+        return ;
+      }
+      v.resize(size) ;
+      if (size)
+        memcpy(v.data(), &_data[_pos], size * sizeof(T)) ;
+      _pos += size * sizeof(T) ;
+    }
+    void Put(const std::string &s) ;
+    void Get(std::string &s) ;
+
+  private:
+    std::vector<uint8_t> _data ;
+    size_t _pos ;
+    bool   _ok ;
+  } ;
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Sink
+  // buffered output of a USART, written to a file descriptor in batches
+  // a non-blocking fd that is not read keeps at most 4*kSize bytes, older
+  // output is dropped and reported on stderr
+  ////////////////////////////////////////////////////////////////////////////////
+
+  class Sink
+  {
+  public:
+    Sink() : _fd(-1), _close(false), _dropped(0) {}
+    ~Sink() { Close() ; }
+    Sink(const Sink&) = delete ;
+    Sink& operator=(const Sink&) = delete ;
+
+    bool Open(const std::string &target) ; // file name, "-" stdout, "fd:<n>"
+    void Attach(int fd, bool close) ;      // close: fd owned by the sink
+    void Close() ;
+    bool Active() const { return _fd >= 0 ; }
+    void Put(uint8_t c)
+    {
+      if (_fd < 0)
+        return ;
+      _buff.push_back(c) ;
+      if (_buff.size() >= kSize)
+        Flush() ;
+    }
+    void Flush() ;
+
+  private:
+    static const size_t kSize = 0x10000 ;
+
+    int      _fd ;
+    bool     _close ;
+    uint64_t _dropped ; // oldest bytes discarded while the fd was not read, reported on stderr
+    std::vector<uint8_t> _buff ;
+  } ;
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Writer
+  // double buffered output file, a full buffer is written by a background thread
+  // while the other one is filled
+  ////////////////////////////////////////////////////////////////////////////////
+
+  class Writer
+  {
+  public:
+    Writer() : _fd(-1), _busy(false), _done(false), _ok(true) {}
+    ~Writer() { Close() ; }
+    Writer(const Writer&) = delete ;
+    Writer& operator=(const Writer&) = delete ;
+
+    bool Open(const std::string &filename) ;
+    bool Close() ; // false if any write failed
+    bool IsOpen() const { return _fd >= 0 ; }
+    void Put(uint8_t c)
+    {
+      _fill.push_back(c) ;
+      if (_fill.size() >= kSize)
+        Swap() ;
+    }
+    void Put(const std::string &s) { Varint(s.size()) ; for (char c : s) Put((uint8_t)c) ; }
+    void Varint(uint64_t v) // LEB128
+    {
+      for ( ; v >= 0x80 ; v >>= 7)
+        Put((uint8_t)(v | 0x80)) ;
+      Put((uint8_t)v) ;
+    }
+
+  private:
+    static const size_t kSize = 0x100000 ;
+
+    void Swap() ; // hand _fill to the thread, waits while the previous buffer is written
+    void Run() ;  // thread
+
+    int  _fd ;
+    std::vector<uint8_t> _fill ;
+    std::vector<uint8_t> _flush ;
+    std::thread             _thread ;
+    std::mutex              _mutex ;
+    std::condition_variable _cond ;
+    bool _busy ; // _flush to be written
+    bool _done ;
+    bool _ok ;
+  } ;
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Source
+  // input of a USART, a fixed ring buffer topped up from queued data, an mmap'ed
+  // file or a file descriptor; the stream is only read while the ring has room
+  ////////////////////////////////////////////////////////////////////////////////
+
+  class Source
+  {
+  public:
+    static const uint64_t kPollTicks = 0x4000 ; // interval of Fill(true) while Polling()
+
+    Source() : _head(0), _tail(0), _queuePos(0), _fd(-1), _close(false), _map(nullptr), _mapSize(0), _mapPos(0) {}
+    ~Source() { Close() ; }
+    Source(const Source&) = delete ;
+    Source& operator=(const Source&) = delete ;
+
+    bool Open(const std::string &source) ; // file name (mmap'ed if regular), "-" stdin, "fd:<n>"
+    void Attach(int fd, bool close) ;      // close: fd owned by the source
+    void Close() ;                         // end of stream, buffered data is kept
+    bool Polling() const { return _fd >= 0 ; } // data arrives asynchronously, see Fill()
+    void Add(const std::vector<uint8_t> &data) ; // queued, e.g. debugger input
+
+    bool    Empty() const { return _head == _tail ; }
+    uint8_t Get() { return _ring[_head++ & (kSize - 1)] ; } // !Empty()
+    void    Fill(bool read) ; // top up the ring, read: poll the file descriptor too
+
+    void Save(Snapshot &snapshot) const ; // buffered data, the stream is not part of the state
+    void Load(Snapshot &snapshot) ;
+
+  private:
+    static const uint32_t kSize = 0x1000 ; // power of 2
+
+    uint8_t  _ring[kSize] ;
+    uint32_t _head ; // free running, index & (kSize - 1)
+    uint32_t _tail ;
+    std::vector<uint8_t> _queue ;
+    size_t   _queuePos ;
+    int      _fd ;
+    bool     _close ;
+    const uint8_t *_map ;
+    size_t   _mapSize ;
+    size_t   _mapPos ;
+  } ;
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // Pty
+  // pseudo terminal of a USART, the raw non-blocking master feeds Source and Sink
+  ////////////////////////////////////////////////////////////////////////////////
+
+  class Pty
+  {
+  public:
+    Pty() : _master(-1), _slave(-1) {}
+    ~Pty() { Close() ; }
+    Pty(const Pty&) = delete ;
+    Pty& operator=(const Pty&) = delete ;
+
+    bool Open() ;
+    void Close() ;
+    int  Master() const { return _master ; }
+    const std::string& Name() const { return _name ; } // slave device, e.g. /dev/pts/3
+
+  private:
+    int _master ;
+    int _slave ; // held open, output is buffered until a client connects and no hangup when it leaves
+    std::string _name ;
+  } ;
+
   ////////////////////////////////////////////////////////////////////////////////
   // Io
   ////////////////////////////////////////////////////////////////////////////////
@@ -22,6 +241,14 @@ namespace AVR
   class Io
   {
   public:
+    virtual ~Io() {}
+    virtual void Save(Snapshot &snapshot) const { ; } // peripheral state
+    virtual void Load(Snapshot &snapshot)       { ; }
+    virtual void Wakeup(uint32_t id) { ; } // scheduled event, see Mcu::Schedule()
+    virtual void Acknowledge(uint32_t vector) { ; } // interrupt taken, see Mcu::Irq()
+    virtual bool Awake(uint8_t sleepMode) const { return !sleepMode ; } // interrupts wake the MCU from sleep mode, 0: idle
+    virtual void Flush() { ; } // write buffered output, see Mcu::Run()
+
     class Register
     {
     public:
@@ -33,10 +260,19 @@ namespace AVR
       virtual void     Set(uint8_t v) = 0 ;
       virtual uint8_t  Init() const { return 0x00 ; } // bootup value
       virtual void     Add(const std::vector<uint8_t> &data) { ; }
+      virtual Sink*    Output() { return nullptr ; } // transmitted bytes, USART data registers only
+      virtual bool     Input(const std::string &source, bool paced) { return false ; } // stream received bytes, see Source::Open()
+      virtual bool     OpenPty(std::string &name) { return false ; } // connect input and output to a new pseudo terminal
+      virtual void     Save(Snapshot &snapshot) const { ; } // state held by the register itself
+      virtual void     Load(Snapshot &snapshot)       { ; }
+      // Get() has no side effect but the register's own time keeping and the value does not
+      // change before until (ticks) unless written or by a scheduled event, see Mcu::IdleLoop()
+      virtual bool     Polled(uint64_t &until) const { return false ; }
       
     protected:
-      uint8_t VG(uint8_t v) const ;
-      uint8_t VS(uint8_t v) const ;
+      inline uint8_t VG(uint8_t v) const ; // defined in avr.h, format only if someone listens
+      inline uint8_t VS(uint8_t v) const ;
+      void VerboseIo(const char *access, uint8_t v) const ;
 
       const Mcu &_mcu ;
       std::string _name ;
@@ -57,6 +293,7 @@ namespace AVR
     
     virtual uint8_t  Get() const    { return VG(_value) ; }
     virtual void     Set(uint8_t v) { _value = VS(v)    ; }
+    virtual bool     Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
   private:
     uint8_t &_value ;
   } ;
@@ -72,6 +309,9 @@ namespace AVR
 
     virtual uint8_t  Get() const    { return VG(_value) ; }
     virtual void     Set(uint8_t v) { _value = VS(v)    ; }
+    virtual void     Save(Snapshot &snapshot) const { snapshot.Put(_value) ; }
+    virtual void     Load(Snapshot &snapshot)       { snapshot.Get(_value) ; }
+    virtual bool     Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
   private:
     uint8_t       _value ;
   } ;
@@ -90,6 +330,9 @@ namespace AVR
       virtual uint8_t Get() const  ;
       virtual void    Set(uint8_t v) ;
       virtual void    Add(const std::vector<uint8_t> &data) { _port.Add(data) ; }
+      virtual Sink*   Output() { return &_port.Output() ; }
+      virtual bool    Input(const std::string &source, bool paced) { return _port.Input(source, paced) ; }
+      virtual bool    OpenPty(std::string &name) { return _port.OpenPty(name) ; }
       
     private:
       IoXmegaUsart &_port ;
@@ -100,6 +343,7 @@ namespace AVR
       Status(const Mcu &mcu, IoXmegaUsart &port) : Register(mcu, port.Name() + "_STATUS"), _port(port) {}
       virtual uint8_t Get() const    { return VG(_port.GetStatus()) ; }
       virtual void    Set(uint8_t v) { _port.SetStatus(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
     private:
       IoXmegaUsart &_port ;
     } ;
@@ -109,6 +353,7 @@ namespace AVR
       CtrlA(const Mcu &mcu, IoXmegaUsart &port) : Register(mcu, port.Name() + "_CTRLA"), _port(port) {}
       virtual uint8_t Get() const    { return VG(_port.GetCtrlA()) ; }
       virtual void    Set(uint8_t v) { _port.SetCtrlA(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
     private:
       IoXmegaUsart &_port ;
     } ;
@@ -118,6 +363,7 @@ namespace AVR
       CtrlB(const Mcu &mcu, IoXmegaUsart &port) : Register(mcu, port.Name() + "_CTRLB"), _port(port) {}
       virtual uint8_t Get() const    { return VG(_port.GetCtrlB()) ; }
       virtual void    Set(uint8_t v) { _port.SetCtrlB(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
     private:
       IoXmegaUsart &_port ;
     } ;
@@ -127,6 +373,7 @@ namespace AVR
       CtrlC(const Mcu &mcu, IoXmegaUsart &port) : Register(mcu, port.Name() + "_CTRLC"), _port(port) {}
       virtual uint8_t Get() const    { return VG(_port.GetCtrlC()) ; }
       virtual void    Set(uint8_t v) { _port.SetCtrlC(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
     private:
       IoXmegaUsart &_port ;
     } ;
@@ -136,6 +383,7 @@ namespace AVR
       BaudCtrlA(const Mcu &mcu, IoXmegaUsart &port) : Register(mcu, port.Name() + "_BAUDCTRLA"), _port(port) {}
       virtual uint8_t Get() const    { return VG(_port.GetBaudCtrlA()) ; }
       virtual void    Set(uint8_t v) { _port.SetBaudCtrlA(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
     private:
       IoXmegaUsart &_port ;
     } ;
@@ -145,16 +393,25 @@ namespace AVR
       BaudCtrlB(const Mcu &mcu, IoXmegaUsart &port) : Register(mcu, port.Name() + "_BAUDCTRLB"), _port(port) {}
       virtual uint8_t Get() const    { return VG(_port.GetBaudCtrlB()) ; }
       virtual void    Set(uint8_t v) { _port.SetBaudCtrlB(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
     private:
       IoXmegaUsart &_port ;
     } ;
     
-    IoXmegaUsart(const std::string &name) : _name(name), _rxPos(0) {}
+    IoXmegaUsart(Mcu &mcu, const std::string &name, uint32_t irqVector) : _mcu(mcu), _name(name), _irqVector(irqVector), _paced(false), _rxReady(0), _txc(false) {}
     const std::string& Name() { return _name ; }
     virtual uint8_t    Rx() const ;
-    virtual bool       RxAvail() const { return _rxPos < _rx.size() ; }
+    virtual bool       RxAvail() const ;
     virtual void       Tx(uint8_t v) const ;
     virtual void       Add(const std::vector<uint8_t> &data) ;
+    bool               Input(const std::string &source, bool paced) ;
+    bool               OpenPty(std::string &name) ;
+    Sink&              Output() { return _tx ; }
+    virtual void       Flush() { _tx.Flush() ; }
+    virtual void       Save(Snapshot &snapshot) const ;
+    virtual void       Load(Snapshot &snapshot) ;
+    virtual void       Wakeup(uint32_t id) ;
+    virtual void       Acknowledge(uint32_t vector) ;
 
     uint8_t GetStatus() const ;
     void    SetStatus(uint8_t v) ;
@@ -170,9 +427,22 @@ namespace AVR
     void    SetBaudCtrlB(uint8_t v) ;
     
   private:
+    static const uint32_t kEventPoll    = 0 ; // read the input stream, write buffered output
+    static const uint32_t kEventRxReady = 1 ; // paced input, next byte received
+
+    void     Irq() const ; // request RXC, DRE, TXC interrupts
+    void     RxSchedule() const ;
+    uint64_t FrameTicks() const ; // one character at the configured baud rate
+
+    Mcu        &_mcu ;
     std::string _name ;
-    mutable std::vector<uint8_t> _rx ;
-    mutable uint32_t _rxPos ;
+    uint32_t    _irqVector ; // RXC, DRE = +1, TXC = +2
+    Pty              _pty ; // before _rx / _tx, closed after them
+    mutable Source   _rx ;
+    bool             _paced ;
+    mutable uint64_t _rxReady ; // ticks, paced input
+    mutable Sink     _tx ;
+    mutable bool     _txc ;
 
     uint8_t _ctrlA     = 0x00 ;
     uint8_t _ctrlB     = 0x00 ;
@@ -181,6 +451,67 @@ namespace AVR
     uint8_t _baudCtrlB = 0x00 ;
   } ;
 
+  ////////////////////////////////////////////////////////////////////////////////
+  // IoXmegaPmic
+  ////////////////////////////////////////////////////////////////////////////////
+
+  class IoXmegaPmic : public Io
+  {
+  public:
+    class Status : public Io::Register
+    {
+    public:
+      Status(const Mcu &mcu, IoXmegaPmic &pmic) : Register(mcu, "PMIC_STATUS"), _pmic(pmic) {}
+      virtual uint8_t Get() const    { return VG(_pmic.GetStatus()) ; }
+      virtual void    Set(uint8_t v) { VS(v) ; } // read only
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+
+    private:
+      IoXmegaPmic &_pmic ;
+    } ;
+    class IntPri : public Io::Register
+    {
+    public:
+      IntPri(const Mcu &mcu, IoXmegaPmic &pmic) : Register(mcu, "PMIC_INTPRI"), _pmic(pmic) {}
+      virtual uint8_t Get() const    { return VG(_pmic.GetIntPri()) ; }
+      virtual void    Set(uint8_t v) { _pmic.SetIntPri(VS(v))       ; }
+
+    private:
+      IoXmegaPmic &_pmic ;
+    } ;
+    class Ctrl : public Io::Register
+    {
+    public:
+      Ctrl(const Mcu &mcu, IoXmegaPmic &pmic) : Register(mcu, "PMIC_CTRL"), _pmic(pmic) {}
+      virtual uint8_t Get() const    { return VG(_pmic.GetCtrl()) ; }
+      virtual void    Set(uint8_t v) { _pmic.SetCtrl(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+
+    private:
+      IoXmegaPmic &_pmic ;
+    } ;
+
+    IoXmegaPmic(Mcu &mcu) : _mcu(mcu), _status(0), _intPri(0), _ctrl(0) {}
+    virtual void Save(Snapshot &snapshot) const ;
+    virtual void Load(Snapshot &snapshot) ;
+
+    uint8_t GetStatus() const { return _status ; }
+    uint8_t GetIntPri() const { return _intPri ; }
+    void    SetIntPri(uint8_t v) ;
+    uint8_t GetCtrl() const   { return _ctrl   ; }
+    void    SetCtrl(uint8_t v) ;
+
+    bool Enabled(uint8_t level) const ; // level enabled and above the executing levels
+    void Enter(uint8_t level) ;         // interrupt of level taken
+    void Return() ;                     // RETI, leave the highest executing level
+
+  private:
+    Mcu     &_mcu ;
+    uint8_t  _status ;
+    uint8_t  _intPri ;
+    uint8_t  _ctrl ;
+  } ;
+
   ////////////////////////////////////////////////////////////////////////////////
   // IoXmegaCpu
   ////////////////////////////////////////////////////////////////////////////////
@@ -194,15 +525,19 @@ namespace AVR
       Ccp(const Mcu &mcu, IoXmegaCpu &cpu) : Register(mcu, "CPU_CCP"), _cpu(cpu) {}
       virtual uint8_t Get() const    { return VG(_cpu.GetCcp()) ; }
       virtual void    Set(uint8_t v) { _cpu.SetCcp(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { return _cpu.Polled(until) ; }
 
     private:
       IoXmegaCpu &_cpu ;
     } ;
 
     IoXmegaCpu(Mcu &mcu) ;
+    virtual void Save(Snapshot &snapshot) const ;
+    virtual void Load(Snapshot &snapshot) ;
 
     uint8_t GetCcp() const ;
     void SetCcp(uint8_t v) ;
+    bool Polled(uint64_t &until) const ; // CCP expires
     
   private:
     Mcu     &_mcu ;
@@ -222,12 +557,15 @@ namespace AVR
       RtcCtrl(const Mcu &mcu, IoXmegaClk &clk) : Register(mcu, "CLK_RTCCTRL"), _clk(clk) {}
       virtual uint8_t Get() const    { return VG(_clk.GetRtcCtrl()) ; }
       virtual void    Set(uint8_t v) { _clk.SetRtcCtrl(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
 
     private:
       IoXmegaClk &_clk ;
     } ;
 
     IoXmegaClk() ;
+    virtual void Save(Snapshot &snapshot) const ;
+    virtual void Load(Snapshot &snapshot) ;
 
     uint8_t GetRtcCtrl() const ;
     void SetRtcCtrl(uint8_t v) ;
@@ -363,6 +701,7 @@ namespace AVR
       Status(const Mcu &mcu, IoXmegaNvm &nvm) : Register(mcu, "NVM_STATUS"), _nvm(nvm) {}
       virtual uint8_t Get() const    { return VG(_nvm.GetStatus()) ; }
       virtual void    Set(uint8_t v) { _nvm.SetStatus(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
 
     private:
       IoXmegaNvm &_nvm ;
@@ -386,7 +725,9 @@ namespace AVR
       ProductionSignature,
     } ;
     
-    IoXmegaNvm(Mcu &mcu, IoXmegaCpu &cpu) ;
+    IoXmegaNvm(Mcu &mcu, IoXmegaCpu &cpu, uint32_t irqVector) ;
+    virtual void Save(Snapshot &snapshot) const ;
+    virtual void Load(Snapshot &snapshot) ;
 
     uint8_t  GetAddr0() ;
     void     SetAddr0(uint8_t v) ;
@@ -425,6 +766,7 @@ namespace AVR
   private:
     Mcu        &_mcu ;
     IoXmegaCpu &_cpu ;
+    uint32_t    _irqVector ; // EE, SPM = +1
     
     uint32_t _addr ;
     uint32_t _data ;
@@ -449,6 +791,7 @@ namespace AVR
       Ctrl(const Mcu &mcu, IoXmegaRtc &rtc) : Register(mcu, "RTC_CTRL"), _rtc(rtc) {}
       virtual uint8_t Get() const    { return VG(_rtc.GetPrescaler()) ; }
       virtual void    Set(uint8_t v) { _rtc.SetPrescaler(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
 
     private:
       IoXmegaRtc &_rtc ;
@@ -459,6 +802,30 @@ namespace AVR
       Status(const Mcu &mcu, IoXmegaRtc &rtc) : Register(mcu, "RTC_STATUS"), _rtc(rtc) {}
       virtual uint8_t Get() const    { return VG(_rtc.GetStatus()) ; }
       virtual void    Set(uint8_t v) { _rtc.SetStatus(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+
+    private:
+      IoXmegaRtc &_rtc ;
+    } ;
+
+    class IntCtrl : public Io::Register
+    {
+    public:
+      IntCtrl(const Mcu &mcu, IoXmegaRtc &rtc) : Register(mcu, "RTC_INTCTRL"), _rtc(rtc) {}
+      virtual uint8_t Get() const    { return VG(_rtc.GetIntCtrl()) ; }
+      virtual void    Set(uint8_t v) { _rtc.SetIntCtrl(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+
+    private:
+      IoXmegaRtc &_rtc ;
+    } ;
+    class IntFlags : public Io::Register
+    {
+    public:
+      IntFlags(const Mcu &mcu, IoXmegaRtc &rtc) : Register(mcu, "RTC_INTFLAGS"), _rtc(rtc) {}
+      virtual uint8_t Get() const    { return VG(_rtc.GetIntFlags()) ; }
+      virtual void    Set(uint8_t v) { _rtc.SetIntFlags(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { return _rtc.Polled(until, false) ; }
 
     private:
       IoXmegaRtc &_rtc ;
@@ -470,6 +837,7 @@ namespace AVR
       CntL(const Mcu &mcu, IoXmegaRtc &rtc) : Register(mcu, "RTC_CNTL"), _rtc(rtc) {}
       virtual uint8_t Get() const    { return VG(_rtc.GetCntL()) ; }
       virtual void    Set(uint8_t v) { _rtc.SetCntL(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { return _rtc.Polled(until, true) ; }
 
     private:
       IoXmegaRtc &_rtc ;
@@ -480,6 +848,51 @@ namespace AVR
       CntH(const Mcu &mcu, IoXmegaRtc &rtc) : Register(mcu, "RTC_CNTH"), _rtc(rtc) {}
       virtual uint8_t Get() const    { return VG(_rtc.GetCntH()) ; }
       virtual void    Set(uint8_t v) { _rtc.SetCntH(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+
+    private:
+      IoXmegaRtc &_rtc ;
+    } ;
+    class PerL : public Io::Register
+    {
+    public:
+      PerL(const Mcu &mcu, IoXmegaRtc &rtc) : Register(mcu, "RTC_PERL"), _rtc(rtc) {}
+      virtual uint8_t Get() const    { return VG(_rtc.GetPerL()) ; }
+      virtual void    Set(uint8_t v) { _rtc.SetPerL(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+
+    private:
+      IoXmegaRtc &_rtc ;
+    } ;
+    class PerH : public Io::Register
+    {
+    public:
+      PerH(const Mcu &mcu, IoXmegaRtc &rtc) : Register(mcu, "RTC_PERH"), _rtc(rtc) {}
+      virtual uint8_t Get() const    { return VG(_rtc.GetPerH()) ; }
+      virtual void    Set(uint8_t v) { _rtc.SetPerH(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+
+    private:
+      IoXmegaRtc &_rtc ;
+    } ;
+    class CompL : public Io::Register
+    {
+    public:
+      CompL(const Mcu &mcu, IoXmegaRtc &rtc) : Register(mcu, "RTC_COMPL"), _rtc(rtc) {}
+      virtual uint8_t Get() const    { return VG(_rtc.GetCompL()) ; }
+      virtual void    Set(uint8_t v) { _rtc.SetCompL(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+
+    private:
+      IoXmegaRtc &_rtc ;
+    } ;
+    class CompH : public Io::Register
+    {
+    public:
+      CompH(const Mcu &mcu, IoXmegaRtc &rtc) : Register(mcu, "RTC_COMPH"), _rtc(rtc) {}
+      virtual uint8_t Get() const    { return VG(_rtc.GetCompH()) ; }
+      virtual void    Set(uint8_t v) { _rtc.SetCompH(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
 
     private:
       IoXmegaRtc &_rtc ;
@@ -490,33 +903,381 @@ namespace AVR
       Temp(const Mcu &mcu, IoXmegaRtc &rtc) : Register(mcu, "RTC_TEMP"), _rtc(rtc) {}
       virtual uint8_t Get() const    { return VG(_rtc.GetTemp()) ; }
       virtual void    Set(uint8_t v) { _rtc.SetTemp(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
 
     private:
       IoXmegaRtc &_rtc ;
     } ;
 
-    IoXmegaRtc(Mcu &mcu, IoXmegaClk &clk) ;
+    IoXmegaRtc(Mcu &mcu, IoXmegaClk &clk, uint32_t irqVector) ;
+    virtual void Save(Snapshot &snapshot) const ;
+    virtual void Load(Snapshot &snapshot) ;
+    virtual void Wakeup(uint32_t id) ;
+    virtual void Acknowledge(uint32_t vector) ;
+    virtual bool Awake(uint8_t sleepMode) const { return (sleepMode == 0) || (sleepMode == 3) || (sleepMode == 7) ; } // idle, power-save, extended standby
 
     uint8_t GetPrescaler() const ;
     void    SetPrescaler(uint8_t v) ;
     uint8_t GetStatus() const ;
     void    SetStatus(uint8_t v) ;
+    uint8_t GetIntCtrl() const ;
+    void    SetIntCtrl(uint8_t v) ;
+    uint8_t GetIntFlags() const ;
+    void    SetIntFlags(uint8_t v) ;
     uint8_t GetCntL() const ;
     void    SetCntL(uint8_t v) ;
     uint8_t GetCntH() const ;
     void    SetCntH(uint8_t v) ;
+    uint8_t GetPerL() const ;
+    void    SetPerL(uint8_t v) ;
+    uint8_t GetPerH() const ;
+    void    SetPerH(uint8_t v) ;
+    uint8_t GetCompL() const ;
+    void    SetCompL(uint8_t v) ;
+    uint8_t GetCompH() const ;
+    void    SetCompH(uint8_t v) ;
     uint8_t GetTemp() const ;
     void    SetTemp(uint8_t v) ;
+    bool    Polled(uint64_t &until, bool cnt) const ; // next count (CNT) or next flag (INTFLAGS)
 
   private:
+    static const uint8_t kOvfIf  = 0x01 ;
+    static const uint8_t kCompIf = 0x02 ;
+
+    bool     Running() const ;
+    uint64_t Clock(uint64_t ticks) const ; // RTC clock cycles at MCU ticks
+    void     Update() const ;   // count up to now
+    uint64_t Ticks(uint64_t counts) const ; // MCU ticks when counted up counts more after Update()
+    void     Schedule() ;       // next OVF / COMP interrupt
+    void     Irq() ;
+
     Mcu        &_mcu ;
     IoXmegaClk &_clk ;
+    uint32_t    _irqVector ; // OVF, COMP = +1
 
-    mutable uint64_t _ticks ;
+    mutable uint64_t _ticks ;  // MCU ticks of last Update()
+    mutable uint64_t _clocks ; // RTC clock cycles not yet counted (prescaler)
     uint32_t _prescaler ;
     uint32_t _prescalerDiv ;
     mutable uint32_t _cnt ;
+    uint16_t _per ;
+    uint16_t _comp ;
+    uint8_t  _intCtrl ;
+    mutable uint8_t  _intFlags ;
+    mutable uint8_t  _tmp ;
+  } ;
+  
+  ////////////////////////////////////////////////////////////////////////////////
+  // IoXmegaTc
+  // Timer/Counter type 0 (CCA..CCD) and 1 (CCA, CCB), counted on demand from the MCU ticks
+  ////////////////////////////////////////////////////////////////////////////////
+
+  class IoXmegaTc : public Io
+  {
+  public:
+    class CtrlA : public Io::Register
+    {
+    public:
+      CtrlA(const Mcu &mcu, IoXmegaTc &tc) : Register(mcu, tc.Name() + "_CTRLA"), _tc(tc) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetCtrlA()) ; }
+      virtual void    Set(uint8_t v) { _tc.SetCtrlA(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+    } ;
+    class CtrlB : public Io::Register
+    {
+    public:
+      CtrlB(const Mcu &mcu, IoXmegaTc &tc) : Register(mcu, tc.Name() + "_CTRLB"), _tc(tc) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetCtrlB()) ; }
+      virtual void    Set(uint8_t v) { _tc.SetCtrlB(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+    } ;
+    class IntCtrlA : public Io::Register
+    {
+    public:
+      IntCtrlA(const Mcu &mcu, IoXmegaTc &tc) : Register(mcu, tc.Name() + "_INTCTRLA"), _tc(tc) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetIntCtrlA()) ; }
+      virtual void    Set(uint8_t v) { _tc.SetIntCtrlA(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+    } ;
+    class IntCtrlB : public Io::Register
+    {
+    public:
+      IntCtrlB(const Mcu &mcu, IoXmegaTc &tc) : Register(mcu, tc.Name() + "_INTCTRLB"), _tc(tc) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetIntCtrlB()) ; }
+      virtual void    Set(uint8_t v) { _tc.SetIntCtrlB(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+    } ;
+    class CtrlFClr : public Io::Register
+    {
+    public:
+      CtrlFClr(const Mcu &mcu, IoXmegaTc &tc) : Register(mcu, tc.Name() + "_CTRLFCLR"), _tc(tc) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetCtrlF()) ; }
+      virtual void    Set(uint8_t v) { _tc.ClrCtrlF(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+    } ;
+    class CtrlFSet : public Io::Register
+    {
+    public:
+      CtrlFSet(const Mcu &mcu, IoXmegaTc &tc) : Register(mcu, tc.Name() + "_CTRLFSET"), _tc(tc) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetCtrlF()) ; }
+      virtual void    Set(uint8_t v) { _tc.SetCtrlF(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+    } ;
+    class CtrlGClr : public Io::Register
+    {
+    public:
+      CtrlGClr(const Mcu &mcu, IoXmegaTc &tc) : Register(mcu, tc.Name() + "_CTRLGCLR"), _tc(tc) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetCtrlG()) ; }
+      virtual void    Set(uint8_t v) { _tc.ClrCtrlG(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+    } ;
+    class CtrlGSet : public Io::Register
+    {
+    public:
+      CtrlGSet(const Mcu &mcu, IoXmegaTc &tc) : Register(mcu, tc.Name() + "_CTRLGSET"), _tc(tc) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetCtrlG()) ; }
+      virtual void    Set(uint8_t v) { _tc.SetCtrlG(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+    } ;
+    class IntFlags : public Io::Register
+    {
+    public:
+      IntFlags(const Mcu &mcu, IoXmegaTc &tc) : Register(mcu, tc.Name() + "_INTFLAGS"), _tc(tc) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetIntFlags()) ; }
+      virtual void    Set(uint8_t v) { _tc.SetIntFlags(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { return _tc.Polled(until, false) ; }
+    private:
+      IoXmegaTc &_tc ;
+    } ;
+    class Temp : public Io::Register
+    {
+    public:
+      Temp(const Mcu &mcu, IoXmegaTc &tc) : Register(mcu, tc.Name() + "_TEMP"), _tc(tc) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetTemp()) ; }
+      virtual void    Set(uint8_t v) { _tc.SetTemp(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+    } ;
+    class CntL : public Io::Register
+    {
+    public:
+      CntL(const Mcu &mcu, IoXmegaTc &tc) : Register(mcu, tc.Name() + "_CNTL"), _tc(tc) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetCntL()) ; }
+      virtual void    Set(uint8_t v) { _tc.SetCntL(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { return _tc.Polled(until, true) ; }
+    private:
+      IoXmegaTc &_tc ;
+    } ;
+    class CntH : public Io::Register
+    {
+    public:
+      CntH(const Mcu &mcu, IoXmegaTc &tc) : Register(mcu, tc.Name() + "_CNTH"), _tc(tc) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetCntH()) ; }
+      virtual void    Set(uint8_t v) { _tc.SetCntH(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+    } ;
+    class PerL : public Io::Register
+    {
+    public:
+      PerL(const Mcu &mcu, IoXmegaTc &tc) : Register(mcu, tc.Name() + "_PERL"), _tc(tc) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetPerL()) ; }
+      virtual void    Set(uint8_t v) { _tc.SetPerL(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+    } ;
+    class PerH : public Io::Register
+    {
+    public:
+      PerH(const Mcu &mcu, IoXmegaTc &tc) : Register(mcu, tc.Name() + "_PERH"), _tc(tc) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetPerH()) ; }
+      virtual void    Set(uint8_t v) { _tc.SetPerH(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+    } ;
+    class PerBufL : public Io::Register
+    {
+    public:
+      PerBufL(const Mcu &mcu, IoXmegaTc &tc) : Register(mcu, tc.Name() + "_PERBUFL"), _tc(tc) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetPerBufL()) ; }
+      virtual void    Set(uint8_t v) { _tc.SetPerBufL(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+    } ;
+    class PerBufH : public Io::Register
+    {
+    public:
+      PerBufH(const Mcu &mcu, IoXmegaTc &tc) : Register(mcu, tc.Name() + "_PERBUFH"), _tc(tc) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetPerBufH()) ; }
+      virtual void    Set(uint8_t v) { _tc.SetPerBufH(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+    } ;
+    class CcL : public Io::Register
+    {
+    public:
+      CcL(const Mcu &mcu, IoXmegaTc &tc, uint8_t ch) : Register(mcu, tc.Name() + "_CC" + (char)('A' + ch) + "L"), _tc(tc), _ch(ch) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetCcL(_ch)) ; }
+      virtual void    Set(uint8_t v) { _tc.SetCcL(_ch, VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+      uint8_t    _ch ;
+    } ;
+    class CcH : public Io::Register
+    {
+    public:
+      CcH(const Mcu &mcu, IoXmegaTc &tc, uint8_t ch) : Register(mcu, tc.Name() + "_CC" + (char)('A' + ch) + "H"), _tc(tc), _ch(ch) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetCcH(_ch)) ; }
+      virtual void    Set(uint8_t v) { _tc.SetCcH(_ch, VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+      uint8_t    _ch ;
+    } ;
+    class CcBufL : public Io::Register
+    {
+    public:
+      CcBufL(const Mcu &mcu, IoXmegaTc &tc, uint8_t ch) : Register(mcu, tc.Name() + "_CC" + (char)('A' + ch) + "BUFL"), _tc(tc), _ch(ch) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetCcBufL(_ch)) ; }
+      virtual void    Set(uint8_t v) { _tc.SetCcBufL(_ch, VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+      uint8_t    _ch ;
+    } ;
+    class CcBufH : public Io::Register
+    {
+    public:
+      CcBufH(const Mcu &mcu, IoXmegaTc &tc, uint8_t ch) : Register(mcu, tc.Name() + "_CC" + (char)('A' + ch) + "BUFH"), _tc(tc), _ch(ch) {}
+      virtual uint8_t Get() const    { return VG(_tc.GetCcBufH(_ch)) ; }
+      virtual void    Set(uint8_t v) { _tc.SetCcBufH(_ch, VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoXmegaTc &_tc ;
+      uint8_t    _ch ;
+    } ;
+
+    IoXmegaTc(Mcu &mcu, const std::string &name, uint32_t irqVector, uint8_t channels) ;
+    const std::string& Name() { return _name ; }
+    virtual void Save(Snapshot &snapshot) const ;
+    virtual void Load(Snapshot &snapshot) ;
+    virtual void Wakeup(uint32_t id) ;
+    virtual void Acknowledge(uint32_t vector) ;
+
+    uint8_t  GetCtrlA() const ;
+    void     SetCtrlA(uint8_t v) ;
+    uint8_t  GetCtrlB() const ;
+    void     SetCtrlB(uint8_t v) ;
+    uint8_t& CtrlC() { return _ctrlC ; } // waveform output, event and byte mode settings are stored only
+    uint8_t& CtrlD() { return _ctrlD ; }
+    uint8_t& CtrlE() { return _ctrlE ; }
+    uint8_t  GetIntCtrlA() const ;
+    void     SetIntCtrlA(uint8_t v) ;
+    uint8_t  GetIntCtrlB() const ;
+    void     SetIntCtrlB(uint8_t v) ;
+    uint8_t  GetCtrlF() const ;
+    void     ClrCtrlF(uint8_t v) ;
+    void     SetCtrlF(uint8_t v) ;
+    uint8_t  GetCtrlG() const ;
+    void     ClrCtrlG(uint8_t v) ;
+    void     SetCtrlG(uint8_t v) ;
+    uint8_t  GetIntFlags() const ;
+    void     SetIntFlags(uint8_t v) ;
+    uint8_t  GetTemp() const ;
+    void     SetTemp(uint8_t v) ;
+    uint8_t  GetCntL() const ;
+    void     SetCntL(uint8_t v) ;
+    uint8_t  GetCntH() const ;
+    void     SetCntH(uint8_t v) ;
+    uint8_t  GetPerL() const ;
+    void     SetPerL(uint8_t v) ;
+    uint8_t  GetPerH() const ;
+    void     SetPerH(uint8_t v) ;
+    uint8_t  GetPerBufL() const ;
+    void     SetPerBufL(uint8_t v) ;
+    uint8_t  GetPerBufH() const ;
+    void     SetPerBufH(uint8_t v) ;
+    uint8_t  GetCcL(uint8_t ch) const ;
+    void     SetCcL(uint8_t ch, uint8_t v) ;
+    uint8_t  GetCcH(uint8_t ch) const ;
+    void     SetCcH(uint8_t ch, uint8_t v) ;
+    uint8_t  GetCcBufL(uint8_t ch) const ;
+    void     SetCcBufL(uint8_t ch, uint8_t v) ;
+    uint8_t  GetCcBufH(uint8_t ch) const ;
+    void     SetCcBufH(uint8_t ch, uint8_t v) ;
+    bool     Polled(uint64_t &until, bool cnt) const ; // next count (CNT) or next flag (INTFLAGS)
+
+  private:
+    static const uint8_t  kOvfIf = 0x01 ;
+    static const uint8_t  kCcAIf = 0x10 ; // CCB..CCD: << 1..3
+    static const uint8_t  kLupd  = 0x02 ;
+    static const uint8_t  kDir   = 0x01 ;
+    static const uint8_t  kPerBv = 0x01 ; // CCA..CCD: << 1..4
+    static const uint32_t kMax   = 0xffff ;
+
+    uint32_t Div() const ;    // clock select, 0: off
+    uint8_t  Mode() const  { return _ctrlB & 0x07 ; }
+    bool     DualSlope() const { return Mode() >= 5 ; }
+    uint32_t Top() const ;
+    uint32_t Period() const ; // counts, dual slope: up and down
+    uint32_t Counts(uint32_t pos0, uint32_t pos1) const ; // counts until position pos0 or pos1 is reached
+    uint32_t Counts(uint8_t flag) const ; // counts until flag is set, 0: never
+    bool     Buffered() const ;           // buffer valid and not locked, taken over at BOTTOM
+    void     Count(uint64_t n) const ;
+    void     Advance(uint64_t n) const ;
+    void     UpdateBuffers() const ;
+    void     Update() const ;   // count up to now
+    uint64_t Ticks(uint64_t counts) const ; // MCU ticks when counted up counts more after Update()
+    uint8_t  Level(uint8_t flag) const ; // interrupt level
+    void     Schedule() ;       // next enabled interrupt
+    void     Irq() ;
+
+    Mcu        &_mcu ;
+    std::string _name ;
+    uint32_t    _irqVector ; // OVF, ERR = +1, CCA..CCD = +2..+5
+    uint8_t     _channels ;
+
+    mutable uint64_t _ticks ; // MCU ticks of last Update()
+    mutable uint16_t _cnt ;
+    mutable bool     _down ;  // dual slope counting down
+    uint8_t  _ctrlA ;
+    uint8_t  _ctrlB ;
+    uint8_t  _ctrlC ;
+    uint8_t  _ctrlD ;
+    uint8_t  _ctrlE ;
+    uint8_t  _intCtrlA ;
+    uint8_t  _intCtrlB ;
+    uint8_t  _ctrlF ;
+    mutable uint8_t  _ctrlG ;
+    mutable uint8_t  _intFlags ;
     mutable uint8_t  _tmp ;
+    mutable uint16_t _per ;
+    mutable uint16_t _cc[4] ;
+    uint16_t _perBuf ;
+    uint16_t _ccBuf[4] ;
   } ;
   
   ////////////////////////////////////////////////////////////////////////////////
@@ -532,6 +1293,7 @@ namespace AVR
       EEARH(const Mcu &mcu, IoEeprom &eeprom) : Register(mcu, "EEARH"), _eeprom(eeprom) {} ;
       virtual uint8_t Get() const    { return VG(_eeprom.GetAddrHi()) ; }
       virtual void    Set(uint8_t v) { _eeprom.SetAddrHi(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
     private:
       IoEeprom &_eeprom ;
     } ;
@@ -541,6 +1303,7 @@ namespace AVR
       EEARL(const Mcu &mcu, IoEeprom &eeprom) : Register(mcu, "EEARL"), _eeprom(eeprom) {} ;
       virtual uint8_t Get() const    { return VG(_eeprom.GetAddrLo()) ; }
       virtual void    Set(uint8_t v) { _eeprom.SetAddrLo(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
     private:
       IoEeprom &_eeprom ;
     } ;
@@ -550,6 +1313,7 @@ namespace AVR
       EEDR(const Mcu &mcu, IoEeprom &eeprom) : Register(mcu, "EEDR"), _eeprom(eeprom) {} ;
       virtual uint8_t Get() const    { return VG(_eeprom.GetData()) ; }
       virtual void    Set(uint8_t v) { _eeprom.SetData(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
     private:
       IoEeprom &_eeprom ;
     } ;
@@ -559,11 +1323,16 @@ namespace AVR
       EECR(const Mcu &mcu, IoEeprom &eeprom) : Register(mcu, "EECR"), _eeprom(eeprom) {} ;
       virtual uint8_t Get() const    { return VG(_eeprom.GetControl()) ; }
       virtual void    Set(uint8_t v) { _eeprom.SetControl(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { return _eeprom.Polled(until) ; }
     private:
       IoEeprom &_eeprom ;
     } ;
 
-    IoEeprom(Mcu &mcu, bool hasEepm = true) : _mcu(mcu), _hasEepm(hasEepm), _addr(0), _data(0), _control(0), _activeTicks(0), _writeBusyTicks(0), _readBusyTicks(0) {}
+    IoEeprom(Mcu &mcu, uint32_t irqVector, bool hasEepm = true) : _mcu(mcu), _irqVector(irqVector), _hasEepm(hasEepm), _addr(0), _data(0), _control(0), _activeTicks(0), _writeBusyTicks(0), _readBusyTicks(0) {}
+    virtual void Save(Snapshot &snapshot) const ;
+    virtual void Load(Snapshot &snapshot) ;
+    virtual void Wakeup(uint32_t id) ; // write done
+    virtual bool Awake(uint8_t sleepMode) const { return sleepMode <= 1 ; } // idle, ADC noise reduction
 
     uint16_t GetAddr() const       { return _addr      ; }
     void     SetAddr(uint16_t v)   ;
@@ -575,6 +1344,7 @@ namespace AVR
     void     SetData(uint8_t v)    ;
     uint8_t  GetControl() const    ;
     void     SetControl(uint8_t v) ;
+    bool     Polled(uint64_t &until) const ; // next EECR bit cleared by time
 
   private:
     static const uint8_t kEEPM  = 0b00110000 ;
@@ -583,7 +1353,10 @@ namespace AVR
     static const uint8_t kEEPE  = 0b00000010 ;
     static const uint8_t kEERE  = 0b00000001 ;
     
+    void Irq() ; // EE_READY while EERIE and not busy
+
     Mcu      &_mcu ;
+    uint32_t _irqVector ;
     bool     _hasEepm ;
     uint16_t _addr ;
     uint8_t  _data ;
@@ -607,6 +1380,9 @@ namespace AVR
       virtual uint8_t Get() const  ;
       virtual void    Set(uint8_t v) ;
       virtual void    Add(const std::vector<uint8_t> &data) { _port.Add(data) ; }
+      virtual Sink*   Output() { return &_port.Output() ; }
+      virtual bool    Input(const std::string &source, bool paced) { return _port.Input(source, paced) ; }
+      virtual bool    OpenPty(std::string &name) { return _port.OpenPty(name) ; }
       
     private:
       IoUsart &_port ;
@@ -616,21 +1392,208 @@ namespace AVR
     {
     public:
       UCSRnA(const Mcu &mcu, IoUsart &port) : Register(mcu, "UCSR0A"), _port(port) {}
-      virtual uint8_t Get() const    { return VG((_port.RxAvail() ? 0x80 : 0x00) | 0x40 | 0x20) ; }
-      virtual void    Set(uint8_t v) { VS(v) ; }
+      virtual uint8_t Get() const    { return VG(_port.GetStatus()) ; }
+      virtual void    Set(uint8_t v) { _port.SetStatus(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
     private:
       IoUsart &_port ;
     } ;
 
-    IoUsart() : _rxPos(0) {}
+    class UCSRnB : public Io::Register
+    {
+    public:
+      UCSRnB(const Mcu &mcu, IoUsart &port) : Register(mcu, "UCSR0B"), _port(port) {}
+      virtual uint8_t Get() const    { return VG(_port.GetControl()) ; }
+      virtual void    Set(uint8_t v) { _port.SetControl(VS(v)) ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoUsart &_port ;
+    } ;
+
+    IoUsart(Mcu &mcu, uint32_t irqVector)
+      : _mcu(mcu), _irqVector(irqVector), _paced(false), _rxReady(0), _control(0), _u2x(0), _ucsrC(0x06), _ubrrL(0), _ubrrH(0), _txc(false) {}
     virtual uint8_t Rx() const ;
-    virtual bool RxAvail() const { return _rxPos < _rx.size() ; }
+    virtual bool RxAvail() const ;
     virtual void Tx(uint8_t v) const ;
     virtual void Add(const std::vector<uint8_t> &data) ;
+    bool         Input(const std::string &source, bool paced) ;
+    bool         OpenPty(std::string &name) ;
+    Sink&        Output() { return _tx ; }
+    virtual void Flush() { _tx.Flush() ; }
+    virtual void Save(Snapshot &snapshot) const ;
+    virtual void Load(Snapshot &snapshot) ;
+    virtual void Wakeup(uint32_t id) ;
+    virtual void Acknowledge(uint32_t vector) ;
+
+    uint8_t  GetStatus() const ;
+    void     SetStatus(uint8_t v) ;
+    uint8_t  GetControl() const { return _control ; }
+    void     SetControl(uint8_t v) ;
+    uint8_t& UcsrC() { return _ucsrC ; }
+    uint8_t& UbrrL() { return _ubrrL ; }
+    uint8_t& UbrrH() { return _ubrrH ; }
+
+  private:
+    static const uint8_t kRXCIE = 0b10000000 ;
+    static const uint8_t kTXCIE = 0b01000000 ;
+    static const uint8_t kUDRIE = 0b00100000 ;
+    static const uint8_t kTXC   = 0b01000000 ;
+    static const uint8_t kU2X   = 0b00000010 ;
+
+    static const uint32_t kEventPoll    = 0 ; // read the input stream, write buffered output
+    static const uint32_t kEventRxReady = 1 ; // paced input, next byte received
+
+    void     Irq() const ; // request RX, UDRE, TX interrupts
+    void     RxSchedule() const ;
+    uint64_t FrameTicks() const ; // one character at the configured baud rate
+
+    Mcu             &_mcu ;
+    uint32_t         _irqVector ; // RX, UDRE = +1, TX = +2
+    Pty              _pty ; // before _rx / _tx, closed after them
+    mutable Source   _rx ;
+    bool             _paced ;
+    mutable uint64_t _rxReady ; // ticks, paced input
+    mutable Sink     _tx ;
+    uint8_t          _control ;
+    uint8_t          _u2x ;
+    uint8_t          _ucsrC ;
+    uint8_t          _ubrrL ;
+    uint8_t          _ubrrH ;
+    mutable bool     _txc ;
+  } ;
+
+  ////////////////////////////////////////////////////////////////////////////////
+  // IoTimer8 (tiny, mega)
+  // 8 bit Timer/Counter0, counted on demand from the MCU ticks
+  ////////////////////////////////////////////////////////////////////////////////
+
+  class IoTimer8 : public Io
+  {
+  public:
+    class CtrlA : public Io::Register
+    {
+    public:
+      CtrlA(const Mcu &mcu, const std::string &name, IoTimer8 &timer) : Register(mcu, name), _timer(timer) {}
+      virtual uint8_t Get() const    { return VG(_timer.GetCtrlA()) ; }
+      virtual void    Set(uint8_t v) { _timer.SetCtrlA(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoTimer8 &_timer ;
+    } ;
+    class CtrlB : public Io::Register
+    {
+    public:
+      CtrlB(const Mcu &mcu, const std::string &name, IoTimer8 &timer) : Register(mcu, name), _timer(timer) {}
+      virtual uint8_t Get() const    { return VG(_timer.GetCtrlB()) ; }
+      virtual void    Set(uint8_t v) { _timer.SetCtrlB(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoTimer8 &_timer ;
+    } ;
+    class Cnt : public Io::Register
+    {
+    public:
+      Cnt(const Mcu &mcu, const std::string &name, IoTimer8 &timer) : Register(mcu, name), _timer(timer) {}
+      virtual uint8_t Get() const    { return VG(_timer.GetCnt()) ; }
+      virtual void    Set(uint8_t v) { _timer.SetCnt(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { return _timer.Polled(until, true) ; }
+    private:
+      IoTimer8 &_timer ;
+    } ;
+    class OcrA : public Io::Register
+    {
+    public:
+      OcrA(const Mcu &mcu, const std::string &name, IoTimer8 &timer) : Register(mcu, name), _timer(timer) {}
+      virtual uint8_t Get() const    { return VG(_timer.GetOcrA()) ; }
+      virtual void    Set(uint8_t v) { _timer.SetOcrA(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoTimer8 &_timer ;
+    } ;
+    class OcrB : public Io::Register
+    {
+    public:
+      OcrB(const Mcu &mcu, const std::string &name, IoTimer8 &timer) : Register(mcu, name), _timer(timer) {}
+      virtual uint8_t Get() const    { return VG(_timer.GetOcrB()) ; }
+      virtual void    Set(uint8_t v) { _timer.SetOcrB(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoTimer8 &_timer ;
+    } ;
+    class IntMask : public Io::Register
+    {
+    public:
+      IntMask(const Mcu &mcu, const std::string &name, IoTimer8 &timer) : Register(mcu, name), _timer(timer) {}
+      virtual uint8_t Get() const    { return VG(_timer.GetIntMask()) ; }
+      virtual void    Set(uint8_t v) { _timer.SetIntMask(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { until = UINT64_MAX ; return true ; }
+    private:
+      IoTimer8 &_timer ;
+    } ;
+    class IntFlags : public Io::Register
+    {
+    public:
+      IntFlags(const Mcu &mcu, const std::string &name, IoTimer8 &timer) : Register(mcu, name), _timer(timer) {}
+      virtual uint8_t Get() const    { return VG(_timer.GetIntFlags()) ; }
+      virtual void    Set(uint8_t v) { _timer.SetIntFlags(VS(v))       ; }
+      virtual bool    Polled(uint64_t &until) const { return _timer.Polled(until, false) ; }
+    private:
+      IoTimer8 &_timer ;
+    } ;
+
+    // bits: TOV0 / OCF0A / OCF0B in TIFR, same position in TIMSK; 0: no such unit
+    IoTimer8(Mcu &mcu, uint32_t ovfVector, uint8_t tov, uint32_t compAVector = 0, uint8_t ocfA = 0, uint32_t compBVector = 0, uint8_t ocfB = 0) ;
+    virtual void Save(Snapshot &snapshot) const ;
+    virtual void Load(Snapshot &snapshot) ;
+    virtual void Wakeup(uint32_t id) ;
+    virtual void Acknowledge(uint32_t vector) ;
+
+    uint8_t GetCtrlA() const ;
+    void    SetCtrlA(uint8_t v) ;
+    uint8_t GetCtrlB() const ;
+    void    SetCtrlB(uint8_t v) ;
+    uint8_t GetCnt() const ;
+    void    SetCnt(uint8_t v) ;
+    uint8_t GetOcrA() const ;
+    void    SetOcrA(uint8_t v) ;
+    uint8_t GetOcrB() const ;
+    void    SetOcrB(uint8_t v) ;
+    uint8_t GetIntMask() const ;
+    void    SetIntMask(uint8_t v) ;
+    uint8_t GetIntFlags() const ;
+    void    SetIntFlags(uint8_t v) ;
+    bool    Polled(uint64_t &until, bool cnt) const ; // next count (TCNT) or next flag (TIFR)
 
   private:
-    mutable std::vector<uint8_t> _rx ;
-    mutable uint32_t _rxPos ;    
+    uint32_t Div() const ;    // prescaler, 0: stopped
+    uint8_t  Wgm() const ;    // waveform generation mode
+    uint32_t Top() const ;
+    uint32_t Period() const ; // counts, phase correct: up and down
+    bool     DualSlope() const ;
+    uint32_t Counts(uint8_t flag) const ; // counts until flag is set, 0: never
+    void     Count(uint64_t n) const ;
+    void     Update() const ;   // count up to now
+    uint64_t Ticks(uint64_t counts) const ; // MCU ticks when counted up counts more after Update()
+    void     Schedule() ;       // next enabled interrupt
+    void     Irq() ;
+
+    Mcu      &_mcu ;
+    uint32_t  _ovfVector ;
+    uint32_t  _compAVector ;
+    uint32_t  _compBVector ;
+    uint8_t   _tov ;
+    uint8_t   _ocfA ;
+    uint8_t   _ocfB ;
+
+    mutable uint64_t _ticks ; // MCU ticks of last Update()
+    mutable uint8_t  _cnt ;
+    mutable bool     _down ;  // phase correct PWM counting down
+    uint8_t  _ctrlA ;
+    uint8_t  _ctrlB ;
+    uint8_t  _ocrA ;
+    uint8_t  _ocrB ;
+    uint8_t  _intMask ; // incl. bits of other timers sharing TIMSK
+    mutable uint8_t  _intFlags ;
   } ;
   
 }
@@ -3,7 +3,11 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <errno.h>
 
 #include <algorithm>
 #include <functional>
@@ -42,7 +46,7 @@ std::map<std::string, std::function<AVR::Mcu*()> > mcuFactory
 
 int usage(const char *name)
 {
-  fprintf(stderr, "usage: %s [-d] [-e] [-ee <macro>] [-m <mcu>] [-x <xref>] [-p <eeProm>] <avr-bin>\n", name) ;
+  fprintf(stderr, "usage: %s [-d] [-e] [-ee <macro>] [-run [-max-cycles <n>] [-stop-at <label>] [-uart-in [<usart>=]<source>] [-uart-paced] [-uart-out [<usart>=]<target>] [-prof <file>] [-callgrind <file>] [-cov <file>] [-cov-json <file>] [-lcov <file>]] [-lines <file>] [-pty <usart>] [-engine <engine>] [-m <mcu>] [-x <xref>] [-p <eeProm>] <avr-bin>\n", name) ;
   fprintf(stderr, "       %s -h\n", name) ;
   fprintf(stderr, "use '-h' for a full list of MCUs\n") ;
   return 1 ;
@@ -50,14 +54,32 @@ int usage(const char *name)
 
 int usageFull(const char *name)
 {
-  fprintf(stderr, "usage: %s [-d] [-e] [-ee <macro>] [-m <mcu>] [-x <xref>] [-p <eeProm>] <avr-bin>\n", name) ;
+  fprintf(stderr, "usage: %s [-d] [-e] [-ee <macro>] [-run [-max-cycles <n>] [-stop-at <label>] [-uart-in [<usart>=]<source>] [-uart-paced] [-uart-out [<usart>=]<target>] [-prof <file>] [-callgrind <file>] [-cov <file>] [-cov-json <file>] [-lcov <file>]] [-lines <file>] [-pty <usart>] [-engine <engine>] [-m <mcu>] [-x <xref>] [-p <eeProm>] <avr-bin>\n", name) ;
   fprintf(stderr, "       %s -h\n", name) ;
   fprintf(stderr, "parameter:\n") ;
   fprintf(stderr, "   -m <mcu>    MCU type, see below\n") ;
   fprintf(stderr, "   -d          disassemble file\n") ;
   fprintf(stderr, "   -e          execute file\n") ;
   fprintf(stderr, "   -ee <macro> run macro file <macro>.aem (implies -e)\n") ;
+  fprintf(stderr, "   -run        execute file without user interface, exit code:\n") ;
+  fprintf(stderr, "               0: stop address / cycle limit reached, 1: invalid parameter or file,\n") ;
+  fprintf(stderr, "               2: cycle limit reached before stop address, 3: interrupted, 4: program error (see stderr)\n") ;
+  fprintf(stderr, "   -max-cycles <n>    stop -run after n cycles\n") ;
+  fprintf(stderr, "   -stop-at <label>   stop -run at program address\n") ;
+  fprintf(stderr, "   -uart-in [<usart>=]<source>   -run input of a USART (default the first), streamed from\n") ;
+  fprintf(stderr, "                      source file name, - (stdin) or fd:<n>, may be repeated\n") ;
+  fprintf(stderr, "   -uart-paced        deliver -uart-in at the baud rate set by the program\n") ;
+  fprintf(stderr, "   -uart-out [<usart>=]<target>  -run output of a USART (default the first, e.g. UDR0, USARTD0),\n") ;
+  fprintf(stderr, "                      target file name, - (stdout) or fd:<n>, may be repeated\n") ;
+  fprintf(stderr, "   -prof <file>       -run execution profile per function and address, - for stdout\n") ;
+  fprintf(stderr, "   -callgrind <file>  -run call graph profile in callgrind format\n") ;
+  fprintf(stderr, "   -cov <file>        -run instruction and branch coverage, merged into file\n") ;
+  fprintf(stderr, "   -cov-json <file>   -run coverage per function as JSON\n") ;
+  fprintf(stderr, "   -lcov <file>       -run coverage as lcov tracefile, needs -lines\n") ;
+  fprintf(stderr, "   -pty <usart> connect a USART (e.g. UDR0, USARTC0) to a new pseudo terminal, may be repeated\n") ;
+  fprintf(stderr, "   -engine <engine> execution engine: ref (default), fast or block\n") ;
   fprintf(stderr, "   -x <xref>   read/write xref file\n") ;
+  fprintf(stderr, "   -lines <file> line info for coverage, lines of \"<addr> <file>:<line>\"\n") ;
   fprintf(stderr, "   -p <eeProm> binary file of EEPROM memory\n") ;
   fprintf(stderr, "   <avr-bin>   binary file to be disassembled / executed\n") ;
   fprintf(stderr, "   -h          this help\n") ;
@@ -116,6 +138,132 @@ void ParseXrefFile(AVR::Mcu &mcu, const std::string &xrefFileName)
   }
 }
 
+// USART data register by name (UDR0, USARTC0 or USARTC0_DATA), first if name is empty
+AVR::Io::Register* FindUsart(AVR::Mcu &mcu, const std::string &name)
+{
+  for (AVR::Io::Register *ioReg : mcu.Io())
+  {
+    if (!ioReg || !ioReg->Output())
+      continue ;
+    if (name.empty() || !strcasecmp(ioReg->Name().c_str(), name.c_str()) || !strcasecmp(ioReg->Name().c_str(), (name + "_DATA").c_str()))
+      return ioReg ;
+  }
+  return nullptr ;
+}
+
+int RunBatch(AVR::Mcu &mcu, uint64_t maxCycles, const std::string &stopAt,
+             const std::vector<std::string> &uartIns, bool uartPaced, const std::vector<std::string> &uartOuts,
+             const std::string &profFileName, const std::string &callgrindFileName,
+             const std::string &covFileName, const std::string &covJsonFileName, const std::string &lcovFileName)
+{
+  uint32_t stopAddr = 0xffffffff ;
+  if (stopAt.size())
+  {
+    const AVR::Mcu::Xref *xref = mcu.XrefByLabel(stopAt) ;
+    if (xref)
+      stopAddr = xref->Addr() ;
+    else
+    {
+      char *end ;
+      stopAddr = strtoul(stopAt.c_str(), &end, 0) ;
+      if (*end)
+      {
+        fprintf(stderr, "unknown label \"%s\"\n", stopAt.c_str()) ;
+        return 1 ;
+      }
+    }
+  }
+
+  for (const std::string &uartIn : uartIns)
+  {
+    size_t eq = uartIn.find('=') ;
+    std::string name   = (eq != std::string::npos) ? uartIn.substr(0, eq) : "" ;
+    std::string source = (eq != std::string::npos) ? uartIn.substr(eq + 1) : uartIn ;
+    AVR::Io::Register *port = FindUsart(mcu, name) ;
+    if (!port)
+    {
+      fprintf(stderr, "%s has no USART %s\n", mcu.Name().c_str(), name.c_str()) ;
+      return 1 ;
+    }
+    if (!port->Input(source, uartPaced))
+    {
+      fprintf(stderr, "read file \"%s\" failed\n", source.c_str()) ;
+      return 1 ;
+    }
+  }
+
+  std::vector<AVR::Sink*> sinks ;
+  for (const std::string &uartOut : uartOuts)
+  {
+    size_t eq = uartOut.find('=') ;
+    std::string name   = (eq != std::string::npos) ? uartOut.substr(0, eq) : "" ;
+    std::string target = (eq != std::string::npos) ? uartOut.substr(eq + 1) : uartOut ;
+    AVR::Io::Register *port = FindUsart(mcu, name) ;
+    if (!port)
+    {
+      fprintf(stderr, "%s has no USART %s\n", mcu.Name().c_str(), name.c_str()) ;
+      return 1 ;
+    }
+    AVR::Sink *sink = port->Output() ;
+    if (!sink->Open(target))
+    {
+      fprintf(stderr, "write file \"%s\" failed\n", target.c_str()) ;
+      return 1 ;
+    }
+    sinks.push_back(sink) ;
+  }
+
+  if (profFileName.size())
+    mcu.ProfileOn() ;
+  if (callgrindFileName.size())
+    mcu.CallGraphOn() ;
+  if (covFileName.size() || covJsonFileName.size() || lcovFileName.size())
+    mcu.CoverageOn() ;
+  if (covFileName.size() && !access(covFileName.c_str(), F_OK) && !mcu.CoverageRead(covFileName))
+  {
+    fprintf(stderr, "read coverage file \"%s\" failed\n", covFileName.c_str()) ;
+    return 1 ;
+  }
+
+  AVR::Batch batch(mcu) ;
+  AVR::Batch::Result result = batch.Run(maxCycles, stopAddr) ;
+
+  for (AVR::Sink *sink : sinks)
+    sink->Close() ;
+
+  if (profFileName.size())
+  {
+    FILE *prof = (profFileName == "-") ? stdout : fopen(profFileName.c_str(), "w") ;
+    if (prof)
+    {
+      mcu.ProfileReport(prof, UINT32_MAX) ;
+      if (prof != stdout)
+        fclose(prof) ;
+    }
+    else
+      fprintf(stderr, "write file \"%s\" failed\n", profFileName.c_str()) ;
+  }
+  if (callgrindFileName.size() && !mcu.CallGraphWrite(callgrindFileName))
+    fprintf(stderr, "write file \"%s\" failed\n", callgrindFileName.c_str()) ;
+  if (covFileName.size() && !mcu.CoverageWrite(covFileName))
+    fprintf(stderr, "write file \"%s\" failed\n", covFileName.c_str()) ;
+  if (covJsonFileName.size() && !mcu.CoverageJson(covJsonFileName))
+    fprintf(stderr, "write file \"%s\" failed\n", covJsonFileName.c_str()) ;
+  if (lcovFileName.size() && !mcu.CoverageLcov(lcovFileName))
+    fprintf(stderr, "write file \"%s\" failed\n", lcovFileName.c_str()) ;
+
+  const char *how = "stopped" ;
+  switch (result)
+  {
+  case AVR::Batch::Stopped:     how = "stopped"       ; break ;
+  case AVR::Batch::CycleLimit:  how = "cycle limit"   ; break ;
+  case AVR::Batch::Interrupted: how = "interrupted"   ; break ;
+  case AVR::Batch::ProgError:   how = "program error" ; break ;
+  }
+  fprintf(stderr, "%s at %05x after %llu cycles\n", how, mcu.PC(), (unsigned long long)mcu.Ticks()) ;
+  return result ;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 // main
 ////////////////////////////////////////////////////////////////////////////////
@@ -135,6 +283,20 @@ int main(int argc, char *argv[])
   std::string xrefFileName ;
   std::string eepromFileName ;
   std::string macroFileName ;
+  AVR::EngineType engine = AVR::EngineType::Reference ;
+  bool run = false ;
+  uint64_t maxCycles = UINT64_MAX ;
+  std::string stopAt ;
+  std::vector<std::string> uartIns ;
+  bool uartPaced = false ;
+  std::vector<std::string> uartOuts ;
+  std::vector<std::string> ptys ;
+  std::string profFileName ;
+  std::string callgrindFileName ;
+  std::string covFileName ;
+  std::string covJsonFileName ;
+  std::string lcovFileName ;
+  std::string linesFileName ;
   
   for (iArg = 1 ; iArg < argc ; ++iArg)
   {
@@ -153,6 +315,92 @@ int main(int argc, char *argv[])
       execute = true ;
       macroFileName = argv[++iArg] ;
     }
+    else if (!strcmp(argv[iArg], "-run"))
+      run = true ;
+    else if (!strcmp(argv[iArg], "-max-cycles"))
+    {
+      if (iArg >= argc-1)
+        return usage(argv[0]) ;
+      const char *arg = argv[++iArg] ;
+      char *end ;
+      errno = 0 ;
+      maxCycles = strtoull(arg, &end, 0) ;
+      if (!*arg || (*arg == '-') || *end || (errno == ERANGE))
+        return usage(argv[0]) ;
+    }
+    else if (!strcmp(argv[iArg], "-stop-at"))
+    {
+      if (iArg >= argc-1)
+        return usage(argv[0]) ;
+      stopAt = argv[++iArg] ;
+    }
+    else if (!strcmp(argv[iArg], "-uart-in"))
+    {
+      if (iArg >= argc-1)
+        return usage(argv[0]) ;
+      uartIns.push_back(argv[++iArg]) ;
+    }
+    else if (!strcmp(argv[iArg], "-uart-paced"))
+      uartPaced = true ;
+    else if (!strcmp(argv[iArg], "-uart-out"))
+    {
+      if (iArg >= argc-1)
+        return usage(argv[0]) ;
+      uartOuts.push_back(argv[++iArg]) ;
+    }
+    else if (!strcmp(argv[iArg], "-prof"))
+    {
+      if (iArg >= argc-1)
+        return usage(argv[0]) ;
+      profFileName = argv[++iArg] ;
+    }
+    else if (!strcmp(argv[iArg], "-callgrind"))
+    {
+      if (iArg >= argc-1)
+        return usage(argv[0]) ;
+      callgrindFileName = argv[++iArg] ;
+    }
+    else if (!strcmp(argv[iArg], "-cov"))
+    {
+      if (iArg >= argc-1)
+        return usage(argv[0]) ;
+      covFileName = argv[++iArg] ;
+    }
+    else if (!strcmp(argv[iArg], "-cov-json"))
+    {
+      if (iArg >= argc-1)
+        return usage(argv[0]) ;
+      covJsonFileName = argv[++iArg] ;
+    }
+    else if (!strcmp(argv[iArg], "-lcov"))
+    {
+      if (iArg >= argc-1)
+        return usage(argv[0]) ;
+      lcovFileName = argv[++iArg] ;
+    }
+    else if (!strcmp(argv[iArg], "-lines"))
+    {
+      if (iArg >= argc-1)
+        return usage(argv[0]) ;
+      linesFileName = argv[++iArg] ;
+    }
+    else if (!strcmp(argv[iArg], "-pty"))
+    {
+      if (iArg >= argc-1)
+        return usage(argv[0]) ;
+      ptys.push_back(argv[++iArg]) ;
+    }
+    else if (!strcmp(argv[iArg], "-engine"))
+    {
+      if (iArg >= argc-1)
+        return usage(argv[0]) ;
+      ++iArg ;
+      if      (!strcmp(argv[iArg], "ref"  )) engine = AVR::EngineType::Reference ;
+      else if (!strcmp(argv[iArg], "fast" )) engine = AVR::EngineType::Fast      ;
+      else if (!strcmp(argv[iArg], "block")) engine = AVR::EngineType::Block     ;
+      else
+        return usage(argv[0]) ;
+    }
     else if (!strcmp(argv[iArg], "-m"))
     {
       if (iArg >= argc-1)
@@ -183,6 +431,7 @@ int main(int argc, char *argv[])
     return usage(argv[0]) ;
 
   mcu = iFactory->second() ;
+  mcu->Engine() = engine ;
   std::vector<AVR::Command> prog ;
   prog.reserve(0x20000) ;
 
@@ -228,9 +477,31 @@ int main(int argc, char *argv[])
   {
     ParseXrefFile(*mcu, xrefFileName) ;
   }
+  if (linesFileName.size() && !mcu->CoverageLines(linesFileName))
+    fprintf(stderr, "open file \"%s\" failed\n", linesFileName.c_str()) ;
   
   mcu->PC() = 0 ;
   uint32_t nCommand = mcu->SetFlash(0, prog) ;
+  for (const std::string &pty : ptys)
+  {
+    AVR::Io::Register *port = FindUsart(*mcu, pty) ;
+    std::string name ;
+    if (!port || !port->OpenPty(name))
+    {
+      fprintf(stderr, "%s: no pseudo terminal for USART %s\n", mcu->Name().c_str(), pty.c_str()) ;
+      delete mcu ;
+      return 1 ;
+    }
+    fprintf(stderr, "%s: %s\n", port->Name().c_str(), name.c_str()) ;
+  }
+
+  if (run)
+  {
+    int result = RunBatch(*mcu, maxCycles, stopAt, uartIns, uartPaced, uartOuts, profFileName, callgrindFileName,
+                          covFileName, covJsonFileName, lcovFileName) ;
+    delete mcu ;
+    return result ;
+  }
   printf("prog size:   %zd\n", prog.size()) ;
   printf("loaded size: %d\n" , nCommand) ;
 
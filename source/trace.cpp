@@ -0,0 +1,243 @@
+////////////////////////////////////////////////////////////////////////////////
+// trace.cpp
+// AVRtrace: decode a binary branch trace (t bin) to the text trace format
+////////////////////////////////////////////////////////////////////////////////
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <string>
+#include <map>
+
+#include "trace.h"
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct Label
+{
+  std::string _label ;
+  std::string _description ;
+} ;
+
+class Reader
+{
+public:
+  Reader(FILE *file) : _file(file), _ok(true) {}
+
+  bool Ok() const { return _ok ; }
+  uint8_t Byte()
+  {
+    int c = getc_unlocked(_file) ;
+    if (c == EOF)
+    {
+      _ok = false ;
+      return AVR::TraceFormat::End ;
+    }
+    return (uint8_t)c ;
+  }
+  uint64_t Varint()
+  {
+    uint64_t v = 0 ;
+    for (uint32_t shift = 0 ; _ok && (shift < 64) ; shift += 7)
+    {
+      uint8_t b = Byte() ;
+      v |= (uint64_t)(b & 0x7f) << shift ;
+      if (!(b & 0x80))
+        break ;
+    }
+    return v ;
+  }
+  std::string String()
+  {
+    uint64_t size = Varint() ;
+    std::string s ;
+    for (uint64_t i = 0 ; _ok && (i < size) ; ++i)
+      s += (char)Byte() ;
+    return s ;
+  }
+
+private:
+  FILE *_file ;
+  bool  _ok ;
+} ;
+
+////////////////////////////////////////////////////////////////////////////////
+
+int usage(const char *name)
+{
+  fprintf(stderr, "usage: %s [-t] [-f <function>] <trace>\n", name) ;
+  fprintf(stderr, "parameter:\n") ;
+  fprintf(stderr, "   -t             prefix lines with the cycle count of the first branch\n") ;
+  fprintf(stderr, "   -f <function>  only calls of function (label or address) and everything below\n") ;
+  fprintf(stderr, "   <trace>        binary trace file written by 't bin <name>', - for stdin\n") ;
+  return 1 ;
+}
+
+void Indent(uint32_t lvl)
+{
+  printf("%2d  ", lvl) ;
+  for (uint32_t i = 0, e = (lvl < 20) ? lvl : 20 ; i < e ; ++i)
+    fputs("  ", stdout) ;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// main
+////////////////////////////////////////////////////////////////////////////////
+
+int main(int argc, char *argv[])
+{
+  bool ticksOn = false ;
+  std::string function ;
+  std::string fileName ;
+
+  for (int iArg = 1 ; iArg < argc ; ++iArg)
+  {
+    if (!strcmp(argv[iArg], "-t"))
+      ticksOn = true ;
+    else if (!strcmp(argv[iArg], "-f"))
+    {
+      if (iArg >= argc-1)
+        return usage(argv[0]) ;
+      function = argv[++iArg] ;
+    }
+    else if (fileName.empty())
+      fileName = argv[iArg] ;
+    else
+      return usage(argv[0]) ;
+  }
+  if (fileName.empty())
+    return usage(argv[0]) ;
+
+  FILE *file = (fileName == "-") ? stdin : fopen(fileName.c_str(), "rb") ;
+  if (!file)
+  {
+    fprintf(stderr, "read file \"%s\" failed\n", fileName.c_str()) ;
+    return 1 ;
+  }
+  Reader reader(file) ;
+
+  // header
+  for (const char *m = AVR::TraceFormat::kMagic ; *m ; ++m)
+  {
+    if (reader.Byte() != (uint8_t)*m)
+    {
+      fprintf(stderr, "\"%s\" is not a binary trace\n", fileName.c_str()) ;
+      return 1 ;
+    }
+  }
+  uint8_t version = reader.Byte() ;
+  if (version != AVR::TraceFormat::kVersion)
+  {
+    fprintf(stderr, "trace version %u not supported\n", version) ;
+    return 1 ;
+  }
+  std::string mcu = reader.String() ;
+  std::map<uint32_t, Label> labels ;
+  for (uint64_t nLabel = reader.Varint() ; reader.Ok() && nLabel ; --nLabel)
+  {
+    uint32_t addr = (uint32_t)reader.Varint() ;
+    Label &label = labels[addr] ;
+    label._label       = reader.String() ;
+    label._description = reader.String() ;
+  }
+
+  uint32_t fctAddr = 0xffffffff ;
+  if (function.size())
+  {
+    for (const auto &iLabel : labels)
+      if (iLabel.second._label == function)
+        fctAddr = iLabel.first ;
+    if (fctAddr == 0xffffffff)
+    {
+      char *end ;
+      fctAddr = strtoul(function.c_str(), &end, 0) ;
+      if (*end)
+      {
+        fprintf(stderr, "unknown label \"%s\" in %s trace\n", function.c_str(), mcu.c_str()) ;
+        return 1 ;
+      }
+    }
+  }
+
+  // records, rendered like Mcu::Trace::Text()
+  uint32_t dst   = 0 ;
+  uint64_t ticks = 0 ;
+  uint32_t lvl   = 0 ;
+  uint32_t fctLvl = 0 ; // level of the traced function while inside
+  bool     inside = function.empty() ;
+  while (true)
+  {
+    uint8_t tag = reader.Byte() ;
+    if (tag == AVR::TraceFormat::End)
+      break ;
+
+    uint32_t src = dst + (int32_t)AVR::TraceFormat::UnZigZag(reader.Varint()) ;
+    dst = src + (int32_t)AVR::TraceFormat::UnZigZag(reader.Varint()) ;
+    uint64_t cnt = reader.Varint() + 1 ;
+    ticks += reader.Varint() ;
+    if (!reader.Ok())
+      break ;
+
+    bool isCall = (tag == AVR::TraceFormat::Call) ;
+    bool isRet  = (tag == AVR::TraceFormat::Return) ;
+    auto iLabel = labels.find(dst) ;
+    bool enter  = !inside && isCall && (dst == fctAddr) && (iLabel != labels.end()) ;
+    bool show   = inside || enter ;
+
+    if (show)
+    {
+      if (ticksOn)
+        printf("%12llu ", (unsigned long long)ticks) ;
+      Indent(lvl) ;
+      printf("%05x -> %05x %4llux", src, dst, (unsigned long long)cnt) ;
+    }
+
+    if (isRet)
+    {
+      if (show)
+        printf("   RET\n\n") ;
+      if (lvl > 0)
+        lvl-- ;
+    }
+    else if (iLabel != labels.end())
+    {
+      const Label &label = iLabel->second ;
+      if (show)
+        printf("   %s\n", label._label.c_str()) ;
+      if (isCall)
+      {
+        lvl++ ;
+        if (enter)
+          fctLvl = lvl ;
+        if (show)
+        {
+          putchar('\n') ;
+          if (ticksOn)
+            printf("%12s ", "") ;
+          Indent(lvl) ;
+          printf("%s", label._label.c_str()) ;
+          if (!label._description.empty())
+            printf(" | %s", label._description.c_str()) ;
+          printf("\n") ;
+        }
+      }
+    }
+    else if (show)
+      printf("\n") ;
+
+    if (function.size())
+      inside = (enter || inside) && (lvl >= fctLvl) ;
+  }
+
+  if (!reader.Ok())
+    fprintf(stderr, "trace \"%s\" truncated\n", fileName.c_str()) ;
+  if (file != stdin)
+    fclose(file) ;
+
+  return reader.Ok() ? 0 : 2 ;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EOF
+////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,47 @@
+////////////////////////////////////////////////////////////////////////////////
+// trace.h
+// binary branch trace, written by Mcu::Trace, decoded by AVRtrace
+////////////////////////////////////////////////////////////////////////////////
+
+#pragma once
+
+#include <cstdint>
+
+namespace AVR
+{
+  ////////////////////////////////////////////////////////////////////////////////
+  // TraceFormat
+  //
+  // header:  "AVRtrace" version mcu-name
+  //          xref-count { addr label description }
+  // records: tag src dst count ticks ... End
+  //
+  // numbers are LEB128 varints, strings a varint length and the characters.
+  // a record is a branch taken count times in a row (the text trace line):
+  //   src   zigzag(src - dst of the previous record)
+  //   dst   zigzag(dst - src)
+  //   count count - 1
+  //   ticks ticks at the first branch - ticks of the previous record
+  ////////////////////////////////////////////////////////////////////////////////
+
+  namespace TraceFormat
+  {
+    const char    kMagic[]   = "AVRtrace" ;
+    const uint8_t kVersion   = 1 ;
+
+    enum Tag : uint8_t
+    {
+      Jump   = 0, // jump, branch, skip
+      Call   = 1,
+      Return = 2,
+      End    = 0xff,
+    } ;
+
+    inline uint64_t ZigZag(int64_t v)   { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63) ; }
+    inline int64_t  UnZigZag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1) ; }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// EOF
+////////////////////////////////////////////////////////////////////////////////